@@ -9,12 +9,12 @@ in vec3 frag_normal;                        // fragment normal.
 in vec3 frag_color;                         // colour of the fragment.
 in vec2 frag_texcoord;                      // fragment texture coordinates.
 in vec4 frag_shadowcoords[NUM_CASCADES];    // shadowmap coordinates.
+in vec3 frag_albedo;                        // base colour, used for 'ingame' colours.
 
 uniform sampler2D tex0;                     // material texture.
 uniform sampler2D shadow_map[NUM_CASCADES]; // shadow map texture, in 3 different resolutions.
 uniform float cascade_bounds[NUM_CASCADES]; // cascade boundaries array.
 uniform float camera_distance;              // distance from player to camera.
-uniform vec3 albedo;                        // base colour, used for 'ingame' colours.
 uniform vec3 light_pos;                     // directional light position.
 
 layout (location = 0) out vec4 final_color;
@@ -108,7 +108,7 @@ void main()
     float intensity     = smoothstep(0, shadow_smooth, NdotL);
 
     // get the emission and diffuse terms.
-    vec3 emission       = texture(tex0, frag_texcoord).rgb * albedo;
+    vec3 emission       = texture(tex0, frag_texcoord).rgb * frag_albedo;
     vec3 diffuse        = texture(tex0, frag_texcoord).rgb * light_colour;
     vec3 base_color     = emission + diffuse;
     // vec3 y_gradient     = vec3(clamp(frag_position.y, -1.0, 1.0));
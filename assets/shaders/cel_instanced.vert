@@ -0,0 +1,59 @@
+#version 330 core
+
+layout (location = 0) in vec3 vertex_position;  // position of vertex.
+layout (location = 1) in vec3 vertex_normal;    // normal of the vertex.
+layout (location = 2) in vec3 vertex_color;     // colour stored in the vertex.
+layout (location = 3) in vec2 vertex_texcoord;  // vertex texture coordinates.
+layout (location = 4) in vec4 joints;           // joint IDs.
+layout (location = 5) in vec4 weights;          // joint weights.
+layout (location = 6) in mat4 instance_model;   // per instance: position, rotation and scale (takes locations 6-9).
+layout (location = 10) in vec3 instance_albedo; // per instance: base colour.
+layout (location = 11) in int instance_joints;   // per instance: where its joints start in the palette.
+
+#define NUM_CASCADES 3
+#define MAX_JOINTS 100
+
+uniform mat4 node_matrix;                       // the mesh's node, the same for every instance in a draw.
+uniform mat4 view;                              // the projection * view matrix (combined)
+uniform mat4 light[NUM_CASCADES];               // light matrix from shadow, one for each cascade.
+uniform samplerBuffer joint_palette;            // every model's joint matrices this frame (see JointPalette).
+uniform int joint_offset;                       // where the mesh's skin starts, from the start of the instance's joints.
+
+out vec3 frag_position;                         // outputs the current position for the Fragment Shader
+out vec3 frag_normal;                           // outputs normal
+out vec3 frag_color;                            // outputs color
+out vec2 frag_texcoord;                         // outputs texture coordinates
+out vec4 frag_shadowcoords[NUM_CASCADES];       // outputs position respective to light.
+out vec3 frag_albedo;                           // outputs base colour.
+
+// joint matrices are four texels each in the palette, one per column.
+mat4 get_joint(float joint)
+{
+    int texel = (instance_joints + joint_offset + int(joint)) * 4;
+    return mat4(texelFetch(joint_palette, texel), texelFetch(joint_palette, texel + 1), texelFetch(joint_palette, texel + 2), texelFetch(joint_palette, texel + 3));
+}
+
+void main()
+{
+    mat4 mvp = instance_model * node_matrix;
+    mat4 skin = 
+        weights.x * get_joint(joints.x) +
+        weights.y * get_joint(joints.y) +
+        weights.z * get_joint(joints.z) +
+        weights.w * get_joint(joints.w);
+
+    vec4 position       = mvp * (skin * vec4(vertex_position, 1.0));
+    gl_Position         = view * position;
+    frag_position       = vec3(view * position);
+    frag_normal         = normalize(vec3(inverse(transpose(mvp * skin)) * vec4(vertex_normal, 1.0)));
+    frag_color          = vertex_color;
+    frag_texcoord       = vertex_texcoord;
+    frag_albedo         = instance_albedo;
+
+
+    // shadowmap.
+    for (int i = 0; i < NUM_CASCADES; ++i)
+    {
+        frag_shadowcoords[i] = light[i] * position;
+    }
+}
\ No newline at end of file
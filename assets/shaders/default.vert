@@ -13,7 +13,8 @@ layout (location = 5) in vec4 weights;          // joint weights.
 uniform mat4 mvp;                               // projection matrix that stores the position, rotation, and scale of a mesh. 
 uniform mat4 view;                              // view matrix that stores the camera position etc.
 uniform mat4 light[NUM_CASCADES];               // light matrix from shadow, one for each cascade.
-uniform mat4 joint_matrices[MAX_JOINTS];        // array of joint transformations.
+uniform samplerBuffer joint_palette;            // every model's joint matrices this frame (see JointPalette).
+uniform int joint_offset;                       // where the mesh's skin starts in the palette.
 
 // out vec3 frag_position;                         // outputs the current position for the Fragment Shader 
 out vec3 frag_normal;                           // outputs normal
@@ -21,13 +22,20 @@ out vec3 frag_color;                            // outputs color
 out vec2 frag_texcoord;                         // outputs texture coordinates
 out vec4 frag_shadowcoords[NUM_CASCADES];       // outputs position respective to light.
 
+// joint matrices are four texels each in the palette, one per column.
+mat4 get_joint(float joint)
+{
+    int texel = (joint_offset + int(joint)) * 4;
+    return mat4(texelFetch(joint_palette, texel), texelFetch(joint_palette, texel + 1), texelFetch(joint_palette, texel + 2), texelFetch(joint_palette, texel + 3));
+}
+
 void main()
 {
     mat4 skin = 
-        weights.x * joint_matrices[int(joints.x)] +
-        weights.y * joint_matrices[int(joints.y)] +
-        weights.z * joint_matrices[int(joints.z)] +
-        weights.w * joint_matrices[int(joints.w)];
+        weights.x * get_joint(joints.x) +
+        weights.y * get_joint(joints.y) +
+        weights.z * get_joint(joints.z) +
+        weights.w * get_joint(joints.w);
 
     vec4 position       = mvp * skin * vec4(vertex_position, 1.0);
     gl_Position         = view * position;
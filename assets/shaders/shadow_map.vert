@@ -6,15 +6,23 @@ layout (location = 5) in vec4 weights;  // joint weights.
 
 uniform mat4 light;
 uniform mat4 mvp;
-uniform mat4 joint_matrices[100];       // array of joint transformations.
+uniform samplerBuffer joint_palette;    // every model's joint matrices this frame (see JointPalette).
+uniform int joint_offset;               // where the mesh's skin starts in the palette.
+
+// joint matrices are four texels each in the palette, one per column.
+mat4 get_joint(float joint)
+{
+    int texel = (joint_offset + int(joint)) * 4;
+    return mat4(texelFetch(joint_palette, texel), texelFetch(joint_palette, texel + 1), texelFetch(joint_palette, texel + 2), texelFetch(joint_palette, texel + 3));
+}
 
 void main()
 {
     mat4 skin = 
-        weights.x * joint_matrices[int(joints.x)] +
-        weights.y * joint_matrices[int(joints.y)] +
-        weights.z * joint_matrices[int(joints.z)] +
-        weights.w * joint_matrices[int(joints.w)];
+        weights.x * get_joint(joints.x) +
+        weights.y * get_joint(joints.y) +
+        weights.z * get_joint(joints.z) +
+        weights.w * get_joint(joints.w);
 
     gl_Position = light * mvp * skin * vec4(position, 1.0);
 }
\ No newline at end of file
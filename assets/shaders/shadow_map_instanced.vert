@@ -0,0 +1,30 @@
+#version 330 core
+
+layout (location = 0) in vec3 position;
+layout (location = 4) in vec4 joints;   // joint IDs.
+layout (location = 5) in vec4 weights;  // joint weights.
+layout (location = 6) in mat4 instance_model;   // per instance (takes locations 6-9).
+layout (location = 11) in int instance_joints;  // per instance: where its joints start in the palette.
+
+uniform mat4 light;
+uniform mat4 node_matrix;               // the mesh's node, the same for every instance in a draw.
+uniform samplerBuffer joint_palette;    // every model's joint matrices this frame (see JointPalette).
+uniform int joint_offset;               // where the mesh's skin starts, from the start of the instance's joints.
+
+// joint matrices are four texels each in the palette, one per column.
+mat4 get_joint(float joint)
+{
+    int texel = (instance_joints + joint_offset + int(joint)) * 4;
+    return mat4(texelFetch(joint_palette, texel), texelFetch(joint_palette, texel + 1), texelFetch(joint_palette, texel + 2), texelFetch(joint_palette, texel + 3));
+}
+
+void main()
+{
+    mat4 skin = 
+        weights.x * get_joint(joints.x) +
+        weights.y * get_joint(joints.y) +
+        weights.z * get_joint(joints.z) +
+        weights.w * get_joint(joints.w);
+
+    gl_Position = light * instance_model * node_matrix * skin * vec4(position, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+/*
+heap allocation benchmark.
+counts operator new calls made during each Player::move on the first level,
+the collision queries inside it are expected to make none once warmed up.
+also prints the player's collision stats for the same moves.
+gl calls are stubbed out so it runs without a window.
+run from the repo root so the assets path resolves.
+*/
+
+#include <iostream>     // results.
+#include <cstdlib>      // malloc/free for the counting allocator.
+#include <new>          // std::bad_alloc.
+#include <cmath>
+
+#include "null_gl.hpp"
+#include "player.hpp"
+#include "level.hpp"
+
+#define MOVE_COUNT      6000    // 100 seconds at 60 ticks per second.
+#define WARMUP_COUNT    60      // first second is reported separately while reused buffers grow.
+
+using std::cout;
+
+// every allocation goes through these, so the count covers std containers too.
+static size_t allocation_count = 0;
+
+void *operator new(size_t size)
+{
+    allocation_count++;
+    void *pointer = std::malloc(size ? size : 1);
+    if (!pointer)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+int main(void)
+{
+    if (!load_null_gl())
+    {
+        cout << "failed to load null gl\n";
+        return 1;
+    }
+
+    Player player("boar_pig.gltf");
+    Level level(player.current_level);
+
+    size_t warmup_allocations   = 0;
+    size_t steady_allocations   = 0;
+    size_t steady_max           = 0;
+    size_t steady_moves         = 0;
+    size_t level_loads          = 0;
+    const float dt              = 1.0f / 60.0f;
+
+    for (int i = 0; i < MOVE_COUNT; ++i)
+    {
+        // run in a slowly turning circle while falling, so the player walks over and into the level geometry.
+        float angle         = i * 0.01f;
+        glm::vec3 movement  = glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * player.MAX_SPEED * dt;
+        movement.y          = player.GRAVITY * dt * dt * 10.0f;
+
+        int level_before    = player.current_level;
+        glm::vec3 spawn     = player.respawn_position;
+        size_t before       = allocation_count;
+
+        player.move(movement, level);
+
+        size_t allocations  = allocation_count - before;
+
+        // hitting a trigger reloads the level, which is meant to allocate.
+        if ((player.current_level != level_before) || (player.respawn_position != spawn))
+        {
+            level_loads++;
+        }
+        else if (i < WARMUP_COUNT)
+        {
+            warmup_allocations += allocations;
+        }
+        else
+        {
+            steady_allocations  += allocations;
+            steady_max          = std::max(steady_max, allocations);
+            steady_moves++;
+        }
+
+        // fell out of the level.
+        if (player.position.y < -100.0f)
+        {
+            player.respawn(level);
+        }
+    }
+
+    cout << "moves:                     " << MOVE_COUNT << "\n";
+    cout << "level loads (excluded):    " << level_loads << "\n";
+    cout << "warm-up allocations:       " << warmup_allocations << " over the first " << WARMUP_COUNT << " moves\n";
+    cout << "allocations per move:      " << (steady_moves ? static_cast<double>(steady_allocations) / steady_moves : 0.0) << "\n";
+    cout << "max allocations in a move: " << steady_max << "\n";
+
+    // collision work over the same moves.
+    const CollisionStats &stats = player.collision_stats;
+    cout << "\ncollision queries:         " << stats.queries << "\n";
+    cout << "gjk iterations per query:  " << (stats.queries ? static_cast<double>(stats.gjk_iterations) / stats.queries : 0.0) << "\n";
+    cout << "gjk cached axis exits:     " << stats.gjk_early_outs << "\n";
+    cout << "contact cache hit rate:    " << stats.cache_hit_rate() << "\n";
+    cout << "epa iterations per run:    " << (stats.epa_runs ? static_cast<double>(stats.epa_iterations) / stats.epa_runs : 0.0) << "\n";
+    cout << "epa failures/overflows:    " << stats.epa_failures << "/" << stats.epa_overflows << "\n";
+    cout << "sweeps per move:           " << static_cast<double>(stats.casts) / MOVE_COUNT << "\n";
+    cout << "iterations per sweep:      " << (stats.casts ? static_cast<double>(stats.cast_iterations) / stats.casts : 0.0) << "\n";
+    cout << "triangles tested per move: " << static_cast<double>(stats.triangle_tests) / MOVE_COUNT << "\n";
+    return 0;
+}
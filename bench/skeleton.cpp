@@ -0,0 +1,152 @@
+/*
+skeletal pose benchmark.
+compares Model::update_world_matrices + update_joints, which pose every node of the model through its cached
+node matrices, with the soa skeleton (skeleton.hpp) posing each skin on its own.
+both get the same poses, sampled from the model's first animation beforehand so sampling isn't timed.
+models without a skin have nothing for the skeleton to pose, so they're skipped.
+gl calls are stubbed out so it runs without a window.
+run from the repo root so the assets path resolves.
+*/
+
+#include <iostream>     // results.
+#include <iomanip>      // table formatting.
+#include <chrono>       // timing.
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "null_gl.hpp"
+#include "draw.hpp"
+#include "skeleton.hpp"
+
+#define POSE_COUNT      240     // four seconds of animation at 60 ticks per second.
+#define TICK_COUNT      20000   // poses timed per path, cycling through the sampled ones.
+
+using std::cout;
+using clock_type = std::chrono::high_resolution_clock;
+
+int main(void)
+{
+    if (!load_null_gl())
+    {
+        cout << "failed to load null gl\n";
+        return 1;
+    }
+
+    cout << "times are microseconds per tick, averaged over " << TICK_COUNT << " ticks.\n\n";
+    cout << std::left << std::setw(20) << "model" << std::setw(8) << "nodes" << std::setw(8) << "joints" << std::setw(8) << "bones"
+         << std::setw(10) << "model" << std::setw(10) << "skeleton" << std::setw(10) << "speedup" << "max error\n";
+
+    for (std::string filename : {"CesiumMan.gltf", "player_test.gltf"})
+    {
+        Model model;
+        if (!model.load(filename))
+        {
+            cout << "failed to load " << filename << "\n";
+            continue;
+        }
+        const ModelData &data = *model.data;
+
+        // the poses, and the nodes the animation moves (what it would mark dirty).
+        std::vector<std::vector<NodeTransform>> poses;
+        std::vector<uint32_t> animated;
+        for (int i = 0; i < POSE_COUNT; ++i)
+        {
+            model.update_animations(1.0f / 60.0f, 0);
+            poses.push_back(model.transforms);
+        }
+        if (!data.animations.empty())
+        {
+            for (const AnimationChannel &channel : data.animations[0].channels)
+            {
+                if (channel.node > -1)
+                {
+                    animated.push_back(static_cast<uint32_t>(channel.node));
+                }
+            }
+        }
+
+        std::vector<Skeleton> skeletons;
+        std::vector<SkeletonPose> skeleton_poses;
+        std::vector<std::vector<glm::mat4>> palettes;
+        std::vector<uint32_t> skins;                    // by skeleton.
+        size_t joint_count  = 0;
+        size_t bone_count   = 0;
+        for (uint32_t skin = 0; skin < data.skins.size(); ++skin)
+        {
+            Skeleton skeleton;
+            if (skeleton.build(data, skin))
+            {
+                skeleton_poses.emplace_back();
+                skeleton_poses.back().resize(skeleton);
+                palettes.emplace_back(skeleton.get_joint_count());
+                joint_count += skeleton.get_joint_count();
+                bone_count  += skeleton.get_bone_count();
+                skeletons.push_back(std::move(skeleton));
+                skins.push_back(skin);
+            }
+        }
+
+        if (skeletons.empty())
+        {
+            cout << std::left << std::setw(20) << filename << "no skins\n";
+            continue;
+        }
+
+        // the model's path, as update_animations runs it after sampling.
+        auto start = clock_type::now();
+        for (int i = 0; i < TICK_COUNT; ++i)
+        {
+            model.transforms.swap(poses[i % POSE_COUNT]);
+            for (uint32_t node : animated)
+            {
+                model.mark_dirty(node);
+            }
+            model.update_world_matrices();
+            model.update_joints();
+            model.transforms.swap(poses[i % POSE_COUNT]);
+        }
+        double model_time = std::chrono::duration<double, std::micro>(clock_type::now() - start).count() / TICK_COUNT;
+
+        start = clock_type::now();
+        for (int i = 0; i < TICK_COUNT; ++i)
+        {
+            for (size_t s = 0; s < skeletons.size(); ++s)
+            {
+                skeleton_poses[s].gather(skeletons[s], poses[i % POSE_COUNT]);
+                pose_skeleton(skeletons[s], skeleton_poses[s], palettes[s]);
+            }
+        }
+        double skeleton_time = std::chrono::duration<double, std::micro>(clock_type::now() - start).count() / TICK_COUNT;
+
+        // both paths should give the same palette for every pose.
+        float max_error = 0.0f;
+        for (const std::vector<NodeTransform> &pose : poses)
+        {
+            model.transforms = pose;
+            std::fill(model.dirty.begin(), model.dirty.end(), NODE_DIRTY_LOCAL | NODE_DIRTY_WORLD);
+            model.update_world_matrices();
+            model.update_joints();
+
+            for (size_t s = 0; s < skeletons.size(); ++s)
+            {
+                skeleton_poses[s].gather(skeletons[s], pose);
+                pose_skeleton(skeletons[s], skeleton_poses[s], palettes[s]);
+                for (size_t j = 0; j < std::min(palettes[s].size(), static_cast<size_t>(MAX_JOINTS)); ++j)
+                {
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        glm::vec4 difference    = glm::abs(model.joint_matrices[skins[s]][j][c] - palettes[s][j][c]);
+                        max_error               = std::max({max_error, difference.x, difference.y, difference.z, difference.w});
+                    }
+                }
+            }
+        }
+
+        cout << std::left << std::setw(20) << filename << std::setw(8) << data.nodes.size() << std::setw(8) << joint_count << std::setw(8) << bone_count
+             << std::fixed << std::setprecision(2) << std::setw(10) << model_time << std::setw(10) << skeleton_time
+             << std::setw(10) << (model_time / skeleton_time) << std::scientific << std::setprecision(1) << max_error << "\n";
+        cout.unsetf(std::ios::floatfield);
+    }
+    return 0;
+}
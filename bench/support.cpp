@@ -0,0 +1,164 @@
+/*
+support function benchmark.
+compares the linear vertex scan, the simd kernels over the soa hull vertices,
+and the convex hull hill climb on the level meshes.
+run from the repo root so the assets path resolves.
+*/
+
+#include <iostream>     // results.
+#include <iomanip>      // table formatting.
+#include <chrono>       // timing.
+#include <random>       // query directions.
+#include <memory>
+#include <vector>
+#include <array>
+#include <string>
+#include <atomic>       // checksum sink.
+#include <tiny_gltf.h>  // implementation is compiled in draw.cpp.
+#include <glm/gtc/type_ptr.hpp>
+
+#include "collision.hpp"
+
+#define MODELS_PATH     "./assets/models/"
+#define QUERY_COUNT     200000  // support queries per mesh.
+
+using std::cout;
+
+static std::atomic<float> checksum_sink{0.0f};  // somewhere for each scene's checksum to go, so the queries aren't optimised out.
+
+// load every primitive's positions from a gltf as a mesh collider.
+// node transforms are skipped, they don't change the cost of a support query.
+std::vector<std::unique_ptr<MeshCollider>> load_colliders(std::string filename)
+{
+    tinygltf::Model input;
+    tinygltf::TinyGLTF context;
+    std::string error;
+    std::string warning;
+    std::vector<std::unique_ptr<MeshCollider>> colliders;
+
+    if (!context.LoadASCIIFromFile(&input, &error, &warning, MODELS_PATH + filename))
+    {
+        cout << "failed to load " << filename << ": " << error << "\n";
+        return colliders;
+    }
+
+    for (const tinygltf::Mesh &mesh : input.meshes)
+    {
+        for (const tinygltf::Primitive &primitive : mesh.primitives)
+        {
+            const tinygltf::Accessor &acc       = input.accessors[primitive.attributes.find("POSITION")->second];
+            const tinygltf::BufferView &view    = input.bufferViews[acc.bufferView];
+            const float *buffer                 = reinterpret_cast<const float *>(&input.buffers[view.buffer].data[view.byteOffset + acc.byteOffset]);
+            size_t stride                       = acc.ByteStride(view) ? acc.ByteStride(view) / sizeof(float) : 3;
+
+            std::vector<glm::vec3> vertices;
+            for (size_t i = 0; i < acc.count; ++i)
+            {
+                vertices.push_back(glm::make_vec3(&buffer[i * stride]));
+            }
+            colliders.push_back(std::make_unique<MeshCollider>(vertices));
+        }
+    }
+    return colliders;
+}
+
+// directions drift slowly like they do between gjk/epa iterations and frames.
+std::vector<glm::vec3> make_directions(size_t count)
+{
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> jitter(0.0f, 0.15f);
+    std::vector<glm::vec3> directions;
+    glm::vec3 direction = glm::vec3(1.0f, 0.0f, 0.0f);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        direction = glm::normalize(direction + glm::vec3(jitter(rng), jitter(rng), jitter(rng)));
+        directions.push_back(direction);
+    }
+    return directions;
+}
+
+// time a support function over every direction, returns milliseconds.
+template <typename F> double time_queries(const std::vector<glm::vec3> &directions, float &checksum, F support)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const glm::vec3 &direction : directions)
+    {
+        checksum += support(direction).x;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(void)
+{
+    std::vector<glm::vec3> directions   = make_directions(QUERY_COUNT);
+    SimdLevel detected                  = get_simd_level();
+    std::array<SimdLevel, 3> kernels    = {SimdLevel::SCALAR, SimdLevel::SSE4, SimdLevel::AVX2};
+
+    cout << "detected simd level: " << simd_level_name(detected) << "\n";
+    cout << "times are total milliseconds for " << QUERY_COUNT << " queries per mesh.\n\n";
+    cout << std::left << std::setw(18) << "scene" << std::setw(8) << "meshes" << std::setw(10) << "vertices" << std::setw(8) << "hull"
+         << std::setw(10) << "scan" << std::setw(10) << "scalar" << std::setw(10) << "sse4" << std::setw(10) << "avx2"
+         << std::setw(10) << "climb" << std::setw(10) << "support" << "mismatches\n";
+
+    for (std::string filename : {"scene_0.gltf", "scene_0000.gltf", "scene_1.gltf"})
+    {
+        auto colliders          = load_colliders(filename);
+        size_t vertex_count     = 0;
+        size_t hull_count       = 0;
+        size_t mismatches       = 0;
+        double scan_time        = 0.0;
+        double kernel_time[3]   = {0.0, 0.0, 0.0};
+        double climb_time       = 0.0;
+        double support_time     = 0.0;
+        float checksum          = 0.0f;    // every query's result summed, see checksum_sink.
+
+        for (auto &collider : colliders)
+        {
+            const MeshCollider &mesh    = *collider;
+            vertex_count                += mesh.vertices.size();
+            hull_count                  += mesh.support_vertices.count;
+
+            // reference linear scan over the raw vertices.
+            scan_time += time_queries(directions, checksum, [&](glm::vec3 d) { return mesh.furthest_point_scan(d); });
+
+            // each simd kernel over the soa hull vertices.
+            for (size_t k = 0; k < kernels.size(); ++k)
+            {
+                set_simd_level(kernels[k]);
+                kernel_time[k] += time_queries(directions, checksum, [&](glm::vec3 d) { return mesh.support_vertices.get(max_dot_index(mesh.support_vertices, d)); });
+            }
+            set_simd_level(detected);
+
+            // hill climb only (skips meshes without a hull, they always scan).
+            if (mesh.hull.is_valid())
+            {
+                climb_time += time_queries(directions, checksum, [&](glm::vec3 d) { mesh.support_hint = mesh.hull.hill_climb(d, mesh.support_hint); return mesh.hull.vertices[mesh.support_hint]; });
+            }
+
+            // what gjk actually calls.
+            support_time += time_queries(directions, checksum, [&](glm::vec3 d) { return mesh.furthest_point(d); });
+
+            // every path should find a point equally far along the direction.
+            for (size_t i = 0; i < directions.size(); i += 97)
+            {
+                float scan = glm::dot(mesh.furthest_point_scan(directions[i]), directions[i]);
+                for (size_t k = 0; k < kernels.size(); ++k)
+                {
+                    set_simd_level(kernels[k]);
+                    float kernel = glm::dot(mesh.support_vertices.get(max_dot_index(mesh.support_vertices, directions[i])), directions[i]);
+                    mismatches += (glm::abs(scan - kernel) > EPA_ACCURACY);
+                }
+                set_simd_level(detected);
+                mismatches += (glm::abs(scan - glm::dot(mesh.furthest_point(directions[i]), directions[i])) > EPA_ACCURACY);
+            }
+        }
+
+        cout << std::left << std::setw(18) << filename << std::setw(8) << colliders.size() << std::setw(10) << vertex_count << std::setw(8) << hull_count
+             << std::fixed << std::setprecision(1) << std::setw(10) << scan_time << std::setw(10) << kernel_time[0] << std::setw(10) << kernel_time[1]
+             << std::setw(10) << kernel_time[2] << std::setw(10) << climb_time << std::setw(10) << support_time << mismatches << "\n";
+        checksum_sink.store(checksum, std::memory_order_relaxed);
+    }
+    return 0;
+}
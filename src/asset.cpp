@@ -0,0 +1,457 @@
+#include "asset.hpp"
+#include "defines.hpp"      // asset paths.
+#include "draw.hpp"         // models are baked from loaded model data.
+#include "collision.hpp"    // colliders are built once at bake time.
+
+#include <iostream>
+#include <fstream>          // writing bakes.
+#include <filesystem>       // source times and sizes.
+#include <algorithm>        // std::min, std::max.
+#include <array>
+#include <cstring>          // std::memcpy, std::strncpy.
+#include <atomic>           // prefetch result.
+#include <stb_image.h>      // skybox faces, implementation is compiled in draw.cpp.
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>          // open.
+#include <unistd.h>         // close.
+#include <sys/mman.h>       // mmap.
+#include <sys/stat.h>       // fstat.
+#endif
+
+using std::cout;
+namespace fs = std::filesystem;
+
+static std::atomic<uint8_t> prefetch_sink{0};   // somewhere for MappedFile::prefetch's reads to go, so they aren't optimised out.
+
+// mapped file functions.
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &file_size) && (file_size.QuadPart > 0))
+    {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    CloseHandle(file);  // the mapping keeps the file open.
+    if (!mapping)
+    {
+        return false;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);   // and the view keeps the mapping.
+    if (!view)
+    {
+        return false;
+    }
+    size = static_cast<size_t>(file_size.QuadPart);
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat file_stat;
+    void *view = MAP_FAILED;
+    if ((fstat(file, &file_stat) == 0) && (file_stat.st_size > 0))
+    {
+        view = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    ::close(file);  // the mapping keeps the file open.
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+    size = static_cast<size_t>(file_stat.st_size);
+#endif
+
+    data = static_cast<const uint8_t *>(view);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<uint8_t *>(data), size);
+#endif
+    }
+    data = nullptr;
+    size = 0;
+}
+
+// reads one byte a page so the whole file is paged in by the calling thread, eg. a loader thread,
+// rather than a piece at a time by whichever thread touches it first.
+void MappedFile::prefetch() const
+{
+    uint8_t sum = 0;
+    for (size_t i = 0; i < size; i += MAPPED_PAGE_SIZE)
+    {
+        sum ^= data[i];
+    }
+    prefetch_sink.store(sum, std::memory_order_relaxed);
+}
+
+// baked asset functions.
+bool BakedAsset::open(const std::string &path)
+{
+    header = nullptr;
+    if (!file.open(path))
+    {
+        cout << "failed to map bake: " << path << "\n";
+        return false;
+    }
+
+    const BakedHeader *file_header = reinterpret_cast<const BakedHeader *>(file.data);
+    if ((file.size < sizeof(BakedHeader)) || (file_header->magic != BAKE_MAGIC) || (file_header->version != BAKE_VERSION))
+    {
+        cout << "bake is from an older version or corrupt, rebake: " << path << "\n";
+        file.close();
+        return false;
+    }
+
+    for (const BakedSection &section : file_header->sections)
+    {
+        if ((section.offset % BAKE_ALIGNMENT != 0) || (section.offset > file.size) || (section.size > file.size - section.offset))
+        {
+            cout << "bake is truncated, rebake: " << path << "\n";
+            file.close();
+            return false;
+        }
+    }
+
+    header = file_header;
+    return true;
+}
+
+// a directory counts as its newest file, so editing any skybox face makes the bake stale.
+int64_t get_source_time(const std::string &path)
+{
+    std::error_code error;
+    if (fs::is_directory(path, error))
+    {
+        int64_t newest = 0;
+        for (const fs::directory_entry &entry : fs::directory_iterator(path, error))
+        {
+            newest = std::max(newest, get_source_time(entry.path().string()));
+        }
+        return newest;
+    }
+
+    fs::file_time_type time = fs::last_write_time(path, error);
+    return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+uint64_t get_source_size(const std::string &path)
+{
+    std::error_code error;
+    if (fs::is_directory(path, error))
+    {
+        uint64_t total = 0;
+        for (const fs::directory_entry &entry : fs::directory_iterator(path, error))
+        {
+            total += get_source_size(entry.path().string());
+        }
+        return total;
+    }
+
+    uintmax_t size = fs::file_size(path, error);
+    return error ? 0 : static_cast<uint64_t>(size);
+}
+
+std::string get_baked_path(const std::string &source_path)
+{
+    std::string path = source_path;
+    while (!path.empty() && ((path.back() == '/') || (path.back() == '\\')))
+    {
+        path.pop_back();
+    }
+    return fs::path(path).replace_extension(BAKE_EXTENSION).string();
+}
+
+std::shared_ptr<BakedAsset> open_baked(const std::string &source_path)
+{
+    std::string baked_path = get_baked_path(source_path);
+    std::error_code error;
+    if (!fs::exists(baked_path, error))
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<BakedAsset> asset = std::make_shared<BakedAsset>();
+    if (!asset->open(baked_path))
+    {
+        return nullptr;
+    }
+
+    // a build can ship bakes without their sources, otherwise the bake has to be from the current source.
+    if (fs::exists(source_path, error) && ((asset->header->source_time != get_source_time(source_path)) ||
+                                           (asset->header->source_size != get_source_size(source_path))))
+    {
+        cout << "bake is older than its source, rebake: " << baked_path << "\n";
+        return nullptr;
+    }
+    return asset;
+}
+
+// baking.
+// collects each section's entries in memory, then writes the header and every section in one go.
+struct BakeWriter
+{
+    std::array<std::vector<uint8_t>, BAKE_SECTION_COUNT> sections;
+    std::array<uint64_t, BAKE_SECTION_COUNT> counts = {};
+
+    template <typename T> BakedRange append(int section, const T *entries, size_t count)
+    {
+        BakedRange range;
+        range.first = static_cast<uint32_t>(counts[section]);
+        range.count = static_cast<uint32_t>(count);
+
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(entries);
+        sections[section].insert(sections[section].end(), bytes, bytes + count * sizeof(T));
+        counts[section] += count;
+        return range;
+    }
+
+    template <typename T> BakedRange append(int section, std::span<const T> entries)
+    {
+        return append(section, entries.data(), entries.size());
+    }
+
+    template <typename T> uint32_t push(int section, const T &entry)
+    {
+        return append(section, &entry, 1).first;
+    }
+
+    bool write(const std::string &path, const std::string &source_path) const
+    {
+        BakedHeader header;
+        header.source_time  = get_source_time(source_path);
+        header.source_size  = get_source_size(source_path);
+
+        uint64_t offset = sizeof(BakedHeader);
+        for (int i = 0; i < BAKE_SECTION_COUNT; ++i)
+        {
+            offset                      = (offset + BAKE_ALIGNMENT - 1) / BAKE_ALIGNMENT * BAKE_ALIGNMENT;
+            header.sections[i].offset   = offset;
+            header.sections[i].count    = counts[i];
+            header.sections[i].size     = sections[i].size();
+            offset                      += sections[i].size();
+        }
+
+        std::ofstream stream(path, std::ios::binary);
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        const char padding[BAKE_ALIGNMENT] = {};
+        uint64_t written = sizeof(BakedHeader);
+        for (int i = 0; i < BAKE_SECTION_COUNT; ++i)
+        {
+            stream.write(padding, header.sections[i].offset - written);
+            stream.write(reinterpret_cast<const char *>(sections[i].data()), sections[i].size());
+            written = header.sections[i].offset + sections[i].size();
+        }
+
+        if (!stream)
+        {
+            cout << "failed to write bake: " << path << "\n";
+            return false;
+        }
+        cout << "baked: " << path << " (" << written << " bytes)\n";
+        return true;
+    }
+};
+
+static void copy_name(char *destination, const std::string &source, size_t size)
+{
+    std::strncpy(destination, source.c_str(), size - 1);
+    destination[size - 1] = '\0';
+}
+
+static void bake_primitive(BakeWriter &writer, const ModelData &model, const MeshPrimitive &mesh)
+{
+    std::span<const glm::vec3> collider_vertices = model.get_collider_vertices(mesh);
+    std::span<const uint32_t> indices            = model.get_indices(mesh);
+
+    BakedPrimitive baked;
+    baked.vertices          = writer.append(BAKE_VERTICES, model.get_vertices(mesh));
+    baked.indices           = writer.append(BAKE_INDICES, indices);
+    baked.material_index    = mesh.material_index;
+    baked.type              = mesh.type;
+    baked.target_level      = mesh.target_level;
+    baked.spawn             = mesh.spawn;
+    baked.collider_vertices = writer.append(BAKE_COLLIDER_VERTICES, collider_vertices);
+
+    // exactly what Level::load would have built from the vertices.
+    switch (mesh.type)
+    {
+    case MeshPrimitive::Type::COLLIDER:
+    {
+        TriangleMeshCollider collider(collider_vertices, indices);
+        baked.bounds        = collider.bounds;
+        baked.triangles     = writer.append(BAKE_TRIANGLES, collider.triangles);
+        baked.bvh_nodes     = writer.append(BAKE_BVH_NODES, collider.tree.nodes);
+        baked.bvh_items     = writer.append(BAKE_BVH_ITEMS, collider.tree.items);
+        break;
+    }
+    case MeshPrimitive::Type::TRIGGER:
+    {
+        MeshCollider collider(collider_vertices);
+        baked.bounds            = collider.bounds;
+        baked.hull_vertices     = writer.append(BAKE_HULL_VERTICES, collider.hull.vertices);
+        baked.hull_offsets      = writer.append(BAKE_HULL_OFFSETS, collider.hull.adjacency_offsets);
+        baked.hull_adjacency    = writer.append(BAKE_HULL_ADJACENCY, collider.hull.adjacency);
+        break;
+    }
+    }
+    writer.push(BAKE_PRIMITIVES, baked);
+}
+
+bool bake_model(const std::string &filename)
+{
+    std::string source_path = MODELS_PATH + filename;
+
+    tinygltf::Model input;
+    tinygltf::TinyGLTF context;
+    std::string error;
+    std::string warning;
+    if (!context.LoadASCIIFromFile(&input, &error, &warning, source_path))
+    {
+        cout << "failed to load " << filename << ": " << error << "\n";
+        return false;
+    }
+
+    // load it the normal way, then write out the result. animations are compressed here, so loading the bake doesn't.
+    ModelData model;
+    model.load_gltf(input);
+
+    BakeWriter writer;
+
+    // nodes and their primitives, already parents before children so they're written as they are.
+    for (const Node &node : model.nodes)
+    {
+        BakedNode baked;
+        baked.parent            = node.parent;
+        baked.index             = node.index;
+        baked.skin              = node.skin;
+        baked.primitives.first  = static_cast<uint32_t>(writer.counts[BAKE_PRIMITIVES]);
+        baked.primitives.count  = static_cast<uint32_t>(node.mesh_primitives.size());
+        baked.translation       = node.translation;
+        baked.rotation          = node.rotation;
+        baked.scale             = node.scale;
+        baked.matrix            = node.matrix;
+        writer.push(BAKE_NODES, baked);
+
+        for (const MeshPrimitive &mesh : node.mesh_primitives)
+        {
+            bake_primitive(writer, model, mesh);
+        }
+    }
+
+    // textures, decoded so loading is just an upload.
+    for (const tinygltf::Texture &texture : input.textures)
+    {
+        const tinygltf::Image &image = input.images[texture.source];
+        BakedTexture baked;
+        baked.width     = image.width;
+        baked.height    = image.height;
+        baked.component = image.component;
+        baked.bits      = image.bits;
+        baked.pixels    = writer.append(BAKE_PIXELS, image.image.data(), image.image.size());
+        writer.push(BAKE_TEXTURES, baked);
+    }
+
+    for (const Skin &skin : model.skins)
+    {
+        BakedSkin baked;
+        copy_name(baked.name, skin.name, BAKE_NAME_SIZE);
+        baked.skeleton_root     = skin.skeleton_root;
+        baked.joints            = writer.append(BAKE_JOINTS, std::span<const uint32_t>(skin.joints));
+        baked.inverse_binds     = writer.append(BAKE_INVERSE_BINDS, std::span<const glm::mat4>(skin.inverse_bind_matrices));
+        writer.push(BAKE_SKINS, baked);
+    }
+
+    for (const Animation &animation : model.animations)
+    {
+        BakedAnimation baked;
+        copy_name(baked.name, animation.name, BAKE_NAME_SIZE);
+        baked.start             = animation.start;
+        baked.end               = animation.end;
+        baked.samplers.first    = static_cast<uint32_t>(writer.counts[BAKE_SAMPLERS]);
+        baked.samplers.count    = static_cast<uint32_t>(animation.samplers.size());
+        baked.channels.first    = static_cast<uint32_t>(writer.counts[BAKE_CHANNELS]);
+        baked.channels.count    = static_cast<uint32_t>(animation.channels.size());
+
+        for (const AnimationSampler &sampler : animation.samplers)
+        {
+            BakedSampler baked_sampler;
+            copy_name(baked_sampler.interpolation, AnimationSampler::get_name(sampler.interpolation), BAKE_TAG_SIZE);
+            baked_sampler.encoding          = sampler.encoding;
+            baked_sampler.start             = sampler.start;
+            baked_sampler.end               = sampler.end;
+            baked_sampler.range_min         = sampler.range_min;
+            baked_sampler.range_size        = sampler.range_size;
+            baked_sampler.times             = writer.append(BAKE_KEY_TIMES, std::span<const float>(sampler.inputs));
+            baked_sampler.values            = writer.append(BAKE_KEY_VALUES, std::span<const glm::vec4>(sampler.outputs_vec4));
+            baked_sampler.encoded_times     = writer.append(BAKE_ENCODED_TIMES, std::span<const uint16_t>(sampler.times));
+            baked_sampler.encoded_values    = writer.append(BAKE_ENCODED_VALUES, std::span<const uint16_t>(sampler.values));
+            writer.push(BAKE_SAMPLERS, baked_sampler);
+        }
+        for (const AnimationChannel &channel : animation.channels)
+        {
+            BakedChannel baked_channel;
+            copy_name(baked_channel.path, AnimationChannel::get_name(channel.path), BAKE_TAG_SIZE);
+            baked_channel.node      = channel.node;
+            baked_channel.sampler   = channel.sampler_index;
+            writer.push(BAKE_CHANNELS, baked_channel);
+        }
+        writer.push(BAKE_ANIMATIONS, baked);
+    }
+
+    return writer.write(get_baked_path(source_path), source_path);
+}
+
+// the faces in Skybox::filenames order, as rgba8 like the skybox loader asks stb for.
+bool bake_skybox(int level_index)
+{
+    std::string source_path = TEXTURES_PATH + std::string("skybox_") + std::to_string(level_index);
+    const std::array<std::string, 6> faces = { "pos_x", "neg_x", "pos_y", "neg_y", "pos_z", "neg_z" };
+
+    BakeWriter writer;
+    for (const std::string &face : faces)
+    {
+        BakedTexture baked;
+        int component   = 0;
+        unsigned char *data = stbi_load((source_path + "/" + face + ".jpg").c_str(), &baked.width, &baked.height, &component, STBI_rgb_alpha);
+        if (!data)
+        {
+            data = stbi_load((source_path + "/" + face + ".png").c_str(), &baked.width, &baked.height, &component, STBI_rgb_alpha);
+        }
+        if (!data)
+        {
+            cout << "failed to load cubemap texture: " << source_path << "/" << face << "\n";
+            return false;
+        }
+
+        baked.pixels = writer.append(BAKE_PIXELS, data, static_cast<size_t>(baked.width) * baked.height * 4);
+        writer.push(BAKE_TEXTURES, baked);
+        stbi_image_free(data);
+    }
+    return writer.write(get_baked_path(source_path), source_path);
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <span>         // sections are read in place.
+#include <memory>
+#include <cstdint>
+#include <cassert>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "bvh.hpp"      // baked collider bounds and tree nodes.
+
+#define BAKE_MAGIC          0x454b4142u     // "BAKE" in a little endian file.
+#define BAKE_VERSION        2
+#define BAKE_EXTENSION      ".bake"
+#define BAKE_ALIGNMENT      16              // every section starts on this boundary, so it can be read as an array in place.
+#define BAKE_NAME_SIZE      64              // names are stored in fixed arrays, longer names are cut short.
+#define BAKE_TAG_SIZE       16              // interpolation and channel path strings.
+#define MAPPED_PAGE_SIZE    4096            // stride MappedFile::prefetch touches the file at.
+
+// sections of a baked file, each is an array of a single type.
+#define BAKE_NODES              0   // BakedNode, parents always come before their children.
+#define BAKE_PRIMITIVES         1   // BakedPrimitive.
+#define BAKE_VERTICES           2   // Vertex, ready to upload.
+#define BAKE_INDICES            3   // uint32_t, relative to the primitive's first vertex.
+#define BAKE_COLLIDER_VERTICES  4   // glm::vec3, vertex positions with the node matrix applied.
+#define BAKE_TRIANGLES          5   // glm::vec3, three per triangle of a triangle mesh collider.
+#define BAKE_BVH_NODES          6   // StaticBVHNode.
+#define BAKE_BVH_ITEMS          7   // int.
+#define BAKE_HULL_VERTICES      8   // glm::vec3, convex hull of a trigger.
+#define BAKE_HULL_OFFSETS       9   // uint32_t.
+#define BAKE_HULL_ADJACENCY     10  // uint32_t.
+#define BAKE_TEXTURES           11  // BakedTexture.
+#define BAKE_PIXELS             12  // uint8_t, decoded texture data.
+#define BAKE_SKINS              13  // BakedSkin.
+#define BAKE_JOINTS             14  // uint32_t, index into the baked nodes.
+#define BAKE_INVERSE_BINDS      15  // glm::mat4.
+#define BAKE_ANIMATIONS         16  // BakedAnimation.
+#define BAKE_SAMPLERS           17  // BakedSampler.
+#define BAKE_CHANNELS           18  // BakedChannel.
+#define BAKE_KEY_TIMES          19  // float, keys of a RAW sampler.
+#define BAKE_KEY_VALUES         20  // glm::vec4.
+#define BAKE_ENCODED_TIMES      21  // uint16_t, keys of a compressed sampler (see AnimationSampler::Encoding).
+#define BAKE_ENCODED_VALUES     22  // uint16_t, three per key.
+#define BAKE_SECTION_COUNT      23
+
+// a run of entries in one of the sections.
+struct BakedRange
+{
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+struct BakedSection
+{
+    uint64_t offset = 0;    // bytes from the start of the file.
+    uint64_t count  = 0;    // entries.
+    uint64_t size   = 0;    // bytes, count * the size of the entry type.
+};
+
+struct BakedHeader
+{
+    uint32_t magic          = BAKE_MAGIC;
+    uint32_t version        = BAKE_VERSION;
+    int64_t source_time     = 0;    // write time of the source the bake was made from, a bake is stale if it changes.
+    uint64_t source_size    = 0;
+    BakedSection sections[BAKE_SECTION_COUNT];
+};
+
+struct BakedNode
+{
+    int32_t parent              = -1;   // baked node index, -1 for a root.
+    uint32_t index              = 0;    // gltf node index.
+    int32_t skin                = -1;
+    BakedRange primitives;
+    glm::vec3 translation       = glm::vec3(0.0f);
+    glm::quat rotation          = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale             = glm::vec3(1.0f);
+    glm::mat4 matrix            = glm::mat4(1.0f);
+};
+
+// a mesh primitive and the collider made from it.
+// colliders get their triangles and tree, triggers their convex hull, so neither is built on load.
+struct BakedPrimitive
+{
+    BakedRange vertices;
+    BakedRange indices;
+    BakedRange collider_vertices;
+    int32_t material_index      = -1;
+    int32_t type                = 0;    // MeshPrimitive::Type.
+    int32_t target_level        = 0;
+    glm::vec3 spawn             = glm::vec3(0.0f);
+    AABB bounds;
+    BakedRange triangles;               // counted in vertices, three per triangle.
+    BakedRange bvh_nodes;
+    BakedRange bvh_items;
+    BakedRange hull_vertices;
+    BakedRange hull_offsets;
+    BakedRange hull_adjacency;
+};
+
+struct BakedTexture
+{
+    int32_t width       = 0;
+    int32_t height      = 0;
+    int32_t component   = 4;
+    int32_t bits        = 8;
+    BakedRange pixels;              // in bytes.
+};
+
+struct BakedSkin
+{
+    char name[BAKE_NAME_SIZE]   = {};
+    int32_t skeleton_root       = -1;   // baked node index.
+    BakedRange joints;
+    BakedRange inverse_binds;
+};
+
+struct BakedAnimation
+{
+    char name[BAKE_NAME_SIZE]   = {};
+    float start                 = 0.0f;
+    float end                   = 0.0f;
+    BakedRange samplers;
+    BakedRange channels;
+};
+
+// a RAW sampler's keys are in times and values, a compressed one's in the encoded sections.
+struct BakedSampler
+{
+    char interpolation[BAKE_TAG_SIZE]   = {};
+    int32_t encoding                    = 0;    // AnimationSampler::Encoding.
+    float start                         = 0.0f;
+    float end                           = 0.0f;
+    glm::vec3 range_min                 = glm::vec3(0.0f);
+    glm::vec3 range_size                = glm::vec3(0.0f);
+    BakedRange times;
+    BakedRange values;
+    BakedRange encoded_times;
+    BakedRange encoded_values;
+};
+
+struct BakedChannel
+{
+    char path[BAKE_TAG_SIZE]    = {};
+    int32_t node                = -1;   // baked node index.
+    uint32_t sampler            = 0;
+};
+
+// read only view of a whole file, mapped rather than read so nothing is copied until it's touched.
+struct MappedFile
+{
+    const uint8_t *data = nullptr;
+    size_t size         = 0;
+
+    MappedFile() {}
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+    void prefetch() const;  // page the whole file in now.
+};
+
+// a mapped .bake file. the header is checked on open, after that sections are handed out as spans into the mapping,
+// so vertices, indices and pixels go straight from the page cache to gl.
+struct BakedAsset
+{
+    MappedFile file;
+    const BakedHeader *header = nullptr;
+
+    bool open(const std::string &path);
+
+    template <typename T> std::span<const T> get(int section) const
+    {
+        const BakedSection &entry = header->sections[section];
+        assert(entry.size == entry.count * sizeof(T));
+        return std::span<const T>(reinterpret_cast<const T *>(file.data + entry.offset), entry.count);
+    }
+
+    template <typename T> std::span<const T> get(int section, BakedRange range) const
+    {
+        return get<T>(section).subspan(range.first, range.count);
+    }
+};
+
+// write time and size of a source file, 0 if it doesn't exist.
+int64_t get_source_time(const std::string &path);
+uint64_t get_source_size(const std::string &path);
+
+// the .bake path next to a source file (eg. scene_1.gltf -> scene_1.bake).
+std::string get_baked_path(const std::string &source_path);
+
+// opens the bake of a source file if there is one and it was made from the current source.
+// returns nullptr if it needs (re)baking, the caller falls back to loading the source.
+std::shared_ptr<BakedAsset> open_baked(const std::string &source_path);
+
+// offline baking (see tools/bake.cpp), both write next to the source. return false on failure.
+bool bake_model(const std::string &filename);       // a .gltf in the models folder.
+bool bake_skybox(int level_index);                  // the six faces of a skybox folder.
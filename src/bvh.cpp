@@ -0,0 +1,637 @@
+#include "bvh.hpp"
+#include <cassert>      // traversal stack overflow check.
+#include <algorithm>    // std::max, std::nth_element.
+
+// aabb functions.
+// grow the box so it contains the point.
+void AABB::expand(glm::vec3 point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+// returns a copy of the box grown by margin on every side.
+AABB AABB::fattened(float margin) const
+{
+    return AABB(min - glm::vec3(margin), max + glm::vec3(margin));
+}
+
+// returns the box that covers this box moving along the movement vector.
+AABB AABB::swept(glm::vec3 movement) const
+{
+    return AABB(glm::min(min, min + movement), glm::max(max, max + movement));
+}
+
+bool AABB::overlaps(const AABB &other) const
+{
+    return (min.x <= other.max.x) && (max.x >= other.min.x) &&
+           (min.y <= other.max.y) && (max.y >= other.min.y) &&
+           (min.z <= other.max.z) && (max.z >= other.min.z);
+}
+
+bool AABB::contains(const AABB &other) const
+{
+    return (min.x <= other.min.x) && (min.y <= other.min.y) && (min.z <= other.min.z) &&
+           (max.x >= other.max.x) && (max.y >= other.max.y) && (max.z >= other.max.z);
+}
+
+// slab test: the ray is inside the box between the last entry into and the first exit from each pair of planes.
+// takes 1 / direction so a batch of boxes can share the divide, zero components become infinity and still work.
+bool AABB::intersects_ray(glm::vec3 origin, glm::vec3 inverse_direction, float length) const
+{
+    glm::vec3 t0    = (min - origin) * inverse_direction;
+    glm::vec3 t1    = (max - origin) * inverse_direction;
+    glm::vec3 t_min = glm::min(t0, t1);
+    glm::vec3 t_max = glm::max(t0, t1);
+    float enter     = std::max(std::max(t_min.x, t_min.y), std::max(t_min.z, 0.0f));
+    float leave     = std::min(std::min(t_max.x, t_max.y), std::min(t_max.z, length));
+    return enter <= leave;
+}
+
+// surface area is used as the insertion cost, smaller total area = fewer overlaps when querying.
+float AABB::surface_area() const
+{
+    glm::vec3 size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+// returns the box that covers this box with the matrix applied to it.
+AABB AABB::transformed(const glm::mat4 &matrix) const
+{
+    if (is_empty())
+    {
+        return *this;
+    }
+    glm::vec3 centre    = glm::vec3(matrix * glm::vec4((min + max) * 0.5f, 1.0f));
+    glm::vec3 extent    = (max - min) * 0.5f;
+    glm::vec3 reach     = glm::abs(glm::vec3(matrix[0])) * extent.x + glm::abs(glm::vec3(matrix[1])) * extent.y + glm::abs(glm::vec3(matrix[2])) * extent.z;
+    return AABB(centre - reach, centre + reach);
+}
+
+AABB combine(const AABB &a, const AABB &b)
+{
+    return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+}
+
+// bvh functions.
+// add a proxy to the tree, returns the id needed to move/remove it later.
+int BVH::insert(const AABB &bounds, int user_index)
+{
+    int proxy                   = allocate_node();
+    nodes[proxy].bounds         = bounds;
+    nodes[proxy].user_index     = user_index;
+    nodes[proxy].height         = 0;
+
+    insert_leaf(proxy);
+    proxy_count++;
+    return proxy;
+}
+
+void BVH::remove(int proxy)
+{
+    assert(nodes[proxy].is_leaf());
+
+    remove_leaf(proxy);
+    free_node(proxy);
+    proxy_count--;
+}
+
+// only reinserts the proxy if it has left its fattened bounds. returns true if the tree changed.
+bool BVH::move(int proxy, const AABB &bounds)
+{
+    assert(nodes[proxy].is_leaf());
+
+    if (nodes[proxy].bounds.contains(bounds))
+    {
+        return false;
+    }
+
+    remove_leaf(proxy);
+    nodes[proxy].bounds = bounds.fattened(BVH_FAT_MARGIN);
+    insert_leaf(proxy);
+    return true;
+}
+
+void BVH::clear()
+{
+    nodes.clear();
+    root        = BVH_NULL_NODE;
+    free_list   = BVH_NULL_NODE;
+    proxy_count = 0;
+}
+
+// appends the user index of every leaf that overlaps bounds.
+// results is not cleared, so callers can reuse the same vector without reallocating.
+void BVH::query(const AABB &bounds, std::vector<int> &results) const
+{
+    if (root == BVH_NULL_NODE)
+    {
+        return;
+    }
+
+    int stack[BVH_STACK_SIZE];
+    int stack_count     = 0;
+    stack[stack_count]  = root;
+    stack_count++;
+
+    while (stack_count > 0)
+    {
+        stack_count--;
+        const BVHNode &node = nodes[stack[stack_count]];
+
+        if (!node.bounds.overlaps(bounds))
+        {
+            continue;
+        }
+
+        if (node.is_leaf())
+        {
+            results.push_back(node.user_index);
+        }
+        else
+        {
+            assert(stack_count + 2 <= BVH_STACK_SIZE);
+            stack[stack_count]      = node.left;
+            stack[stack_count + 1]  = node.right;
+            stack_count             += 2;
+        }
+    }
+}
+
+// appends the user index of every leaf the ray passes through before length.
+void BVH::query_ray(glm::vec3 origin, glm::vec3 direction, float length, std::vector<int> &results) const
+{
+    if (root == BVH_NULL_NODE)
+    {
+        return;
+    }
+
+    glm::vec3 inverse_direction = 1.0f / direction;
+
+    int stack[BVH_STACK_SIZE];
+    int stack_count     = 0;
+    stack[stack_count]  = root;
+    stack_count++;
+
+    while (stack_count > 0)
+    {
+        stack_count--;
+        const BVHNode &node = nodes[stack[stack_count]];
+
+        if (!node.bounds.intersects_ray(origin, inverse_direction, length))
+        {
+            continue;
+        }
+
+        if (node.is_leaf())
+        {
+            results.push_back(node.user_index);
+        }
+        else
+        {
+            assert(stack_count + 2 <= BVH_STACK_SIZE);
+            stack[stack_count]      = node.left;
+            stack[stack_count + 1]  = node.right;
+            stack_count             += 2;
+        }
+    }
+}
+
+int BVH::get_height() const
+{
+    return (root == BVH_NULL_NODE) ? 0 : nodes[root].height;
+}
+
+// pop a node off the free list, or grow the pool if there are none.
+int BVH::allocate_node()
+{
+    if (free_list == BVH_NULL_NODE)
+    {
+        nodes.push_back(BVHNode());
+        return static_cast<int>(nodes.size()) - 1;
+    }
+
+    int index       = free_list;
+    free_list       = nodes[index].parent;
+    nodes[index]    = BVHNode();
+    return index;
+}
+
+void BVH::free_node(int index)
+{
+    nodes[index].parent = free_list;
+    nodes[index].height = -1;
+    free_list           = index;
+}
+
+void BVH::insert_leaf(int leaf)
+{
+    if (root == BVH_NULL_NODE)
+    {
+        root                = leaf;
+        nodes[root].parent  = BVH_NULL_NODE;
+        return;
+    }
+
+    // find the best sibling for the new leaf by walking down the cheapest branch.
+    AABB leaf_bounds    = nodes[leaf].bounds;
+    int index           = root;
+
+    while (!nodes[index].is_leaf())
+    {
+        int left                = nodes[index].left;
+        int right               = nodes[index].right;
+        float area              = nodes[index].bounds.surface_area();
+        float combined_area     = combine(nodes[index].bounds, leaf_bounds).surface_area();
+
+        // cost of creating a new parent for this node and the new leaf.
+        float cost              = 2.0f * combined_area;
+
+        // minimum cost of pushing the leaf further down the tree.
+        float inheritance_cost  = 2.0f * (combined_area - area);
+
+        // cost of descending into either child.
+        float cost_left         = combine(leaf_bounds, nodes[left].bounds).surface_area() + inheritance_cost;
+        float cost_right        = combine(leaf_bounds, nodes[right].bounds).surface_area() + inheritance_cost;
+
+        if (!nodes[left].is_leaf())
+        {
+            cost_left -= nodes[left].bounds.surface_area();
+        }
+        if (!nodes[right].is_leaf())
+        {
+            cost_right -= nodes[right].bounds.surface_area();
+        }
+
+        // descend according to the minimum cost.
+        if ((cost < cost_left) && (cost < cost_right))
+        {
+            break;
+        }
+        index = (cost_left < cost_right) ? left : right;
+    }
+
+    // create a new parent for the sibling and the leaf.
+    int sibling                 = index;
+    int old_parent              = nodes[sibling].parent;
+    int new_parent              = allocate_node();
+    nodes[new_parent].parent    = old_parent;
+    nodes[new_parent].bounds    = combine(leaf_bounds, nodes[sibling].bounds);
+    nodes[new_parent].height    = nodes[sibling].height + 1;
+    nodes[new_parent].left      = sibling;
+    nodes[new_parent].right     = leaf;
+    nodes[sibling].parent       = new_parent;
+    nodes[leaf].parent          = new_parent;
+
+    if (old_parent != BVH_NULL_NODE)
+    {
+        if (nodes[old_parent].left == sibling)
+        {
+            nodes[old_parent].left = new_parent;
+        }
+        else
+        {
+            nodes[old_parent].right = new_parent;
+        }
+    }
+    else
+    {
+        root = new_parent;
+    }
+
+    // walk back up the tree fixing heights and bounds.
+    index = nodes[leaf].parent;
+    while (index != BVH_NULL_NODE)
+    {
+        index                   = balance(index);
+        int left                = nodes[index].left;
+        int right               = nodes[index].right;
+        nodes[index].height     = 1 + std::max(nodes[left].height, nodes[right].height);
+        nodes[index].bounds     = combine(nodes[left].bounds, nodes[right].bounds);
+        index                   = nodes[index].parent;
+    }
+}
+
+void BVH::remove_leaf(int leaf)
+{
+    if (leaf == root)
+    {
+        root = BVH_NULL_NODE;
+        return;
+    }
+
+    int parent          = nodes[leaf].parent;
+    int grand_parent    = nodes[parent].parent;
+    int sibling         = (nodes[parent].left == leaf) ? nodes[parent].right : nodes[parent].left;
+
+    if (grand_parent != BVH_NULL_NODE)
+    {
+        // destroy parent and connect sibling to grand parent.
+        if (nodes[grand_parent].left == parent)
+        {
+            nodes[grand_parent].left = sibling;
+        }
+        else
+        {
+            nodes[grand_parent].right = sibling;
+        }
+        nodes[sibling].parent = grand_parent;
+        free_node(parent);
+
+        // adjust ancestor bounds.
+        int index = grand_parent;
+        while (index != BVH_NULL_NODE)
+        {
+            index                   = balance(index);
+            int left                = nodes[index].left;
+            int right               = nodes[index].right;
+            nodes[index].bounds     = combine(nodes[left].bounds, nodes[right].bounds);
+            nodes[index].height     = 1 + std::max(nodes[left].height, nodes[right].height);
+            index                   = nodes[index].parent;
+        }
+    }
+    else
+    {
+        root                    = sibling;
+        nodes[sibling].parent   = BVH_NULL_NODE;
+        free_node(parent);
+    }
+}
+
+// perform a left or right rotation if node a is imbalanced. returns the new root index of the subtree.
+int BVH::balance(int index_a)
+{
+    BVHNode &a = nodes[index_a];
+    if (a.is_leaf() || (a.height < 2))
+    {
+        return index_a;
+    }
+
+    int index_b     = a.left;
+    int index_c     = a.right;
+    BVHNode &b      = nodes[index_b];
+    BVHNode &c      = nodes[index_c];
+    int difference  = c.height - b.height;
+
+    // rotate c up.
+    if (difference > 1)
+    {
+        int index_f = c.left;
+        int index_g = c.right;
+        BVHNode &f  = nodes[index_f];
+        BVHNode &g  = nodes[index_g];
+
+        // swap a and c.
+        c.left      = index_a;
+        c.parent    = a.parent;
+        a.parent    = index_c;
+
+        // a's old parent should point to c.
+        if (c.parent != BVH_NULL_NODE)
+        {
+            if (nodes[c.parent].left == index_a)
+            {
+                nodes[c.parent].left = index_c;
+            }
+            else
+            {
+                nodes[c.parent].right = index_c;
+            }
+        }
+        else
+        {
+            root = index_c;
+        }
+
+        // rotate.
+        if (f.height > g.height)
+        {
+            c.right     = index_f;
+            a.right     = index_g;
+            g.parent    = index_a;
+            a.bounds    = combine(b.bounds, g.bounds);
+            c.bounds    = combine(a.bounds, f.bounds);
+            a.height    = 1 + std::max(b.height, g.height);
+            c.height    = 1 + std::max(a.height, f.height);
+        }
+        else
+        {
+            c.right     = index_g;
+            a.right     = index_f;
+            f.parent    = index_a;
+            a.bounds    = combine(b.bounds, f.bounds);
+            c.bounds    = combine(a.bounds, g.bounds);
+            a.height    = 1 + std::max(b.height, f.height);
+            c.height    = 1 + std::max(a.height, g.height);
+        }
+        return index_c;
+    }
+
+    // rotate b up.
+    if (difference < -1)
+    {
+        int index_d = b.left;
+        int index_e = b.right;
+        BVHNode &d  = nodes[index_d];
+        BVHNode &e  = nodes[index_e];
+
+        // swap a and b.
+        b.left      = index_a;
+        b.parent    = a.parent;
+        a.parent    = index_b;
+
+        // a's old parent should point to b.
+        if (b.parent != BVH_NULL_NODE)
+        {
+            if (nodes[b.parent].left == index_a)
+            {
+                nodes[b.parent].left = index_b;
+            }
+            else
+            {
+                nodes[b.parent].right = index_b;
+            }
+        }
+        else
+        {
+            root = index_b;
+        }
+
+        // rotate.
+        if (d.height > e.height)
+        {
+            b.right     = index_d;
+            a.left      = index_e;
+            e.parent    = index_a;
+            a.bounds    = combine(c.bounds, e.bounds);
+            b.bounds    = combine(a.bounds, d.bounds);
+            a.height    = 1 + std::max(c.height, e.height);
+            b.height    = 1 + std::max(a.height, d.height);
+        }
+        else
+        {
+            b.right     = index_e;
+            a.left      = index_d;
+            d.parent    = index_a;
+            a.bounds    = combine(c.bounds, d.bounds);
+            b.bounds    = combine(a.bounds, e.bounds);
+            a.height    = 1 + std::max(c.height, d.height);
+            b.height    = 1 + std::max(a.height, e.height);
+        }
+        return index_b;
+    }
+
+    return index_a;
+}
+
+// static bvh functions.
+// build the tree over every item, replaces whatever was there before.
+void StaticBVH::build(const std::vector<AABB> &item_bounds)
+{
+    node_storage.clear();
+    item_storage.resize(item_bounds.size());
+    nodes = node_storage;
+    items = item_storage;
+    if (item_bounds.empty())
+    {
+        return;
+    }
+
+    // splitting by centres rather than boxes keeps items that span the split on one side only.
+    std::vector<glm::vec3> centres(item_bounds.size());
+    for (size_t i = 0; i < item_bounds.size(); ++i)
+    {
+        item_storage[i] = static_cast<int>(i);
+        centres[i]      = (item_bounds[i].min + item_bounds[i].max) * 0.5f;
+    }
+
+    node_storage.reserve(2 * (item_bounds.size() / BVH_LEAF_SIZE + 1));
+    build_node(item_bounds, centres, 0, static_cast<int>(item_bounds.size()));
+    nodes = node_storage;
+}
+
+// appends the index of every item whose leaf overlaps bounds, same as BVH::query.
+void StaticBVH::query(const AABB &bounds, std::vector<int> &results) const
+{
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    int stack[BVH_STACK_SIZE];
+    int stack_count     = 0;
+    stack[stack_count]  = 0;
+    stack_count++;
+
+    while (stack_count > 0)
+    {
+        stack_count--;
+        int index                   = stack[stack_count];
+        const StaticBVHNode &node   = nodes[index];
+
+        if (!node.bounds.overlaps(bounds))
+        {
+            continue;
+        }
+
+        if (node.is_leaf())
+        {
+            results.insert(results.end(), items.begin() + node.first, items.begin() + node.first + node.count);
+        }
+        else
+        {
+            assert(stack_count + 2 <= BVH_STACK_SIZE);
+            stack[stack_count]      = node.first;
+            stack[stack_count + 1]  = index + 1;
+            stack_count             += 2;
+        }
+    }
+}
+
+// appends the index of every item in a leaf the ray passes through before length.
+void StaticBVH::query_ray(glm::vec3 origin, glm::vec3 direction, float length, std::vector<int> &results) const
+{
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    glm::vec3 inverse_direction = 1.0f / direction;
+
+    int stack[BVH_STACK_SIZE];
+    int stack_count     = 0;
+    stack[stack_count]  = 0;
+    stack_count++;
+
+    while (stack_count > 0)
+    {
+        stack_count--;
+        int index                   = stack[stack_count];
+        const StaticBVHNode &node   = nodes[index];
+
+        if (!node.bounds.intersects_ray(origin, inverse_direction, length))
+        {
+            continue;
+        }
+
+        if (node.is_leaf())
+        {
+            results.insert(results.end(), items.begin() + node.first, items.begin() + node.first + node.count);
+        }
+        else
+        {
+            assert(stack_count + 2 <= BVH_STACK_SIZE);
+            stack[stack_count]      = node.first;
+            stack[stack_count + 1]  = index + 1;
+            stack_count             += 2;
+        }
+    }
+}
+
+int StaticBVH::get_height() const
+{
+    // balanced, so the left edge is as deep as any other path (give or take one).
+    int height = 0;
+    for (size_t index = 0; (index < nodes.size()) && !nodes[index].is_leaf(); ++index)
+    {
+        height++;
+    }
+    return height;
+}
+
+// build the subtree over items[first, first + count). returns the index of its root node.
+int StaticBVH::build_node(const std::vector<AABB> &item_bounds, const std::vector<glm::vec3> &centres, int first, int count)
+{
+    int index = static_cast<int>(node_storage.size());
+    node_storage.push_back(StaticBVHNode());
+
+    AABB bounds;
+    AABB centre_bounds;
+    for (int i = first; i < first + count; ++i)
+    {
+        bounds          = combine(bounds, item_bounds[item_storage[i]]);
+        centre_bounds.expand(centres[item_storage[i]]);
+    }
+    node_storage[index].bounds = bounds;
+
+    if (count <= BVH_LEAF_SIZE)
+    {
+        node_storage[index].first   = first;
+        node_storage[index].count   = count;
+        return index;
+    }
+
+    // split at the median centre along the widest axis.
+    glm::vec3 extent    = centre_bounds.max - centre_bounds.min;
+    int axis            = (extent.x > extent.y) ? ((extent.x > extent.z) ? 0 : 2) : ((extent.y > extent.z) ? 1 : 2);
+    int half            = count / 2;
+    std::nth_element(item_storage.begin() + first, item_storage.begin() + first + half, item_storage.begin() + first + count,
+        [&centres, axis](int a, int b) { return centres[a][axis] < centres[b][axis]; });
+
+    // left child is built first so it lands at index + 1.
+    build_node(item_bounds, centres, first, half);
+    int right                   = build_node(item_bounds, centres, first + half, count - half);
+    node_storage[index].first   = right;
+    node_storage[index].count   = 0;
+    return index;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vector>       // node pool and query results.
+#include <span>         // static trees can point at baked nodes.
+#include <cfloat>       // FLT_MAX for empty bounds.
+#include <glm/glm.hpp>
+
+#define BVH_NULL_NODE   -1      // marks an empty parent/child link.
+#define BVH_STACK_SIZE  256     // max traversal stack depth during queries.
+#define BVH_FAT_MARGIN  0.1f    // extra space around moving proxies so small moves don't reinsert.
+#define BVH_LEAF_SIZE   4       // max items in a static bvh leaf.
+
+// axis aligned bounding box.
+struct AABB
+{
+    glm::vec3 min = glm::vec3( FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    // constructors.
+    AABB() {}
+    AABB(glm::vec3 min, glm::vec3 max) : min(min), max(max) {}
+
+    void expand(glm::vec3 point);
+    AABB fattened(float margin) const;
+    AABB swept(glm::vec3 movement) const;
+    bool overlaps(const AABB &other) const;
+    bool contains(const AABB &other) const;
+    bool intersects_ray(glm::vec3 origin, glm::vec3 inverse_direction, float length) const;
+    float surface_area() const;
+    AABB transformed(const glm::mat4 &matrix) const;
+    bool is_empty() const { return min.x > max.x; }
+};
+
+// returns the smallest box that encloses both inputs.
+AABB combine(const AABB &a, const AABB &b);
+
+// a single node in the tree. leaves hold a user index, branches always have two children.
+struct BVHNode
+{
+    AABB bounds;
+    int parent      = BVH_NULL_NODE;    // doubles as the 'next' link while the node is in the free list.
+    int left        = BVH_NULL_NODE;
+    int right       = BVH_NULL_NODE;
+    int height      = -1;               // leaf = 0, free node = -1.
+    int user_index  = -1;               // index into whatever array owns the proxies (eg level colliders).
+
+    bool is_leaf() const { return left == BVH_NULL_NODE; }
+};
+
+// dynamic aabb tree used as the collision broad phase.
+// based on the tree from box2d: https://github.com/erincatto/box2d/blob/main/src/collision/b2_dynamic_tree.cpp
+// leaves are inserted using a surface area cost heuristic and branches are kept balanced with rotations.
+struct BVH
+{
+    std::vector<BVHNode> nodes;         // node pool, freed nodes are reused through free_list.
+    int root        = BVH_NULL_NODE;
+    int free_list   = BVH_NULL_NODE;
+    int proxy_count = 0;
+
+    int insert(const AABB &bounds, int user_index);
+    void remove(int proxy);
+    bool move(int proxy, const AABB &bounds);
+    void clear();
+    void query(const AABB &bounds, std::vector<int> &results) const;
+    void query_ray(glm::vec3 origin, glm::vec3 direction, float length, std::vector<int> &results) const;
+    int get_height() const;
+
+private:
+    int allocate_node();
+    void free_node(int index);
+    void insert_leaf(int leaf);
+    void remove_leaf(int leaf);
+    int balance(int index);
+};
+
+// node of a static tree, stored depth first so the left child always directly follows its parent.
+struct StaticBVHNode
+{
+    AABB bounds;
+    int first   = 0;    // leaf: first entry in the item list. branch: index of the right child.
+    int count   = 0;    // items in the leaf, 0 for a branch.
+
+    bool is_leaf() const { return count > 0; }
+};
+
+// bvh built once over items that never move (eg the triangles of a level mesh).
+// built top down by splitting at the median along the widest axis, so it's always balanced.
+// no insert/remove, but it's a flat array with no parent links, so queries touch less memory than the dynamic tree.
+// the nodes and items are spans, either over the tree build() made or over a baked one (see asset.hpp) left in the bake.
+struct StaticBVH
+{
+    std::span<const StaticBVHNode> nodes;
+    std::span<const int> items;         // item indices, each leaf owns a contiguous run.
+
+    // constructors. a built tree's spans point into its own storage, which a move keeps but a copy wouldn't.
+    StaticBVH() {}
+    StaticBVH(std::span<const StaticBVHNode> nodes, std::span<const int> items) : nodes(nodes), items(items) {}
+    StaticBVH(StaticBVH &&) = default;
+    StaticBVH &operator=(StaticBVH &&) = default;
+    StaticBVH(const StaticBVH &) = delete;
+    StaticBVH &operator=(const StaticBVH &) = delete;
+
+    void build(const std::vector<AABB> &item_bounds);
+    void query(const AABB &bounds, std::vector<int> &results) const;
+    void query_ray(glm::vec3 origin, glm::vec3 direction, float length, std::vector<int> &results) const;
+    int get_height() const;
+
+private:
+    std::vector<StaticBVHNode> node_storage;    // filled by build(), unused by a baked tree.
+    std::vector<int> item_storage;
+
+    int build_node(const std::vector<AABB> &item_bounds, const std::vector<glm::vec3> &centres, int first, int count);
+};
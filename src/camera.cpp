@@ -159,4 +159,34 @@ void Camera::get_cascades()
         glm::mat4 light_proj    = glm::ortho(-radius, radius, -radius, radius, -radius * 2.0f, radius * 2.0f);
         cascade_proj[i]         = light_proj * light_view;
     }
-}
\ No newline at end of file
+}
+
+// the planes come from the rows of the matrix (gribb & hartmann).
+FrustumPlanes::FrustumPlanes(const glm::mat4 &view_projection)
+{
+    glm::mat4 rows = glm::transpose(view_projection);
+    planes[0] = rows[3] + rows[0];  // left.
+    planes[1] = rows[3] - rows[0];  // right.
+    planes[2] = rows[3] + rows[1];  // bottom.
+    planes[3] = rows[3] - rows[1];  // top.
+    planes[4] = rows[3] - rows[2];  // far.
+}
+
+// false only if the box is entirely outside one of the planes, so some boxes near the corners get through.
+bool FrustumPlanes::intersects(const AABB &box) const
+{
+    for (const glm::vec4 &plane : planes)
+    {
+        // the corner furthest along the plane's normal.
+        glm::vec3 corner = glm::vec3(
+            (plane.x > 0.0f) ? box.max.x : box.min.x,
+            (plane.y > 0.0f) ? box.max.y : box.min.y,
+            (plane.z > 0.0f) ? box.max.z : box.min.z);
+
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
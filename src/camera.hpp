@@ -8,6 +8,17 @@
 #include "glm/gtx/vector_angle.hpp"         // glm::orientedAngle().
 
 #include "defines.hpp"
+#include "bvh.hpp"                          // culling bounds.
+
+// the sides and far end of a view projection's frustum, for culling. there's no near plane:
+// depth clamping draws (and shadows) everything in front of it anyway.
+struct FrustumPlanes
+{
+    std::array<glm::vec4, 5> planes;    // normals point inwards.
+
+    FrustumPlanes(const glm::mat4 &view_projection);
+    bool intersects(const AABB &box) const;
+};
 
 struct CameraRail
 {
@@ -1,5 +1,7 @@
 #include "collision.hpp"
 #include <iostream>     // file loading.
+#include <algorithm>    // std::max, std::swap.
+#include <atomic>       // collider ids.
 
 using std::cout;
 using glm::vec3;
@@ -10,7 +12,7 @@ glm::vec3 Support(const Collider *a, const Collider *b, glm::vec3 direction)
     return a->furthest_point(direction) - b->furthest_point(-direction);
 }
 
-bool line(std::vector<glm::vec3> &simplex, glm::vec3 &direction)
+bool line(Simplex &simplex, glm::vec3 &direction)
 {
     // a is always the point that has just been added (end of the vector).
     // b cannot be the closest point as it is the already existing point in the simplex.
@@ -36,7 +38,7 @@ bool line(std::vector<glm::vec3> &simplex, glm::vec3 &direction)
     return false;
 }
 
-bool triangle(std::vector<glm::vec3> &simplex, glm::vec3 &direction)
+bool triangle(Simplex &simplex, glm::vec3 &direction)
 {
     // a is the new point.
     vec3 a      = simplex[2];
@@ -84,7 +86,7 @@ bool triangle(std::vector<glm::vec3> &simplex, glm::vec3 &direction)
     return false;
 }
 
-bool tetrahedron(std::vector<glm::vec3> &simplex, glm::vec3 &direction)
+bool tetrahedron(Simplex &simplex, glm::vec3 &direction)
 {
     vec3 a  = simplex[3];
     vec3 b  = simplex[2];
@@ -124,7 +126,7 @@ bool tetrahedron(std::vector<glm::vec3> &simplex, glm::vec3 &direction)
 }
 
 // determine simplex case to query based on the number of points.
-bool do_simplex(std::vector<glm::vec3> &simplex, glm::vec3 &direction)
+bool do_simplex(Simplex &simplex, glm::vec3 &direction)
 {   
     switch (simplex.size())
     {
@@ -137,13 +139,25 @@ bool do_simplex(std::vector<glm::vec3> &simplex, glm::vec3 &direction)
 }
 
 // boolean GJK function that returns true if two colliders intersect.
-bool GJK(const Collider *a, const Collider *b, std::vector<glm::vec3> &simplex)
+// contact is the cached result of the last query of this pair, or null to start from scratch.
+bool GJK(const Collider *a, const Collider *b, Simplex &simplex, ContactCacheEntry *contact, CollisionStats *stats)
 {
     // start with any point in the minkowski difference,
     // can either be arbitray (1,0,0) or between the two colliders positions (faster?).
-    glm::vec3 direction = glm::vec3(1.0f, 0.0f, 0.0f);
+    // a cached pair starts from last query's axis instead.
+    glm::vec3 direction = contact ? contact->axis : glm::vec3(1.0f, 0.0f, 0.0f);
     glm::vec3 support   = Support(a, b, direction);
 
+    // a separating axis from the previous query usually still separates the pair, so one support is enough.
+    if (contact && contact->separated && (glm::dot(support, direction) < 0.0f))
+    {
+        if (stats)
+        {
+            stats->gjk_early_outs++;
+        }
+        return false;
+    }
+
     // if support is the origin, no intersection?
     if (is_vec3_zero(support))
     {
@@ -156,9 +170,19 @@ bool GJK(const Collider *a, const Collider *b, std::vector<glm::vec3> &simplex)
     // rather than using while (true), this prevents infinite loops when dealing with curved surfaces.
     for (unsigned int i = 0; i < GJK_MAX_ITERATIONS; ++i)
     {
+        if (stats)
+        {
+            stats->gjk_iterations++;
+        }
         support = Support(a, b, direction);         // get a new support point using the current search direction.
         if (glm::dot(support, direction) < 0.0f)    // no intersection if origin is beyond support point.
         {
+            // direction is a separating axis, remember it for next time.
+            if (contact)
+            {
+                contact->axis       = direction;
+                contact->separated  = true;
+            }
             break;
         }
         simplex.push_back(support);                 // insert new support into simplex.
@@ -171,184 +195,1042 @@ bool GJK(const Collider *a, const Collider *b, std::vector<glm::vec3> &simplex)
 }
 
 // EPA stuff begins here.
-void add_to_polytope(Polytope &polytope, const Face face)
-{    
-    assert(polytope.face_count < EPA_MAX_FACES);
+// polytope functions.
+int Polytope::add_vertex(glm::vec3 point)
+{
+    if (vertex_count >= EPA_MAX_VERTICES)
+    {
+        overflow = true;
+        return -1;
+    }
+    vertices[vertex_count] = point;
+    return vertex_count++;
+}
 
-    // add face to array and increase face count.
-    polytope.faces[polytope.face_count] = face;
-    polytope.face_count++;
+// creates the face and puts it in the heap, neighbours are left for the caller to link up.
+int Polytope::add_face(int a, int b, int c)
+{
+    int index;
+    if (free_count > 0)
+    {
+        free_count--;
+        index = free_faces[free_count];
+    }
+    else if (face_count < EPA_MAX_FACES)
+    {
+        index = face_count;
+        face_count++;
+    }
+    else
+    {
+        overflow = true;
+        return -1;
+    }
+
+    Face &face      = faces[index];
+    face.vertex     = {a, b, c};
+    face.neighbour  = {-1, -1, -1};
+    face.mark       = 0;
+    face.normal     = glm::cross(vertices[b] - vertices[a], vertices[c] - vertices[a]);
+
+    // slivers have no usable normal, they stay in the polytope but are never picked as the closest face.
+    float length = glm::length(face.normal);
+    if (length > 0.0f)
+    {
+        face.normal     /= length;
+        face.distance   = glm::dot(face.normal, vertices[a]);
+    }
+    else
+    {
+        face.normal     = glm::vec3(0.0f);
+        face.distance   = FLT_MAX;
+    }
+
+    face.heap_index     = heap_count;
+    heap[heap_count]    = index;
+    heap_count++;
+    sift_up(face.heap_index);
+    return index;
 }
 
-// gets the face inside the polytope that is closest to the origin.
-Face get_closest_face(const Polytope &polytope)
+// takes the face out of the heap and frees its slot. the face data is left alone
+// so the horizon search can still walk across it until new faces are added.
+void Polytope::remove_face(int face)
 {
-    Face closest_face       = polytope.faces[0];
-    closest_face.distance   = FLT_MAX;
-    // closest_face.normal     = closest_face.normal;
+    int index = faces[face].heap_index;
+    heap_count--;
+    if (index != heap_count)
+    {
+        heap_swap(index, heap_count);
+        sift_up(index);
+        sift_down(index);
+    }
+    faces[face].heap_index  = -1;
+    free_faces[free_count]  = face;
+    free_count++;
+}
 
-    // check every face in the polytope.
-    for (size_t i = 0; i < polytope.face_count; ++i)
+// remove every face the vertex can see and fill the hole with a fan of faces to the vertex.
+// returns false if the polytope ran out of space.
+bool Polytope::expand(int face, int vertex)
+{
+    mark++;
+    horizon_count = 0;
+    find_horizon(face, -1, vertices[vertex]);
+    if (overflow)
     {
-        // get a new face to compare against closest face.
-        Face face       = polytope.faces[i];
-        face.distance   = glm::dot(face.point[0], face.normal);
+        return false;
+    }
+
+    // one new face per horizon edge, attached to the face being kept on the other side.
+    std::array<int, EPA_MAX_EDGES> created;
+    for (int i = 0; i < horizon_count; ++i)
+    {
+        const HorizonEdge &edge = horizon[i];
+        created[i]              = add_face(edge.a, edge.b, vertex);
+        if (created[i] < 0)
+        {
+            return false;
+        }
 
-        // if new face is closer than current face, set it as the closest face.
-        if (face.distance < closest_face.distance)
+        faces[created[i]].neighbour[0] = edge.face;
+        for (int k = 0; k < 3; ++k)
         {
-            closest_face = face;
+            if ((faces[edge.face].vertex[k] == edge.b) && (faces[edge.face].vertex[(k + 1) % 3] == edge.a))
+            {
+                faces[edge.face].neighbour[k] = created[i];
+            }
         }
     }
-    
-    assert(closest_face.distance < FLT_MAX);
-    return closest_face;
+
+    // new faces share their other two edges with each other.
+    for (int i = 0; i < horizon_count; ++i)
+    {
+        for (int j = 0; j < horizon_count; ++j)
+        {
+            if (horizon[j].a == horizon[i].b) { faces[created[i]].neighbour[1] = created[j]; }
+            if (horizon[j].b == horizon[i].a) { faces[created[i]].neighbour[2] = created[j]; }
+        }
+    }
+    return true;
+}
+
+// walk across every face that can see the point, removing them and recording the edges where the visible region ends.
+// entering each face from the edge it was reached by keeps the horizon edges in order.
+void Polytope::find_horizon(int face, int entry_edge, glm::vec3 point)
+{
+    faces[face].mark = mark;
+    remove_face(face);
+
+    for (int i = (entry_edge < 0) ? 0 : 1; i < 3; ++i)
+    {
+        int k           = (entry_edge < 0) ? i : (entry_edge + i) % 3;
+        int neighbour   = faces[face].neighbour[k];
+
+        if (faces[neighbour].mark == mark)
+        {
+            continue;
+        }
+
+        const Face &other = faces[neighbour];
+        if (same_direction(other.normal, point - vertices[other.vertex[0]]))
+        {
+            // find which of the neighbour's edges leads back here.
+            int back_edge = 0;
+            for (int j = 0; j < 3; ++j)
+            {
+                if (other.neighbour[j] == face)
+                {
+                    back_edge = j;
+                }
+            }
+            find_horizon(neighbour, back_edge, point);
+        }
+        else
+        {
+            if (horizon_count >= EPA_MAX_EDGES)
+            {
+                overflow = true;
+                return;
+            }
+            horizon[horizon_count] = {faces[face].vertex[k], faces[face].vertex[(k + 1) % 3], neighbour};
+            horizon_count++;
+        }
+    }
+}
+
+// binary min heap on face distance.
+void Polytope::heap_swap(int i, int j)
+{
+    std::swap(heap[i], heap[j]);
+    faces[heap[i]].heap_index = i;
+    faces[heap[j]].heap_index = j;
+}
+
+void Polytope::sift_up(int index)
+{
+    while (index > 0)
+    {
+        int parent = (index - 1) / 2;
+        if (faces[heap[parent]].distance <= faces[heap[index]].distance)
+        {
+            break;
+        }
+        heap_swap(index, parent);
+        index = parent;
+    }
+}
+
+void Polytope::sift_down(int index)
+{
+    while (true)
+    {
+        int left        = index * 2 + 1;
+        int right       = left + 1;
+        int smallest    = index;
+
+        if ((left < heap_count) && (faces[heap[left]].distance < faces[heap[smallest]].distance))
+        {
+            smallest = left;
+        }
+        if ((right < heap_count) && (faces[heap[right]].distance < faces[heap[smallest]].distance))
+        {
+            smallest = right;
+        }
+        if (smallest == index)
+        {
+            break;
+        }
+        heap_swap(index, smallest);
+        index = smallest;
+    }
 }
 
 // EPA (expanding polytope algorithm)
 // references:  https://github.com/ClysmiC/Cataclysm/blob/master/code/Gjk.cpp
 //              https://github.com/kevinmoran/GJK/blob/master/GJK.h
 //              https://github.com/Another-Ghost/3D-Collision-Detection-and-Resolution-Using-GJK-and-EPA/blob/master/CSC8503/CSC8503Common/GJK.cpp
-Collision EPA(const Collider *collider_a, const Collider *collider_b, std::vector<glm::vec3> &simplex)
+//              http://media.steampowered.com/apps/valve/2015/DirkGregorius_Contacts.pdf (horizon walk).
+Collision EPA(const Collider *collider_a, const Collider *collider_b, Simplex &simplex, CollisionStats *stats)
 {
     // create a polytope from the simplex we got from succesful GJK intersection.
-    vec3 a = simplex[3];
-    vec3 b = simplex[2];
-    vec3 c = simplex[1];
-    vec3 d = simplex[0];
-
     Polytope polytope;
-    add_to_polytope(polytope, Face(a, c, b));
-    add_to_polytope(polytope, Face(a, d, c));
-    add_to_polytope(polytope, Face(a, b, d));
-    add_to_polytope(polytope, Face(b, c, d));
+    int a = polytope.add_vertex(simplex[3]);
+    int b = polytope.add_vertex(simplex[2]);
+    int c = polytope.add_vertex(simplex[1]);
+    int d = polytope.add_vertex(simplex[0]);
 
-    Collision results;  // combined angle of collision * depth.
-    Face closest_face;  // store most recent closest face.
+    // gjk doesn't guarantee the winding, so make sure the faces point away from d.
+    if (same_direction(glm::cross(simplex[1] - simplex[3], simplex[2] - simplex[3]), simplex[0] - simplex[3]))
+    {
+        std::swap(b, c);
+    }
 
-    for (unsigned int i = 0; i < EPA_MAX_ITERATIONS; ++i)
+    int acb = polytope.add_face(a, c, b);
+    int adc = polytope.add_face(a, d, c);
+    int abd = polytope.add_face(a, b, d);
+    int bcd = polytope.add_face(b, c, d);
+    polytope.faces[acb].neighbour = {adc, bcd, abd};
+    polytope.faces[adc].neighbour = {abd, bcd, acb};
+    polytope.faces[abd].neighbour = {acb, bcd, adc};
+    polytope.faces[bcd].neighbour = {acb, adc, abd};
+
+    Collision results;              // combined angle of collision * depth.
+    glm::vec3 closest_normal;       // most recent closest face, kept in case epa doesn't converge.
+    float closest_distance = 0.0f;
+    unsigned int iterations = 0;
+
+    if (stats)
     {
-        closest_face    = get_closest_face(polytope);                           // we get the closest face on the polytope.
-        vec3 support    = Support(collider_a, collider_b, closest_face.normal); // get support in direction of closest face.
-        float distance  = glm::dot(support, closest_face.normal);               // get how far away the face is from the support point.
+        stats->epa_runs++;
+    }
+
+    for (iterations = 0; iterations < EPA_MAX_ITERATIONS; ++iterations)
+    {
+        int closest_face    = polytope.closest_face();
+        closest_normal      = polytope.faces[closest_face].normal;
+        closest_distance    = polytope.faces[closest_face].distance;
+        vec3 support        = Support(collider_a, collider_b, closest_normal);  // get support in direction of closest face.
+        float distance      = glm::dot(support, closest_normal);                // get how far away the face is from the support point.
 
         // if the closest face is within than the distance margin:
-        if (distance - closest_face.distance < EPA_ACCURACY)
+        if (distance - closest_distance < EPA_ACCURACY)
         {
-            results.normal   = closest_face.normal;
+            if (stats)
+            {
+                stats->epa_iterations       += iterations + 1;
+                stats->epa_most_iterations  = std::max(stats->epa_most_iterations, iterations + 1);
+            }
+            results.normal   = closest_normal;
             results.depth    = distance + EPA_ACCURACY;
             return results;
         }
 
         // face is not sufficiently close enough, so expand polytope in support direction.
-        // store edges of removed faces in this array.
-        std::array<std::pair<vec3, vec3>, EPA_MAX_EDGES> edges;
-        int edges_count = 0;
+        int vertex = polytope.add_vertex(support);
+        if ((vertex < 0) || !polytope.expand(closest_face, vertex) || (polytope.heap_count == 0))
+        {
+            break;
+        }
+    }
 
-        // find all triangles that are facing the support.
-        for (size_t i = 0; i < polytope.face_count; ++i)
+    if (stats)
+    {
+        stats->epa_iterations       += iterations;
+        stats->epa_most_iterations  = std::max(stats->epa_most_iterations, iterations);
+        if (polytope.overflow)
         {
-            // check if the face is 'visible' from support, if so needs to be removed.
-            Face face = polytope.faces[i];
-            if (same_direction(face.normal, (support - face.point[0])))
-            {
-                // add edges of removed face to array, then remove any duplicate edges.
-                for (int j = 0; j < 3; ++j)
-                {
-                    std::pair<vec3, vec3> edge  = std::pair<vec3, vec3>(face.point[j], face.point[(j + 1) % 3]);
-                    bool is_duplicate           = false;
+            stats->epa_overflows++;
+        }
+        else
+        {
+            stats->epa_failures++;
+        }
+    }
+    results.normal   = closest_normal;
+    results.depth    = closest_distance + EPA_ACCURACY;
+    return results;
+}
 
-                    // loop through every edge in the edges array.
-                    for (int k = 0; k < edges_count; ++k)
-                    {
-                        // if both points in edge i equal the edge we are checking, remove it.
-                        if (vec3_equals(edges[k].first, edge.second) && vec3_equals(edges[k].second, edge.first))
-                        {
-                            is_duplicate    = true;
-                            edges[k]        = edges[edges_count - 1];
-                            edges_count     --;
-                            k               = edges_count;
-                        }
-                    }
+// contact cache functions.
+uint32_t next_collider_id(uint32_t count)
+{
+    static std::atomic<uint32_t> next_id{1};
+    return next_id.fetch_add(count);
+}
+
+uint32_t assign_collider_ids(Collider &collider, uint32_t first)
+{
+    collider.id = first++;
+    if (TriangleMeshCollider *mesh = dynamic_cast<TriangleMeshCollider *>(&collider))
+    {
+        mesh->first_triangle_id = first;
+        first                   += mesh->get_triangle_count();
+    }
+    return first;
+}
+
+// returns the slot for the pair. hit is false if the slot held a different pair, which is then reset for this one.
+ContactCacheEntry *ContactCache::find(const Collider *a, const Collider *b, bool &hit)
+{
+    ContactCacheEntry &entry = entries[(a->id ^ (b->id * 2654435761u)) & (CONTACT_CACHE_SIZE - 1)];
+
+    hit = (entry.a == a->id) && (entry.b == b->id);
+    if (!hit)
+    {
+        entry   = ContactCacheEntry();
+        entry.a = a->id;
+        entry.b = b->id;
+    }
+    return &entry;
+}
+
+void ContactCache::clear()
+{
+    entries.fill(ContactCacheEntry());
+}
+
+void CollisionStats::add(const CollisionStats &other)
+{
+    queries             += other.queries;
+    gjk_iterations      += other.gjk_iterations;
+    epa_runs            += other.epa_runs;
+    epa_iterations      += other.epa_iterations;
+    epa_most_iterations = std::max(epa_most_iterations, other.epa_most_iterations);
+    epa_failures        += other.epa_failures;
+    epa_overflows       += other.epa_overflows;
+    cache_lookups       += other.cache_lookups;
+    cache_hits          += other.cache_hits;
+    gjk_early_outs      += other.gjk_early_outs;
+    casts               += other.casts;
+    cast_iterations     += other.cast_iterations;
+    triangle_tests      += other.triangle_tests;
+    rays                += other.rays;
+}
+
+// find the pair's entry in the cache, or null if there is no cache.
+static ContactCacheEntry *find_contact(ContactCache *cache, const Collider *a, const Collider *b, CollisionStats *stats)
+{
+    if (!cache)
+    {
+        return nullptr;
+    }
+
+    bool hit                    = false;
+    ContactCacheEntry *contact  = cache->find(a, b, hit);
+    if (stats)
+    {
+        stats->cache_lookups++;
+        stats->cache_hits += hit;
+    }
+    return contact;
+}
+
+// gjk + epa on a convex pair. contact is the pair's warm start data, null to start from nothing.
+static Collision convex_collision(const Collider *a, const Collider *b, ContactCacheEntry *contact, CollisionStats *stats)
+{
+    Collision collision;            // stores the info from collision test.
+    Simplex simplex;                // simplex constructed in GJK step, iterated on in EPA to get penetration.
+
+    if (stats)
+    {
+        stats->queries++;
+    }
+
+    if (GJK(a, b, simplex, contact, stats))
+    {
+        collision            = EPA(a, b, simplex, stats);
+        collision.collided   = true;
+
+        // penetration normal points through the overlap, a good place to start next time.
+        if (contact)
+        {
+            contact->axis       = collision.normal;
+            contact->separated  = false;
+        }
+    }
+    else 
+    {
+        collision.collided   = false;
+    }
+
+    if (a->is_trigger || b->is_trigger)
+    {
+        collision.is_trigger = true;
+    }
+    else
+    {
+        collision.is_trigger = false;
+    }
+
+    return collision;
+}
+
+// triangle mesh functions.
+// the triangle ids are set aside up front, one per index triple, so ids handed out after are the same
+// however the mesh was loaded.
+TriangleMeshCollider::TriangleMeshCollider(std::span<const glm::vec3> vertices, std::span<const uint32_t> indices)
+{
+    is_trigger          = false;
+    first_triangle_id   = next_collider_id(static_cast<uint32_t>(indices.size() / 3));
+    triangle_storage.reserve(indices.size());
+
+    std::vector<AABB> triangle_bounds;
+    triangle_bounds.reserve(indices.size() / 3);
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        TriangleCollider triangle(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]], 0);
+
+        // zero area triangles can't be touched without touching a neighbour first, and only upset gjk.
+        vec3 normal = glm::cross(triangle.vertices[1] - triangle.vertices[0], triangle.vertices[2] - triangle.vertices[0]);
+        if (is_vec3_zero(normal))
+        {
+            continue;
+        }
+
+        triangle_storage.insert(triangle_storage.end(), triangle.vertices.begin(), triangle.vertices.end());
+        triangle_bounds.push_back(triangle.get_bounds());
+        bounds = combine(bounds, triangle_bounds.back());
+    }
+
+    triangles = triangle_storage;
+    tree.build(triangle_bounds);
+}
+
+TriangleMeshCollider::TriangleMeshCollider(std::span<const glm::vec3> triangles, std::span<const StaticBVHNode> nodes, std::span<const int> items, AABB bounds)
+    : triangles(triangles), tree(nodes, items), bounds(bounds)
+{
+    is_trigger          = false;
+    first_triangle_id   = next_collider_id(static_cast<uint32_t>(get_triangle_count()));
+}
+
+const std::vector<int> &TriangleMeshCollider::query(const AABB &query_bounds) const
+{
+    candidates.clear();
+    tree.query(query_bounds, candidates);
+    return candidates;
+}
+
+const std::vector<int> &TriangleMeshCollider::query(const Ray &ray) const
+{
+    candidates.clear();
+    tree.query_ray(ray.origin, ray.direction, ray.length, candidates);
+    return candidates;
+}
+
+// against a triangle mesh the deepest overlapping triangle is the collision.
+// callers already push out and test again until nothing collides, which deals with the rest.
+static Collision mesh_collision(const Collider *a, const TriangleMeshCollider *mesh, CollisionStats *stats, ContactCache *cache)
+{
+    Collision deepest;
+    deepest.normal      = vec3(0.0f);
+    deepest.depth       = 0.0f;
+    deepest.collided    = false;
+    deepest.is_trigger  = a->is_trigger || mesh->is_trigger;
+
+    for (int i : mesh->query(a->get_bounds()))
+    {
+        if (stats)
+        {
+            stats->triangle_tests++;
+        }
+
+        TriangleCollider triangle   = mesh->get_triangle(i);
+        Collision collision         = convex_collision(a, &triangle, find_contact(cache, a, &triangle, stats), stats);
+        if (collision.collided && (!deepest.collided || (collision.depth > deepest.depth)))
+        {
+            deepest             = collision;
+            deepest.is_trigger  = a->is_trigger || mesh->is_trigger;
+        }
+    }
+    return deepest;
+}
+
+Collision is_collision(const Collider *a, const Collider *b, CollisionStats *stats, ContactCache *cache)
+{
+    if (const TriangleMeshCollider *mesh = dynamic_cast<const TriangleMeshCollider *>(b))
+    {
+        return mesh_collision(a, mesh, stats, cache);
+    }
+    return convex_collision(a, b, find_contact(cache, a, b, stats), stats);
+}
+
+// time of impact stuff begins here.
+// closest point on a line segment to the origin. keep gets a bit set for each end the point depends on.
+static glm::vec3 closest_on_segment(glm::vec3 a, glm::vec3 b, int bit_a, int bit_b, int &keep)
+{
+    vec3 ab     = b - a;
+    float t     = glm::dot(-a, ab);
+    float len2  = glm::dot(ab, ab);
+
+    if (t <= 0.0f || len2 <= 0.0f)
+    {
+        keep = bit_a;
+        return a;
+    }
+    if (t >= len2)
+    {
+        keep = bit_b;
+        return b;
+    }
+    keep = bit_a | bit_b;
+    return a + ab * (t / len2);
+}
+
+// closest point on a triangle to the origin, from real-time collision detection (ericson) 5.1.5.
+static glm::vec3 closest_on_triangle(glm::vec3 a, glm::vec3 b, glm::vec3 c, int bit_a, int bit_b, int bit_c, int &keep)
+{
+    vec3 ab     = b - a;
+    vec3 ac     = c - a;
+
+    // vertex regions.
+    float d1    = glm::dot(ab, -a);
+    float d2    = glm::dot(ac, -a);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+    {
+        keep = bit_a;
+        return a;
+    }
+
+    float d3    = glm::dot(ab, -b);
+    float d4    = glm::dot(ac, -b);
+    if (d3 >= 0.0f && d4 <= d3)
+    {
+        keep = bit_b;
+        return b;
+    }
+
+    float d5    = glm::dot(ab, -c);
+    float d6    = glm::dot(ac, -c);
+    if (d6 >= 0.0f && d5 <= d6)
+    {
+        keep = bit_c;
+        return c;
+    }
+
+    // edge regions.
+    float vc    = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+    {
+        keep = bit_a | bit_b;
+        return a + ab * (d1 / (d1 - d3));
+    }
 
-                    // if edge is not duplicate, ie is unique, add it to the edges array.
-                    if (!is_duplicate)
+    float vb    = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+    {
+        keep = bit_a | bit_c;
+        return a + ac * (d2 / (d2 - d6));
+    }
+
+    float va    = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+    {
+        keep = bit_b | bit_c;
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    // face region. a flat triangle has no face, so use whichever edge is closest.
+    float total = va + vb + vc;
+    if (total <= 0.0f)
+    {
+        int keep_ab, keep_ac, keep_bc;
+        vec3 p_ab = closest_on_segment(a, b, bit_a, bit_b, keep_ab);
+        vec3 p_ac = closest_on_segment(a, c, bit_a, bit_c, keep_ac);
+        vec3 p_bc = closest_on_segment(b, c, bit_b, bit_c, keep_bc);
+
+        vec3 closest    = p_ab;
+        keep            = keep_ab;
+        if (glm::dot(p_ac, p_ac) < glm::dot(closest, closest)) { closest = p_ac; keep = keep_ac; }
+        if (glm::dot(p_bc, p_bc) < glm::dot(closest, closest)) { closest = p_bc; keep = keep_bc; }
+        return closest;
+    }
+
+    keep = bit_a | bit_b | bit_c;
+    return a + ab * (vb / total) + ac * (vc / total);
+}
+
+// closest point on the simplex to the origin. keep gets a bit set for each simplex point the result depends on,
+// every other point can be dropped. returns the origin if it is inside a tetrahedron.
+static glm::vec3 closest_on_simplex(const Simplex &simplex, int &keep)
+{
+    switch (simplex.size())
+    {
+        case 1:
+            keep = 1;
+            return simplex[0];
+
+        case 2:
+            return closest_on_segment(simplex[0], simplex[1], 1, 2, keep);
+
+        case 3:
+            return closest_on_triangle(simplex[0], simplex[1], simplex[2], 1, 2, 4, keep);
+
+        default:
+        {
+            // test the triangles the origin is in front of, the point opposite each face says which side is inside.
+            const int faces[4][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+            vec3 closest    = vec3(0.0f);
+            float best      = FLT_MAX;
+            keep            = 15;
+
+            for (const int *face : faces)
+            {
+                vec3 a          = simplex[face[0]];
+                vec3 normal     = glm::cross(simplex[face[1]] - a, simplex[face[2]] - a);
+                float origin    = glm::dot(normal, -a);
+                float opposite  = glm::dot(normal, simplex[face[3]] - a);
+
+                // flat tetrahedrons have no inside, so every face gets tested.
+                if ((origin * opposite < 0.0f) || (opposite == 0.0f))
+                {
+                    int face_keep   = 0;
+                    vec3 point      = closest_on_triangle(a, simplex[face[1]], simplex[face[2]], 1 << face[0], 1 << face[1], 1 << face[2], face_keep);
+                    if (glm::dot(point, point) < best)
                     {
-                        if (edges_count >= EPA_MAX_EDGES)
-                        {
-                            std::cout << "Max edges reached: " << edges_count << "\n";
-                            break;
-                        }
-                        edges[edges_count] = edge;
-                        edges_count++;
+                        best    = glm::dot(point, point);
+                        closest = point;
+                        keep    = face_keep;
                     }
                 }
+            }
+            return closest;
+        }
+    }
+}
+
+// gjk raycast from "ray casting against general convex objects with application to continuous collision detection" (van den bergen).
+// moving a by movement is the same as moving the origin by -movement relative to the minkowski difference a - b,
+// so cast a ray from the origin that way. each step either advances the ray up to a separating plane, or refines
+// the closest point of the shape to the current ray position. touching when that point is within CAST_TOLERANCE.
+static Impact convex_cast(const Collider *a, glm::vec3 movement, const Collider *b, CollisionStats *stats)
+{
+    Impact impact;
+    vec3 ray        = -movement;
+    vec3 position   = vec3(0.0f);               // current point along the ray.
+    vec3 normal     = vec3(0.0f);               // separating direction at the last advance.
+    float lambda    = 0.0f;                     // how far along the ray position is.
+    Simplex points;                             // points of a - b, the closest point to position lies on their hull.
+    vec3 v          = position - Support(a, b, vec3(1.0f, 0.0f, 0.0f));
+
+    if (stats)
+    {
+        stats->casts++;
+    }
+
+    for (unsigned int i = 0; (i < GJK_MAX_ITERATIONS) && (glm::dot(v, v) > CAST_TOLERANCE * CAST_TOLERANCE); ++i)
+    {
+        if (stats)
+        {
+            stats->cast_iterations++;
+        }
+
+        vec3 support    = Support(a, b, v);
+        vec3 w          = position - support;
+
+        // support plane separates the shape from position, so jump ahead to the plane.
+        bool advanced   = false;
+        if (glm::dot(v, w) > 0.0f)
+        {
+            // moving away from (or along) the plane, never going to touch.
+            if (glm::dot(v, ray) >= 0.0f)
+            {
+                return impact;
+            }
 
-                // remove the current face from the polytope, reduce i by 1;
-                polytope.faces[i] = polytope.faces[polytope.face_count - 1];
-                polytope.face_count--;
-                i--;
+            lambda      -= glm::dot(v, w) / glm::dot(v, ray);
+            if (lambda > 1.0f)
+            {
+                return impact;
             }
+            position    = ray * lambda;
+            normal      = v;
+            advanced    = true;
+        }
+
+        // no new support point means no more progress can be made, unless position just moved,
+        // in which case the closest point has to be found again before knowing if the ray hits.
+        bool duplicate = (points.size() == 4);
+        for (size_t j = 0; j < points.size(); ++j)
+        {
+            duplicate = duplicate || vec3_equals(points[j], support);
+        }
+        if (duplicate && !advanced)
+        {
+            break;
+        }
+        if (!duplicate)
+        {
+            points.push_back(support);
+        }
+
+        // the closest point has to be recalculated from position each time as it may have moved.
+
+        Simplex relative;
+        for (size_t j = 0; j < points.size(); ++j)
+        {
+            relative.push_back(position - points[j]);
+        }
+
+        int keep        = 0;
+        float previous  = glm::dot(v, v);
+        v               = closest_on_simplex(relative, keep);
+
+        // without advancing the closest point has to get closer (the first v is arbitrary so doesn't count).
+        // if it doesn't then floating point error outweighs the remaining distance.
+        // position is still short of the surface, so it's a safe place to stop.
+        if ((i > 0) && !advanced && (glm::dot(v, v) >= previous))
+        {
+            break;
         }
 
-        // finally, reconstruct polytope with support point.
-        // the new face is always the 2 points on the edge to add, and the expand point (support).
-        for (int i = 0; i < edges_count; ++i)
+        // drop the points that don't support the closest point.
+        Simplex reduced;
+        for (size_t j = 0; j < points.size(); ++j)
         {
-            if (polytope.face_count >= EPA_MAX_FACES) 
-            {   
-                cout << "Max faces reached: " << polytope.face_count << "\n";
-                break;
+            if (keep & (1 << j))
+            {
+                reduced.push_back(points[j]);
             }
-            Face face = Face(edges[i].first, edges[i].second, support);
-            
-            // maintain CCW winding by checking if normal is incorrect.
-            float bias = 0.000001f;
-            if (glm::dot(face.point[0], face.normal) + bias < 0.0f)
+        }
+        points = reduced;
+    }
+
+    impact.hit              = true;
+    impact.time             = lambda;
+    impact.started_inside   = (lambda == 0.0f);
+    impact.normal           = is_vec3_zero(normal) ? normal : glm::normalize(normal);
+    return impact;
+}
+
+// against a triangle mesh the first triangle hit is the impact.
+// a triangle overlapped from the start is reported the same as an overlapping convex collider.
+static Impact mesh_cast(const Collider *a, glm::vec3 movement, const TriangleMeshCollider *mesh, CollisionStats *stats)
+{
+    Impact first;
+    for (int i : mesh->query(a->get_swept_bounds(movement).fattened(CAST_TOLERANCE)))
+    {
+        if (stats)
+        {
+            stats->triangle_tests++;
+        }
+
+        TriangleCollider triangle   = mesh->get_triangle(i);
+        Impact impact               = convex_cast(a, movement, &triangle, stats);
+        if (impact.started_inside)
+        {
+            return impact;
+        }
+        if (impact.hit && (impact.time < first.time))
+        {
+            first = impact;
+        }
+    }
+    return first;
+}
+
+Impact cast_collider(const Collider *a, glm::vec3 movement, const Collider *b, CollisionStats *stats)
+{
+    if (const TriangleMeshCollider *mesh = dynamic_cast<const TriangleMeshCollider *>(b))
+    {
+        return mesh_cast(a, movement, mesh, stats);
+    }
+    return convex_cast(a, movement, b, stats);
+}
+
+// raycast stuff begins here.
+// moller-trumbore ray/triangle intersection, hits either side. returns the distance along the ray, or -1 for a miss.
+static float ray_triangle(const Ray &ray, const TriangleCollider &triangle)
+{
+    vec3 ab             = triangle.vertices[1] - triangle.vertices[0];
+    vec3 ac             = triangle.vertices[2] - triangle.vertices[0];
+    vec3 p              = glm::cross(ray.direction, ac);
+    float determinant   = glm::dot(ab, p);
+
+    // ray runs along the plane of the triangle.
+    if (glm::abs(determinant) < FLT_EPSILON)
+    {
+        return -1.0f;
+    }
+
+    float inverse   = 1.0f / determinant;
+    vec3 to_origin  = ray.origin - triangle.vertices[0];
+    float u         = glm::dot(to_origin, p) * inverse;
+    if ((u < 0.0f) || (u > 1.0f))
+    {
+        return -1.0f;
+    }
+
+    vec3 q          = glm::cross(to_origin, ab);
+    float v         = glm::dot(ray.direction, q) * inverse;
+    if ((v < 0.0f) || (u + v > 1.0f))
+    {
+        return -1.0f;
+    }
+
+    float distance  = glm::dot(ac, q) * inverse;
+    return ((distance >= 0.0f) && (distance <= ray.length)) ? distance : -1.0f;
+}
+
+// against a triangle mesh only the triangles in leaves along the ray are tested, no gjk needed.
+static RayHit mesh_raycast(const Ray &ray, const TriangleMeshCollider *mesh, CollisionStats *stats)
+{
+    RayHit closest;
+    for (int i : mesh->query(ray))
+    {
+        if (stats)
+        {
+            stats->triangle_tests++;
+        }
+
+        TriangleCollider triangle   = mesh->get_triangle(i);
+        float distance              = ray_triangle(ray, triangle);
+        if ((distance >= 0.0f) && (!closest.hit || (distance < closest.distance)))
+        {
+            vec3 normal         = glm::normalize(glm::cross(triangle.vertices[1] - triangle.vertices[0], triangle.vertices[2] - triangle.vertices[0]));
+            closest.normal      = (glm::dot(normal, ray.direction) > 0.0f) ? -normal : normal;
+            closest.distance    = distance;
+            closest.hit         = true;
+        }
+    }
+
+    closest.point = ray.origin + ray.direction * closest.distance;
+    return closest;
+}
+
+// any other convex collider: sweep a single point along the ray with the gjk cast.
+static RayHit convex_raycast(const Ray &ray, const Collider *b, CollisionStats *stats)
+{
+    RayHit hit;
+    RayCollider point(ray.origin, ray.origin);
+    Impact impact = convex_cast(&point, ray.direction * ray.length, b, stats);
+
+    if (impact.hit)
+    {
+        // the cast normal points from the point into b, the surface faces the other way.
+        hit.normal      = impact.started_inside ? -ray.direction : -impact.normal;
+        hit.distance    = impact.time * ray.length;
+        hit.hit         = true;
+    }
+    hit.point = ray.origin + ray.direction * hit.distance;
+    return hit;
+}
+
+RayHit raycast_collider(const Ray &ray, const Collider *b, CollisionStats *stats)
+{
+    if (stats)
+    {
+        stats->rays++;
+    }
+
+    if (const TriangleMeshCollider *mesh = dynamic_cast<const TriangleMeshCollider *>(b))
+    {
+        return mesh_raycast(ray, mesh, stats);
+    }
+    return convex_raycast(ray, b, stats);
+}
+
+// narrow phase functions.
+// runs test(pair, stats) for every pair, in chunks across the job system if there is one.
+// each chunk counts into its own stats so jobs never write to the same memory.
+template <typename Test>
+static void run_pairs(JobSystem *jobs, int count, std::vector<CollisionStats> &chunk_stats, CollisionStats *stats, Test &&test)
+{
+    chunk_stats.assign((count + NARROW_PHASE_CHUNK - 1) / NARROW_PHASE_CHUNK, CollisionStats());
+    auto job = [&](int begin, int end)
+    {
+        CollisionStats &local = chunk_stats[begin / NARROW_PHASE_CHUNK];
+        for (int i = begin; i < end; ++i)
+        {
+            test(i, &local);
+        }
+    };
+
+    if (jobs)
+    {
+        jobs->parallel_for(count, NARROW_PHASE_CHUNK, job);
+    }
+    else if (count > 0)
+    {
+        job(0, count);
+    }
+
+    if (stats)
+    {
+        for (const CollisionStats &local : chunk_stats)
+        {
+            stats->add(local);
+        }
+    }
+}
+
+// one pair per convex candidate, and one per triangle of a triangle mesh that reaches bounds.
+void NarrowPhase::gather_pairs(const std::vector<std::unique_ptr<Collider>> &colliders, const std::vector<int> &candidates, const AABB &bounds, CollisionStats *stats)
+{
+    pairs.clear();
+    triangles.clear();
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        const Collider *b = &*colliders[candidates[i]];
+        if (const TriangleMeshCollider *mesh = dynamic_cast<const TriangleMeshCollider *>(b))
+        {
+            for (int triangle : mesh->query(bounds))
             {
-                polytope.faces[polytope.face_count].point[0]    = face.point[1];
-                polytope.faces[polytope.face_count].point[1]    = face.point[0];
-                polytope.faces[polytope.face_count].normal      = -face.normal;
+                pairs.push_back({nullptr, static_cast<int>(i), static_cast<int>(triangles.size())});
+                triangles.push_back(mesh->get_triangle(triangle));
             }
-            else
+            if (stats)
             {
-                polytope.faces[polytope.face_count] = face;
+                stats->triangle_tests += mesh->candidates.size();
             }
-            polytope.face_count++;
+        }
+        else
+        {
+            pairs.push_back({b, static_cast<int>(i), -1});
         }
     }
 
-    std::cout << "EPA did not converge \n";
-    results.normal   = closest_face.normal;
-    results.depth    = glm::dot(closest_face.point[0], closest_face.normal) + EPA_ACCURACY;
-    return results;
+    // triangles may have moved as it grew, so they're only pointed at once they're all in.
+    for (NarrowPhasePair &pair : pairs)
+    {
+        if (pair.triangle > -1)
+        {
+            pair.b = &triangles[pair.triangle];
+        }
+    }
 }
 
-// this function actually does the GJK check + EPA, and returns the values as a Results struct
-Collision is_collision(const Collider *a, const Collider *b)
+const std::vector<Impact> &NarrowPhase::cast(const Collider *a, glm::vec3 movement, const std::vector<std::unique_ptr<Collider>> &colliders, const std::vector<int> &candidates, CollisionStats *stats)
 {
-    Collision collision;            // stores the info from collision test.
-    std::vector<glm::vec3> simplex; // simplex constructed in GJK step, iterated on in EPA to get penetration.
-    simplex.reserve(4);
+    gather_pairs(colliders, candidates, a->get_swept_bounds(movement).fattened(CAST_TOLERANCE), stats);
+    pair_impacts.resize(pairs.size());
 
-    if (GJK(a, b, simplex))
+    run_pairs(jobs, static_cast<int>(pairs.size()), chunk_stats, stats, [&](int i, CollisionStats *local)
     {
-        collision            = EPA(a, b, simplex);
-        collision.collided   = true;
+        pair_impacts[i] = convex_cast(a, movement, pairs[i].b, local);
+    });
+
+    // same rules as mesh_cast: the first triangle started inside wins, otherwise the earliest hit.
+    impacts.assign(candidates.size(), Impact());
+    for (size_t i = 0; i < pairs.size(); ++i)
+    {
+        Impact &merged          = impacts[pairs[i].candidate];
+        const Impact &impact    = pair_impacts[i];
+        if (!merged.started_inside && (impact.started_inside || (impact.hit && (impact.time < merged.time))))
+        {
+            merged = impact;
+        }
     }
-    else 
+    return impacts;
+}
+
+const std::vector<Collision> &NarrowPhase::collide(const Collider *a, const std::vector<std::unique_ptr<Collider>> &colliders, const std::vector<int> &candidates, CollisionStats *stats, ContactCache *cache)
+{
+    gather_pairs(colliders, candidates, a->get_bounds(), stats);
+    pair_collisions.resize(pairs.size());
+
+    // the cache is read before and written after the jobs, in pair order, so no two jobs share a slot
+    // and it ends up holding the same entries however the jobs were scheduled.
+    if (cache)
     {
-        collision.collided   = false;
+        contacts.resize(pairs.size());
+        for (size_t i = 0; i < pairs.size(); ++i)
+        {
+            contacts[i] = *find_contact(cache, a, pairs[i].b, stats);
+        }
     }
 
-    if (a->is_trigger || b->is_trigger)
+    run_pairs(jobs, static_cast<int>(pairs.size()), chunk_stats, stats, [&](int i, CollisionStats *local)
     {
-        collision.is_trigger = true;
+        pair_collisions[i] = convex_collision(a, pairs[i].b, cache ? &contacts[i] : nullptr, local);
+    });
+
+    if (cache)
+    {
+        for (size_t i = 0; i < pairs.size(); ++i)
+        {
+            bool hit = false;
+            *cache->find(a, pairs[i].b, hit) = contacts[i];
+        }
     }
-    else
+
+    // same rules as mesh_collision: the deepest overlap wins, the first one on a tie.
+    Collision none;
+    none.normal     = vec3(0.0f);
+    none.depth      = 0.0f;
+    none.collided   = false;
+    none.is_trigger = false;
+    collisions.assign(candidates.size(), none);
+    for (size_t i = 0; i < pairs.size(); ++i)
     {
-        collision.is_trigger = false;
+        Collision &merged           = collisions[pairs[i].candidate];
+        const Collision &collision  = pair_collisions[i];
+        if (collision.collided && (!merged.collided || (collision.depth > merged.depth)))
+        {
+            merged = collision;
+        }
     }
+    return collisions;
+}
 
-    return collision;
-}
\ No newline at end of file
+const std::vector<Collision> &NarrowPhase::push_out(CylinderCollider *a, const std::vector<std::unique_ptr<Collider>> &colliders, const std::vector<int> &candidates, CollisionStats *stats, ContactCache *cache)
+{
+    push_outs.clear();
+    const std::vector<Collision> &overlaps = collide(a, colliders, candidates, stats, cache);
+    for (size_t i = 0; i < overlaps.size(); ++i)
+    {
+        if (!overlaps[i].collided)
+        {
+            continue;
+        }
+
+        Collision collision = push_outs.empty() ? overlaps[i] : is_collision(a, &*colliders[candidates[i]], stats, cache);
+        if (collision.collided)
+        {
+            a->position -= (collision.normal * collision.depth);
+            push_outs.push_back(collision);
+        }
+    }
+    return push_outs;
+}
@@ -2,19 +2,31 @@
 
 #include <vector>       // vertices etc.
 #include <array>        // used in EPA to store faces and edges.
+#include <span>         // mesh data from a model or bake.
 #include <memory>       // used in level loading.
+#include <cassert>
+#include <cstdint>
+#include <initializer_list>
 #include "glm/gtx/quaternion.hpp"
 #include "glm/glm.hpp"
 
 // #include "camera.hpp"   // drawing requires camera.
 #include "draw.hpp"
 #include "utility.hpp"
+#include "bvh.hpp"      // aabb used by the broad phase.
+#include "hull.hpp"     // convex hull for mesh collider support queries.
+#include "simd.hpp"     // simd support kernel.
+#include "jobs.hpp"     // narrow phase runs across the job system.
 
 #define GJK_MAX_ITERATIONS 128                  // limit of GJK iterations.
 #define EPA_MAX_ITERATIONS 255                  // limit of EPA iterations.
 #define EPA_ACCURACY 0.001f                     // 'close enough' margin. 0.001f 100% safe, 0.0001f safe i think.
-const int EPA_MAX_EDGES = 128;                  // allocates space in edge array.
-const int EPA_MAX_FACES = EPA_MAX_EDGES * 2;    // allocates space in face array.
+const int EPA_MAX_VERTICES = EPA_MAX_ITERATIONS + 4;    // gjk tetrahedron + one support point per iteration.
+const int EPA_MAX_FACES = EPA_MAX_VERTICES * 2;         // a closed triangle mesh has 2v - 4 faces, so this never runs out.
+const int EPA_MAX_EDGES = EPA_MAX_VERTICES;             // allocates space in the horizon edge array.
+#define CONTACT_CACHE_SIZE 256                  // slots in the gjk contact cache, must be a power of 2.
+#define CAST_TOLERANCE 0.001f                   // how close a sweep has to get to a surface to count as touching it.
+#define NARROW_PHASE_CHUNK 16                   // convex pairs per narrow phase job, fewer pairs than this run on the caller.
 
 // stores the resulting information from a collision.
 struct Collision
@@ -25,48 +37,204 @@ struct Collision
     bool is_trigger;    //
 };
 
-// store faces inside the polytope.
+// stores the result of sweeping one collider towards another.
+struct Impact
+{
+    glm::vec3 normal    = glm::vec3(0.0f);  // same direction as Collision::normal, from the moving collider into the other.
+    float time          = 1.0f;             // fraction of the movement done when they touch.
+    bool hit            = false;            // touched somewhere along the movement.
+    bool started_inside = false;            // already overlapping before moving, normal and time are meaningless.
+};
+
+// ray for level queries, only looks as far as length.
+struct Ray
+{
+    glm::vec3 origin    = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);    // must be normalized.
+    float length        = 1.0f;
+};
+
+// stores the result of a raycast.
+struct RayHit
+{
+    glm::vec3 point     = glm::vec3(0.0f);
+    glm::vec3 normal    = glm::vec3(0.0f);  // surface normal at the hit, facing back towards the ray origin.
+    float distance      = 0.0f;             // along the ray, from the origin.
+    int collider        = -1;               // index of the collider hit, when cast against a level.
+    bool hit            = false;
+};
+
+// counters filled in by is_collision when it is given somewhere to put them.
+// replaces printing from inside epa, so benchmarks and debug views can see how hard the queries are working.
+struct CollisionStats
+{
+    uint64_t queries                = 0;    // convex pairs tested by is_collision (each triangle of a triangle mesh counts).
+    uint64_t gjk_iterations         = 0;
+    uint64_t epa_runs               = 0;
+    uint64_t epa_iterations         = 0;
+    uint32_t epa_most_iterations    = 0;    // longest single epa run.
+    uint64_t epa_failures           = 0;    // runs that hit EPA_MAX_ITERATIONS without converging.
+    uint64_t epa_overflows          = 0;    // runs that ran out of polytope space.
+    uint64_t cache_lookups          = 0;    // queries made with a contact cache.
+    uint64_t cache_hits             = 0;    // lookups that found the pair from a previous query.
+    uint64_t gjk_early_outs         = 0;    // separated pairs rejected by the cached axis after one support.
+    uint64_t casts                  = 0;    // convex pairs swept by cast_collider (each triangle of a triangle mesh counts).
+    uint64_t cast_iterations        = 0;
+    uint64_t triangle_tests         = 0;    // triangles of triangle mesh colliders given to gjk after the bvh query.
+    uint64_t rays                   = 0;    // raycast_collider calls.
+
+    void reset() { *this = CollisionStats(); }
+    void add(const CollisionStats &other);
+    float cache_hit_rate() const { return cache_lookups ? static_cast<float>(cache_hits) / cache_lookups : 0.0f; }
+};
+
+struct Collider;
+
+// hands out collider ids in creation order, starting from 1. count reserves a run of ids and returns the first.
+uint32_t next_collider_id(uint32_t count = 1);
+
+// renumbers a collider (and each triangle of a triangle mesh) counting up from first, returns the next unused id.
+// lets a level's colliders get the same ids however, and on whichever thread, it was loaded.
+uint32_t assign_collider_ids(Collider &collider, uint32_t first);
+
+// what was learnt about a collider pair the last time it was tested.
+struct ContactCacheEntry
+{
+    uint32_t a          = 0;        // collider ids, 0 = empty slot.
+    uint32_t b          = 0;
+    glm::vec3 axis      = glm::vec3(1.0f, 0.0f, 0.0f);  // separating axis if apart, penetration normal if touching.
+    bool separated      = false;
+};
+
+// per pair warm start data for gjk, colliders barely move between ticks so last tick's axis is a good first guess.
+// direct mapped on the collider ids, a pair landing in a used slot replaces it.
+// ids rather than addresses, so which pairs share a slot (and so every warm start) is the same from run to run.
+struct ContactCache
+{
+    std::array<ContactCacheEntry, CONTACT_CACHE_SIZE> entries;
+
+    ContactCacheEntry *find(const Collider *a, const Collider *b, bool &hit);
+    void clear();
+};
+
+// triangle on the surface of the epa polytope. vertices are wound ccw when viewed from outside.
+// no default values, as the polytope holds hundreds of these and add_face sets everything.
 struct Face
 {
     glm::vec3 normal;
-    float distance      = FLT_MAX;
-    std::array<glm::vec3, 3> point;
+    float distance;                 // distance of the face plane from the origin, the heap key.
+    std::array<int, 3> vertex;      // indices into the polytope vertices.
+    std::array<int, 3> neighbour;   // face on the other side of edge vertex[i] -> vertex[i + 1].
+    int heap_index;                 // position in the heap, -1 once removed.
+    int mark;                       // expansion the face was last found to be visible in.
+};
 
-    // constructors.
-    Face()
+// edge between a face that can see the new support point and one that can't.
+struct HorizonEdge
+{
+    int a;
+    int b;
+    int face;       // the face being kept, the new face attaches to it.
+};
+
+// gjk simplex, at most a tetrahedron. lives on the stack so a collision query never touches the heap.
+// assigning an initializer list replaces the points, the same as it did with the std::vector version.
+struct Simplex
+{
+    std::array<glm::vec3, 4> points;
+    size_t count = 0;
+
+    Simplex &operator=(std::initializer_list<glm::vec3> list)
     {
-        point[0] = glm::vec3(0.0f);
-        point[1] = glm::vec3(0.0f);
-        point[2] = glm::vec3(0.0f);
-        Face::normal = glm::vec3(0.0f);
+        assert(list.size() <= points.size());
+        count = 0;
+        for (glm::vec3 point : list)
+        {
+            points[count] = point;
+            count++;
+        }
+        return *this;
     }
-    Face(glm::vec3 a, glm::vec3 b, glm::vec3 c)
+
+    void push_back(glm::vec3 point)
     {
-        point[0] = a;
-        point[1] = b;
-        point[2] = c;
-        glm::vec3 ab = point[1] - point[0];
-        glm::vec3 ac = point[2] - point[0];
-        Face::normal = glm::normalize(glm::cross(ab, ac));
+        assert(count < points.size());
+        points[count] = point;
+        count++;
     }
+
+    size_t size() const { return count; }
+    glm::vec3 &operator[](size_t index) { return points[index]; }
+    const glm::vec3 &operator[](size_t index) const { return points[index]; }
 };
 
+// epa polytope. faces know their neighbours, so the faces visible from a new support point
+// are found by walking out from the closest face instead of testing all of them,
+// and a min heap on distance keeps the closest face at the front.
+// everything is fixed size so an epa run stays on the stack.
 struct Polytope
 {
+    std::array<glm::vec3, EPA_MAX_VERTICES> vertices;
     std::array<Face, EPA_MAX_FACES> faces;
-    size_t face_count = 0;
+    std::array<int, EPA_MAX_FACES> heap;            // face indices ordered by distance.
+    std::array<int, EPA_MAX_FACES> free_faces;      // removed face slots ready to be reused.
+    std::array<HorizonEdge, EPA_MAX_EDGES> horizon;
+    int vertex_count    = 0;
+    int face_count      = 0;                        // slots used, including removed ones.
+    int heap_count      = 0;
+    int free_count      = 0;
+    int horizon_count   = 0;
+    int mark            = 0;
+    bool overflow       = false;                    // ran out of space, results are approximate.
+
+    int add_vertex(glm::vec3 point);
+    int add_face(int a, int b, int c);
+    void remove_face(int face);
+    int closest_face() const { return heap[0]; }
+    bool expand(int face, int vertex);
+
+private:
+    void find_horizon(int face, int entry_edge, glm::vec3 point);
+    void heap_swap(int i, int j);
+    void sift_up(int index);
+    void sift_down(int index);
 };
 
 // abstract parent collider.
 struct Collider
 {
-    bool is_trigger;
-    glm::vec3 colour;
+    uint32_t id         = next_collider_id();   // copies keep the id, so a copy shares the original's cache entries.
+    bool is_trigger     = false;
+    glm::vec3 colour    = glm::vec3(1.0f);
     int target_level    = 0;
     glm::vec3 spawn     = glm::vec3(0.0f);  // spawn point for level changes.
 
+    // constructors. a triangle of a triangle mesh is made when it's tested and takes the id its mesh set aside for it.
+    Collider() {}
+    Collider(uint32_t id) : id(id) {}
+
     virtual glm::vec3 furthest_point(glm::vec3 direction) const = 0;
     virtual void draw(const Shader &shader, const Camera &camera) = 0;
+
+    // world space bounds for the broad phase, built from the support function along each axis.
+    virtual AABB get_bounds() const
+    {
+        AABB bounds;
+        for (int i = 0; i < 3; ++i)
+        {
+            glm::vec3 axis  = glm::vec3(0.0f);
+            axis[i]         = 1.0f;
+            bounds.min[i]   = furthest_point(-axis)[i];
+            bounds.max[i]   = furthest_point(axis)[i];
+        }
+        return bounds;
+    }
+
+    // bounds covering the collider moving along the movement vector.
+    AABB get_swept_bounds(glm::vec3 movement) const
+    {
+        return get_bounds().swept(movement);
+    }
 };
 
 // cylinder collision shape. defined using height, radius, position, and axis.
@@ -111,7 +279,8 @@ struct CylinderCollider : public Collider
     }
 };
 
-// cylinder collision shape. defined using height, radius, position, and axis.
+// line segment collision shape. defined using the two end points.
+// also what a raycast sweeps along the ray, with both points at the ray origin.
 struct RayCollider : public Collider
 {
     glm::vec3 colour = glm::vec3(0.0f);
@@ -123,19 +292,15 @@ struct RayCollider : public Collider
     RayCollider() : point_a(glm::vec3(0.0f)), point_b(glm::vec3(1.0f)) {}
     RayCollider(glm::vec3 point_a, glm::vec3 point_b) : point_a(point_a), point_b(point_b) {}
 
-    // draws 2 circles, one at base of collider one at the top, using radius.
     void draw(const Shader &shader, const Camera &camera) override
     {
 
     }
 
-    // support mapping from http://www.cs.kent.edu/~ruttan/GameEngines/lectures/gjk1.pdf
+    // a segment's furthest point is always one of its ends.
     glm::vec3 furthest_point(glm::vec3 direction) const override
     {   
-
-        glm::vec3 point     = glm::vec3(0.0f);
-
-        return point;
+        return (glm::dot(point_b - point_a, direction) > 0.0f) ? point_b : point_a;
     }
 };
 
@@ -144,14 +309,37 @@ struct RayCollider : public Collider
 struct MeshCollider : public Collider
 {
     glm::vec3 colour = glm::vec3(0.9f, 0.5f, 0.3f);
-    std::vector<glm::vec3> vertices;
+    std::span<const glm::vec3> vertices;    // a copy in vertex_storage, or for a baked hull the caller's (ie the bake's).
+    AABB bounds;                        // mesh colliders never move, so bounds are only calculated once.
+    ConvexHull hull;                    // built on load, lets the support function hill climb instead of scanning.
+    VertexSoA support_vertices;         // hull vertices (or all vertices if there is no hull) laid out for the simd scan.
+    mutable uint32_t support_hint = 0;  // hull vertex returned by the last support query, where the next climb starts.
     // bool is_trigger;
     // MeshPrimitive mesh;
 
     // default constructor.
-    MeshCollider(std::vector<glm::vec3> &vertices) : vertices(vertices) 
+    MeshCollider(std::span<const glm::vec3> vertices) : vertex_storage(vertices.begin(), vertices.end())
     {
         // bind_buffers(mesh.VAO, mesh.VBO, mesh.EBO, vertices, )
+        this->vertices = vertex_storage;
+        for (const glm::vec3 &vertex : vertices)
+        {
+            bounds.expand(vertex);
+        }
+        hull = build_convex_hull(this->vertices);
+        support_vertices.assign(hull.is_valid() ? hull.vertices : this->vertices);
+    }
+
+    // from a baked hull (see asset.hpp), skips building it. points at the vertices and hull rather than copying them,
+    // so they have to outlive the collider (a level's colliders are freed before its model, which holds the bake).
+    MeshCollider(std::span<const glm::vec3> vertices, ConvexHull baked_hull, AABB bounds) : vertices(vertices), bounds(bounds), hull(std::move(baked_hull))
+    {
+        support_vertices.assign(hull.is_valid() ? hull.vertices : this->vertices);
+    }
+
+    AABB get_bounds() const override
+    {
+        return bounds;
     }
 
     // draw mesh wrapper, simply draws the mesh used for mesh collider input.
@@ -161,9 +349,21 @@ struct MeshCollider : public Collider
         // mesh.draw(GL_TRIANGLES, glm::vec3(0.0f), glm::quat(glm::vec3(0.0f)), glm::vec3(1.0f), shader, colour);
     }
 
+    // gjk/epa query the support of the same mesh many times with similar directions,
+    // so climb the hull from the previous answer. flat meshes have no hull and fall back to the simd scan.
+    glm::vec3 furthest_point(glm::vec3 direction) const override
+    {
+        if (!hull.is_valid())
+        {
+            return support_vertices.get(max_dot_index(support_vertices, direction));
+        }
+        support_hint = hull.hill_climb(direction, support_hint);
+        return hull.vertices[support_hint];
+    }
+
     // loop through each vertex position,
     // get the vertex in the mesh that is furthest in direction.
-    glm::vec3 furthest_point(glm::vec3 direction) const
+    glm::vec3 furthest_point_scan(glm::vec3 direction) const
     {
         glm::vec3 point         = glm::vec3(0.0f);;
         float furthest_distance = -FLT_MAX;
@@ -179,7 +379,160 @@ struct MeshCollider : public Collider
         }
         return point;
     };
+
+private:
+    std::vector<glm::vec3> vertex_storage;
+};
+
+// single triangle of a triangle mesh collider. a triangle is convex, so gjk and the cast work on it directly.
+// has no volume of its own, so deep overlaps can be pushed out through either side.
+struct TriangleCollider : public Collider
+{
+    std::array<glm::vec3, 3> vertices;
+
+    // constructors.
+    TriangleCollider(glm::vec3 a, glm::vec3 b, glm::vec3 c) : vertices({a, b, c}) {}
+    TriangleCollider(glm::vec3 a, glm::vec3 b, glm::vec3 c, uint32_t id) : Collider(id), vertices({a, b, c}) {}
+
+    AABB get_bounds() const override
+    {
+        AABB bounds;
+        for (const glm::vec3 &vertex : vertices)
+        {
+            bounds.expand(vertex);
+        }
+        return bounds;
+    }
+
+    void draw(const Shader &, const Camera &) override
+    {
+
+    }
+
+    glm::vec3 furthest_point(glm::vec3 direction) const override
+    {
+        float a = glm::dot(vertices[0], direction);
+        float b = glm::dot(vertices[1], direction);
+        float c = glm::dot(vertices[2], direction);
+        return (a >= b) ? ((a >= c) ? vertices[0] : vertices[2]) : ((b >= c) ? vertices[1] : vertices[2]);
+    }
+};
+
+// arbitrary (concave) mesh collision shape. defined using a vertex and index buffer.
+// a MeshCollider collides with the convex hull of its vertices, which fills in every dip and doorway,
+// so this keeps the triangles instead and only tests the ones the other collider's bounds reach.
+// is_collision and cast_collider see this type and test it triangle by triangle.
+struct TriangleMeshCollider : public Collider
+{
+    glm::vec3 colour = glm::vec3(0.9f, 0.5f, 0.3f);
+    std::span<const glm::vec3> triangles;       // three vertices per triangle, in triangle_storage or the bake.
+    StaticBVH tree;                             // over triangles, built once as the mesh never moves.
+    AABB bounds;
+    uint32_t first_triangle_id;                 // triangle i is tested as a collider with id first_triangle_id + i.
+    mutable std::vector<int> candidates;        // triangles found by the last query, kept to reuse its memory.
+
+    TriangleMeshCollider(std::span<const glm::vec3> vertices, std::span<const uint32_t> indices);
+
+    // from baked triangles (three vertices each) and their tree (see asset.hpp), skips the build.
+    // points at them rather than copying, so they have to outlive the collider (a level's model holds the bake).
+    TriangleMeshCollider(std::span<const glm::vec3> triangles, std::span<const StaticBVHNode> nodes, std::span<const int> items, AABB bounds);
+
+    AABB get_bounds() const override
+    {
+        return bounds;
+    }
+
+    void draw(const Shader &, const Camera &) override
+    {
+
+    }
+
+    // support of the whole mesh, ie of its convex hull. not used for collision (that goes through the triangles),
+    // but keeps the mesh usable anywhere a plain collider is expected.
+    glm::vec3 furthest_point(glm::vec3 direction) const override
+    {
+        glm::vec3 point         = glm::vec3(0.0f);
+        float furthest_distance = -FLT_MAX;
+        for (const glm::vec3 &vertex : triangles)
+        {
+            float distance = glm::dot(vertex, direction);
+            if (distance > furthest_distance)
+            {
+                furthest_distance   = distance;
+                point               = vertex;
+            }
+        }
+        return point;
+    }
+
+    int get_triangle_count() const
+    {
+        return static_cast<int>(triangles.size() / 3);
+    }
+
+    // each triangle is its own collider so gjk can test it and the contact cache can tell them apart.
+    // they're cheap enough to make on the spot, which saves keeping a copy of every triangle.
+    TriangleCollider get_triangle(int index) const
+    {
+        return TriangleCollider(triangles[index * 3], triangles[index * 3 + 1], triangles[index * 3 + 2], first_triangle_id + index);
+    }
+
+    // fills candidates with the triangles whose bounds overlap the given bounds.
+    const std::vector<int> &query(const AABB &query_bounds) const;
+
+    // fills candidates with the triangles whose leaves the ray passes through.
+    const std::vector<int> &query(const Ray &ray) const;
+
+private:
+    std::vector<glm::vec3> triangle_storage;    // filled when built from indices, unused by a baked mesh.
+};
+
+// convex pair handed to a narrow phase job. b is a convex collider, or a single triangle of a triangle mesh.
+struct NarrowPhasePair
+{
+    const Collider *b;
+    int candidate;      // position in the candidate list it came from, results are merged per candidate.
+    int triangle;       // index into NarrowPhase::triangles if b is a triangle, -1 otherwise.
+};
+
+// tests one collider against a list of broad phase candidates, spreading the convex pairs over the job system.
+// every pair is tested on its own and the results are merged in pair order afterwards,
+// so the output is bit identical no matter how many threads there are or which finishes first.
+// the buffers are kept between calls so a tick doesn't allocate once they have grown.
+struct NarrowPhase
+{
+    JobSystem *jobs = nullptr;                      // null runs everything on the calling thread.
+    std::vector<NarrowPhasePair> pairs;
+    std::vector<TriangleCollider> triangles;        // the triangles in pairs, made while gathering them.
+    std::vector<ContactCacheEntry> contacts;        // cache entries copied out for the jobs, written back after.
+    std::vector<Impact> pair_impacts;
+    std::vector<Collision> pair_collisions;
+    std::vector<CollisionStats> chunk_stats;        // one per job, summed into the caller's stats after.
+    std::vector<Impact> impacts;                    // per candidate results.
+    std::vector<Collision> collisions;
+    std::vector<Collision> push_outs;
+
+    // sweep a along movement against each candidate. impacts[i] is the first impact with colliders[candidates[i]].
+    const std::vector<Impact> &cast(const Collider *a, glm::vec3 movement, const std::vector<std::unique_ptr<Collider>> &colliders, const std::vector<int> &candidates, CollisionStats *stats = nullptr);
+
+    // test a against each candidate. collisions[i] is the deepest overlap with colliders[candidates[i]].
+    const std::vector<Collision> &collide(const Collider *a, const std::vector<std::unique_ptr<Collider>> &colliders, const std::vector<int> &candidates, CollisionStats *stats = nullptr, ContactCache *cache = nullptr);
+
+    // move a out of every candidate it overlaps, one at a time in candidate order, and return the push-outs applied.
+    // only the first comes from the parallel test, the rest are retested from where the ones before left a,
+    // so two colliders overlapping along the same normal (a floor seam) push it out once, not twice.
+    const std::vector<Collision> &push_out(CylinderCollider *a, const std::vector<std::unique_ptr<Collider>> &colliders, const std::vector<int> &candidates, CollisionStats *stats = nullptr, ContactCache *cache = nullptr);
+
+private:
+    void gather_pairs(const std::vector<std::unique_ptr<Collider>> &colliders, const std::vector<int> &candidates, const AABB &bounds, CollisionStats *stats);
 };
 
 // call this function to query a collision between any two collider shapes.
-Collision is_collision(const Collider *a, const Collider *b);
\ No newline at end of file
+// the cache is optional, pass one to warm start gjk from the previous query of the same pair.
+Collision is_collision(const Collider *a, const Collider *b, CollisionStats *stats = nullptr, ContactCache *cache = nullptr);
+
+// sweep collider a along movement and find when it first touches b (continuous collision detection).
+Impact cast_collider(const Collider *a, glm::vec3 movement, const Collider *b, CollisionStats *stats = nullptr);
+
+// find where a ray first hits b. rays start outside colliders, one that starts inside hits at distance 0.
+RayHit raycast_collider(const Ray &ray, const Collider *b, CollisionStats *stats = nullptr);
\ No newline at end of file
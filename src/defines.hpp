@@ -2,10 +2,14 @@
 
 #define WINDOW_WIDTH        1100    // global window width.
 #define WINDOW_HEIGHT       900    // global window height.
-#define SHADER_COUNT        7       // total levels.
+#define SHADER_COUNT        9       // total levels.
 #define NUM_CASCADES        3       // number of shadowmap cascades.
 #define SHADOWMAP_SIZE      4096    // resolution of the shadowmap texture. 2048. 4096.
 
+// asset paths, relative to the repo root.
+#define MODELS_PATH         "./assets/models/"
+#define TEXTURES_PATH       "./assets/textures/"
+
 // shaders.
 #define SHADER_FRAMEBUFFER  0
 #define SHADER_SHADOWMAP    1
@@ -14,4 +18,6 @@
 #define SHADER_LINE         4
 #define SHADER_SKYBOX       5
 #define SHADER_BLUR         6
+#define SHADER_CEL_INSTANCED        7
+#define SHADER_SHADOWMAP_INSTANCED  8
 
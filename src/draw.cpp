@@ -1,6 +1,11 @@
 #include "draw.hpp"
-#include "defines.hpp"                  // window dimensions.
+#include "defines.hpp"                  // window dimensions, asset paths.
+#include "resource.hpp"                 // shared model data.
 #include <iostream>                     // std::cout etc.
+#include <algorithm>                    // std::min, sorting the render queue.
+#include <cstdint>                      // SIZE_MAX, an unlimited upload budget.
+#include <cstring>                      // std::memcmp, grouping instances by pose.
+#include <cstddef>                      // offsetof, instance attribute layout.
 #include <glm/gtc/type_ptr.hpp>         // get type of pointer for shaders.
 #include <stb_image.h>                  // load images (include seperately from tinygltf).
 #define TINYGLTF_IMPLEMENTATION
@@ -8,86 +13,79 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION  // stb image write for tinygltf.
 #include <tiny_gltf.h>                  // actually include the file.
 
-#define MODELS_PATH     "./assets/models/"
-#define TEXTURES_PATH   "./assets/textures/"
 #define ERROR_PNG       "error.png"
 using std::cout;
 
-glm::mat4 Node::get_local_matrix()
+glm::mat4 Node::get_local_matrix() const
 {
 	return glm::translate(glm::mat4(1.0f), translation) * glm::mat4(rotation) * glm::scale(glm::mat4(1.0f), scale) * matrix;
 }
 
-glm::mat4 get_node_matrix(Node *node)
+glm::mat4 NodeTransform::get_matrix(const glm::mat4 &node_matrix) const
 {
-	glm::mat4 node_matrix   = node->get_local_matrix();
-	Node *current_parent    = node->parent;
+    return glm::translate(glm::mat4(1.0f), translation) * glm::mat4(rotation) * glm::scale(glm::mat4(1.0f), scale) * node_matrix;
+}
 
-	while (current_parent)
-	{
-		node_matrix    = current_parent->get_local_matrix() * node_matrix;
-		current_parent = current_parent->parent;
-	}
-	return node_matrix;
+// parents come first, so a parent's world matrix is up to date by the time its children are reached
+// and a moved parent passes NODE_DIRTY_WORLD down to them on the way.
+void Model::update_world_matrices()
+{
+    const std::vector<Node> &nodes = data->nodes;
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        int32_t parent = nodes[i].parent;
+        if ((parent > -1) && (dirty[parent] & NODE_DIRTY_WORLD))
+        {
+            dirty[i] |= NODE_DIRTY_WORLD;
+        }
+        if (dirty[i] & NODE_DIRTY_LOCAL)
+        {
+            local_matrices[i] = transforms[i].get_matrix(nodes[i].matrix);
+        }
+        if (dirty[i] & NODE_DIRTY_WORLD)
+        {
+            world_matrices[i] = (parent > -1) ? world_matrices[parent] * local_matrices[i] : local_matrices[i];
+        }
+    }
+    std::fill(dirty.begin(), dirty.end(), 0);
 }
 
-void Model::draw_node(Node node, GLenum mode, glm::mat4 transform, Shader shader)
+// point the shader at the frame's joint palette (see JointPalette), offset is where the draw's joints start.
+static void set_joint_uniforms(Shader shader, GLint joint_offset)
 {
-    // draw mesh of node.
+    shader.set(UNIFORM_JOINT_PALETTE, JOINT_PALETTE_UNIT);
+    shader.set(UNIFORM_JOINT_OFFSET, joint_offset);
+}
+
+void Model::draw_node(RenderQueue &queue, uint32_t node_index, glm::mat4 transform, Shader shader, glm::vec3 colour, uint32_t layer)
+{
+    // queue the meshes of the node.
+    const Node &node = data->nodes[node_index];
     if (node.mesh_primitives.size() > 0)
     {
-        // node matrix combined with model transform.
-        glm::mat4 node_transform = transform * get_node_matrix(&node);
+        DrawItem item;
+        item.layer          = layer;
+        item.transform      = transform * get_node_matrix(node_index);  // node matrix combined with model transform.
+        item.albedo         = colour;
+        const glm::mat4 &bounds_transform = (node.skin > -1) ? transform : item.transform;
+
+        // a model that wasn't added to the palette gets the identity at the start of it, so it's drawn unposed.
+        item.joint_offset   = (joint_offset < 0) ? 0 : joint_offset + data->get_skin_offset(node.skin);
 
         // loop through each mesh in the node (usually just one atm).
-        for (MeshPrimitive &mesh : node.mesh_primitives)
+        for (const MeshPrimitive &mesh : node.mesh_primitives)
         {
             // very hacky fix rn to make triggers not cast shadows -- fix later.
                 // if (!(mesh.type == 1 && shader.ID == 6)) // ID 6 is shadowmap.
                 // {
                 if (mesh.index_count > 0)
                 {
-                    // if (mesh.is_trigger)
-                    // {
-                    //     shader.mode = GL_LINE;
-                    // }
-                    // bind the VAO with the vertexes from the mesh.
-                    glBindVertexArray(mesh.VAO);    
-                    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "mvp"), 1, GL_FALSE, glm::value_ptr(node_transform));
-
-                    // if mesh has a material/texture attached to it.
-                    if (mesh.material_index > -1)
-                    {
-                        glActiveTexture(GL_TEXTURE0);
-                        glBindTexture(GL_TEXTURE_2D, materials[mesh.material_index].texture_ID);
-                        glUniform1i(glGetUniformLocation(shader.ID, "tex0"), 0);
-                    }
-
-                    // maybe rather than shader.mode, set when loading trigger vs mesh?
-                    // set polygon mode and then draw elements.
-                    glPolygonMode(GL_FRONT_AND_BACK, shader.mode);
-
-                    // switch (mesh.type)
-                    // {
-                    // case 0:
-                    //     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-                    //     break;
-                    // case 1:
-                    //     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-                    //     break;
-                    
-                    // default:
-                    //     break;
-                    // }
-
-
-
-                    glLineWidth(1.0f);
-                    glDrawElements(mode, mesh.index_buffer.size() * sizeof(mesh.index_buffer[0]), GL_UNSIGNED_INT, 0);
+                    item.mesh   = &mesh;
+                    item.bounds = mesh.bounds.transformed(bounds_transform);
 
-                    // unbind vertex array and texture.
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                    glBindVertexArray(0);
+                    // if mesh has a material/texture attached to it, and the shader uses it (shadows don't).
+                    item.texture = ((mesh.material_index > -1) && shader.has(UNIFORM_TEX0)) ? data->materials[mesh.material_index].texture_ID : 0;
+                    queue.submit(shader, item);
                 }
             // }
         }
@@ -97,51 +95,340 @@ void Model::draw_node(Node node, GLenum mode, glm::mat4 transform, Shader shader
     // if (node.skin > -1)
     // {
     //     Line bone_mesh(node.translation, 2.0f);
-    //     bone_mesh.draw(node.translation, transform * get_node_matrix(&node), shader, glm::vec3(1.0f, 1.0f, 1.0f));
+    //     bone_mesh.draw(node.translation, transform * get_node_matrix(node_index), shader, glm::vec3(1.0f, 1.0f, 1.0f));
 
 
     // }
+}
+
+glm::mat4 get_model_matrix(glm::vec3 position, glm::quat rotation, glm::vec3 scale)
+{
+    return translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+// uniforms from the camera that every model shader takes, the same for every model in a frame.
+// the setters skip values the shader already has, so they reach gl once per program per frame rather than once per model.
+static void set_camera_uniforms(Shader shader, Camera &camera)
+{
+    static const int shadow_map_units[NUM_CASCADES] = {1, 2, 3};    // bound from texture1 onwards, texture0 is for mesh textures.
+
+    shader.set(UNIFORM_CAMERA_DISTANCE, camera.distance_offset);
+    shader.set(UNIFORM_CASCADE_BOUNDS, std::span<const float>(camera.cascade_bounds));
+    shader.set(UNIFORM_LIGHT_POS, camera.light_pos);
+    shader.set(UNIFORM_VIEW, camera.mvp);
+    shader.set(UNIFORM_LIGHT, std::span<const glm::mat4>(camera.cascade_proj));
+    shader.set(UNIFORM_SHADOW_MAP, std::span<const int>(shadow_map_units));
+    shader.set(UNIFORM_TEX0, 0);
+    shader.set(UNIFORM_JOINT_PALETTE, JOINT_PALETTE_UNIT);
+}
 
-    for (auto &child : node.children)
+// queue model by queueing each mesh contained within the model.
+void Model::draw(RenderQueue &queue, glm::vec3 position, glm::quat rotation, glm::vec3 scale, Shader shader, glm::vec3 colour)
+{
+    glm::mat4 transform = get_model_matrix(position, rotation, scale);
+
+    // loop through all nodes in the model.
+    for (uint32_t i = 0; i < data->nodes.size(); ++i)
     {
-        draw_node(*child, mode, transform, shader);
+        draw_node(queue, i, transform, shader, colour, RENDER_LAYER_OPAQUE);
     }
 }
 
-// draw model by drawing each mesh contained within the model.
-void Model::draw(glm::vec3 position, glm::quat rotation, glm::vec3 scale, Shader shader, Camera camera, glm::vec3 colour)
+void InstancedRenderer::clear()
+{
+    groups.clear();
+}
+
+void JointPalette::clear()
 {
-    glm::mat4 transform = translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+    matrices.assign(1, glm::mat4(1.0f));
+}
 
-    // per-model uniforms.
-    glUseProgram(shader.ID);
-    glUniform1f(glGetUniformLocation(shader.ID, "camera_distance"), camera.distance_offset);
-    glUniform1fv(glGetUniformLocation(shader.ID, "cascade_bounds"), NUM_CASCADES, reinterpret_cast<GLfloat *>(camera.cascade_bounds.data()));
-    glUniform3fv(glGetUniformLocation(shader.ID, "albedo"), 1, glm::value_ptr(colour));
-    glUniform3fv(glGetUniformLocation(shader.ID, "light_pos"), 1, glm::value_ptr(camera.light_pos));
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "view"), 1, GL_FALSE, glm::value_ptr(camera.mvp));
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "light"), NUM_CASCADES, GL_FALSE, reinterpret_cast<GLfloat *>(camera.cascade_proj.data()));
-    
+void JointPalette::add(Model &model)
+{
+    model.joint_offset = static_cast<int32_t>(matrices.size());
+    matrices.reserve(matrices.size() + model.data->get_palette_size());
+    matrices.push_back(glm::mat4(1.0f));
+
+    for (size_t i = 0; i < model.data->skins.size(); ++i)
+    {
+        size_t joint_count = std::min(model.data->skins[i].joints.size(), static_cast<size_t>(MAX_JOINTS));
+        matrices.insert(matrices.end(), model.joint_matrices[i].begin(), model.joint_matrices[i].begin() + joint_count);
+    }
+}
+
+void JointPalette::upload()
+{
+    if (!buffer)
+    {
+        glGenBuffers(1, &buffer);
+        glGenTextures(1, &texture);
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    if (matrices.size() > capacity)
+    {
+        capacity = std::max(matrices.size(), capacity * 2);
+        glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, matrices.size() * sizeof(glm::mat4), matrices.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // rgba32f, so each matrix column is a texel.
+    glActiveTexture(GL_TEXTURE0 + JOINT_PALETTE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void InstancedRenderer::add(const Model &model, glm::mat4 transform, glm::vec3 colour)
+{
+    InstanceAttributes instance = {transform, colour, (model.joint_offset < 0) ? 0 : model.joint_offset};
+
+    // the matrices of the nodes with meshes, in the order draw_node visits them.
+    node_matrices.clear();
+    for (uint32_t i = 0; i < model.data->nodes.size(); ++i)
+    {
+        if (!model.data->nodes[i].mesh_primitives.empty())
+        {
+            node_matrices.push_back(model.get_node_matrix(i));
+        }
+    }
+
+    // join a group of the same data with the same mesh node matrices if there is one. skinned meshes usually
+    // only move through their joints, so every instance of a model ends up in one group whatever it's playing.
+    for (InstanceGroup &group : groups)
+    {
+        if ((group.model->data == model.data) &&
+            (std::memcmp(group.node_matrices.data(), node_matrices.data(), node_matrices.size() * sizeof(glm::mat4)) == 0))
+        {
+            group.instances.push_back(instance);
+            return;
+        }
+    }
+    groups.push_back({&model, node_matrices, {instance}});
+}
+
+void InstancedRenderer::upload()
+{
+    if (groups.empty())
+    {
+        return;
+    }
+
+    // every group's instances go in the one buffer.
+    attributes.clear();
+    for (InstanceGroup &group : groups)
+    {
+        group.first = attributes.size();
+        attributes.insert(attributes.end(), group.instances.begin(), group.instances.end());
+    }
+
+    if (!instance_buffer)
+    {
+        glGenBuffers(1, &instance_buffer);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    if (attributes.size() > capacity)
+    {
+        capacity = std::max(attributes.size(), capacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceAttributes), nullptr, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, attributes.size() * sizeof(InstanceAttributes), attributes.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstancedRenderer::draw(RenderQueue &queue, Shader shader)
+{
+    for (const InstanceGroup &group : groups)
+    {
+        size_t mesh_node = 0;
+        for (uint32_t i = 0; i < group.model->data->nodes.size(); ++i)
+        {
+            draw_node(queue, group, i, shader, mesh_node);
+        }
+    }
+}
+
+void InstancedRenderer::draw_node(RenderQueue &queue, const InstanceGroup &group, uint32_t node_index, Shader shader, size_t &mesh_node)
+{
+    const Node &node = group.model->data->nodes[node_index];
+    if (node.mesh_primitives.size() > 0)
+    {
+        DrawItem item;
+        item.transform          = group.node_matrices[mesh_node++];
+        item.joint_offset       = group.model->data->get_skin_offset(node.skin);  // relative to each instance's joints, which come in as an attribute.
+        item.instance_buffer    = instance_buffer;
+        item.first_instance     = static_cast<uint32_t>(group.first);
+        item.instance_count     = static_cast<uint32_t>(group.instances.size());
+
+        for (const MeshPrimitive &mesh : node.mesh_primitives)
+        {
+            if (mesh.index_count > 0)
+            {
+                item.mesh       = &mesh;
+                item.texture    = ((mesh.material_index > -1) && shader.has(UNIFORM_TEX0)) ? group.model->data->materials[mesh.material_index].texture_ID : 0;
+
+                // culled as a whole, so it's drawn if any instance might be seen.
+                item.bounds     = AABB();
+                for (const InstanceAttributes &instance : group.instances)
+                {
+                    item.bounds = combine(item.bounds, mesh.bounds.transformed((node.skin > -1) ? instance.model : instance.model * item.transform));
+                }
+                queue.submit(shader, item);
+            }
+        }
+    }
+}
+
+void RenderQueue::clear()
+{
+    shaders.clear();
+    items.clear();
+}
+
+void RenderQueue::submit(Shader shader, DrawItem item)
+{
+    item.shader = 0;
+    while ((item.shader < shaders.size()) && (shaders[item.shader].ID != shader.ID))
+    {
+        ++item.shader;
+    }
+    if (item.shader == shaders.size())
+    {
+        shaders.push_back(shader);
+    }
+    items.push_back(item);
+}
+
+// layer first, then the state that's the most work to change. the ids are only cut down for ordering,
+// draw() compares the real ones.
+static uint64_t get_sort_key(const DrawItem &item, const Shader &shader)
+{
+    return (static_cast<uint64_t>(item.layer & 0xf) << 60) |
+           (static_cast<uint64_t>(shader.ID & 0xfff) << 48) |
+           (static_cast<uint64_t>(item.texture & 0xffffff) << 24) |
+           static_cast<uint64_t>(item.mesh->VAO & 0xffffff);
+}
+
+// points the instance attributes at the draw's part of the instance buffer, in the mesh's own vao.
+// the vao is shared by every model using the mesh, which is fine since only instanced shaders read these.
+static void set_instance_attributes(const DrawItem &item)
+{
+    const GLsizei stride    = sizeof(InstanceAttributes);
+    const size_t offset     = item.first_instance * sizeof(InstanceAttributes);
+
+    glBindBuffer(GL_ARRAY_BUFFER, item.instance_buffer);
+    for (int column = 0; column < 4; ++column)
+    {
+        glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + column);
+        glVertexAttribPointer(INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, stride, (void *)(offset + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + column, 1);
+    }
+    glEnableVertexAttribArray(INSTANCE_ALBEDO_LOCATION);
+    glVertexAttribPointer(INSTANCE_ALBEDO_LOCATION, 3, GL_FLOAT, GL_FALSE, stride, (void *)(offset + offsetof(InstanceAttributes, albedo)));
+    glVertexAttribDivisor(INSTANCE_ALBEDO_LOCATION, 1);
+    glEnableVertexAttribArray(INSTANCE_JOINTS_LOCATION);
+    glVertexAttribIPointer(INSTANCE_JOINTS_LOCATION, 1, GL_INT, stride, (void *)(offset + offsetof(InstanceAttributes, joints)));
+    glVertexAttribDivisor(INSTANCE_JOINTS_LOCATION, 1);
+}
+
+PassStats RenderQueue::draw(Camera &camera, const glm::mat4 &view_projection)
+{
+    PassStats stats;
+    FrustumPlanes frustum(view_projection);
+
+    order.clear();
+    for (uint32_t i = 0; i < items.size(); ++i)
+    {
+        if (!frustum.intersects(items[i].bounds))
+        {
+            ++stats.culled;
+            continue;
+        }
+        order.push_back({get_sort_key(items[i], shaders[items[i].shader]), i});
+    }
+    std::sort(order.begin(), order.end());
+
+    stats.drawn = static_cast<uint32_t>(order.size());
+    if (order.empty())
+    {
+        return stats;
+    }
+
+    // the shadow maps are the same for every draw.
     for (int i = 0; i < NUM_CASCADES; ++i)
-    { 
-        // bind from texture1 onwards. texture0 is for mesh textures atm.
+    {
         glActiveTexture(GL_TEXTURE1 + i);
         glBindTexture(GL_TEXTURE_2D, camera.depth_maps[i]);
-        glUniform1i(glGetUniformLocation(shader.ID, std::string("shadow_map[" + std::to_string(i) + "]").c_str()), i + 1);
-           
     }
+    glActiveTexture(GL_TEXTURE0);
+
+    // what's bound, so only changes reach gl.
+    uint32_t shader         = UINT32_MAX;
+    GLenum polygon_mode     = 0;
+    GLenum cull_face        = GL_BACK;
+    GLuint vao              = 0;
+    GLuint texture          = 0;
+    GLenum texture_target   = GL_TEXTURE_2D;
 
-    for (auto skin : skins)
+    for (const auto &[key, index] : order)
     {
-        // glUniformMatrix4fv(glGetUniformLocation(shader.ID, "joint_matrices"), MAX_JOINTS, GL_FALSE, glm::value_ptr(skin.joint_matrix[0]));
-        glUniformMatrix4fv(glGetUniformLocation(shader.ID, "joint_matrices"), MAX_JOINTS, GL_FALSE, reinterpret_cast<GLfloat *>(skin.joint_matrix.data()));
+        const DrawItem &item = items[index];
+        Shader &item_shader  = shaders[item.shader];
+
+        if (item.shader != shader)
+        {
+            item_shader.use();
+            set_camera_uniforms(item_shader, camera);
+            shader = item.shader;
+        }
+        if (item_shader.mode != polygon_mode)
+        {
+            glPolygonMode(GL_FRONT_AND_BACK, item_shader.mode);
+            polygon_mode = item_shader.mode;
+        }
+        if (item.cull_face != cull_face)
+        {
+            glCullFace(item.cull_face);
+            cull_face = item.cull_face;
+        }
+        if (item.mesh->VAO != vao)
+        {
+            glBindVertexArray(item.mesh->VAO);
+            vao = item.mesh->VAO;
+        }
+        if ((item.texture != texture) || (item.texture_target != texture_target))
+        {
+            glBindTexture(item.texture_target, item.texture);
+            texture         = item.texture;
+            texture_target  = item.texture_target;
+        }
+
+        item_shader.set(UNIFORM_ALBEDO, item.albedo);
+        item_shader.set(UNIFORM_JOINT_OFFSET, item.joint_offset);
+        if (item.instance_count > 0)
+        {
+            set_instance_attributes(item);
+            item_shader.set(UNIFORM_NODE_MATRIX, item.transform);
+            glDrawElementsInstanced(GL_TRIANGLES, item.mesh->index_count, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(item.instance_count));
+        }
+        else
+        {
+            item_shader.set(UNIFORM_MVP, item.transform);
+            glDrawElements(GL_TRIANGLES, item.mesh->index_count, GL_UNSIGNED_INT, 0);
+        }
     }
 
-    // loop through all nodes in the model.
-    for (auto &node : nodes)
+    // leave gl how everything else expects it.
+    if (cull_face != GL_BACK)
     {
-        draw_node(*node, GL_TRIANGLES, transform, shader);
+        glCullFace(GL_BACK);
     }
+    glBindTexture(texture_target, 0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return stats;
 }
 
 template <typename T> const T *get_buffer(tinygltf::Model &model, tinygltf::Primitive primitive, std::string name, int type, int &stride)
@@ -157,38 +444,45 @@ template <typename T> const T *get_buffer(tinygltf::Model &model, tinygltf::Prim
     return buffer;
 }
 
-void Model::load_node(const tinygltf::Node &input_node, tinygltf::Model &input, Node *parent, uint32_t node_index, std::vector<uint32_t> &index_buffer, std::vector<Vertex> &vertex_buffer)
+// parent_matrix is the parent's matrix in the pose it was loaded in, so it isn't rebuilt for every mesh.
+void ModelData::load_node(const tinygltf::Node &input_node, tinygltf::Model &input, int32_t parent, uint32_t node_index, const glm::mat4 &parent_matrix)
 {
-    Node *node      = new Node{};
-    node->parent    = parent;
-    node->index     = node_index;
-    node->skin      = input_node.skin;
-    node->matrix    = glm::mat4(1.0f);
+    Node node{};
+    node.parent     = parent;
+    node.index      = node_index;
+    node.skin       = input_node.skin;
+    node.matrix     = glm::mat4(1.0f);
 
     // get the node's transform, either as in T*R*S format, or a matrix.
     if (!input_node.translation.empty())
     {
-        node->translation = glm::make_vec3(input_node.translation.data());
+        node.translation = glm::make_vec3(input_node.translation.data());
     }
     if (!input_node.rotation.empty())
     {
-        node->rotation = glm::mat4(glm::quat(glm::make_quat(input_node.rotation.data())));
+        node.rotation = glm::mat4(glm::quat(glm::make_quat(input_node.rotation.data())));
     }
     if (!input_node.scale.empty())
     {
-        node->scale = glm::make_vec3(input_node.scale.data());
+        node.scale = glm::make_vec3(input_node.scale.data());
     }
     if (!input_node.matrix.empty())
     {
-        node->matrix = glm::make_mat4x4(input_node.matrix.data());
+        node.matrix = glm::make_mat4x4(input_node.matrix.data());
     }
 
+    // the node goes in before its children so parents always come first.
+    // children are pushed after it, so only index into nodes from here on.
+    glm::mat4 node_matrix   = parent_matrix * node.get_local_matrix();
+    int32_t slot            = static_cast<int32_t>(nodes.size());
+    nodes.push_back(std::move(node));
+
     // load children of node.
     if (input_node.children.size() > 0)
     {
         for (size_t i = 0; i < input_node.children.size(); ++i)
         {
-            load_node(input.nodes[input_node.children[i]], input, node, input_node.children[i], index_buffer, vertex_buffer);
+            load_node(input.nodes[input_node.children[i]], input, slot, input_node.children[i], node_matrix);
         }
     }
 
@@ -205,7 +499,7 @@ void Model::load_node(const tinygltf::Node &input_node, tinygltf::Model &input,
             MeshPrimitive this_mesh{};
             const tinygltf::Primitive &gltf_primitive = mesh.primitives[i];
             uint32_t first_index    = static_cast<uint32_t>(index_buffer.size());
-            uint32_t vertex_start   = static_cast<uint32_t>(vertex_buffer.size());
+            uint32_t first_vertex   = static_cast<uint32_t>(vertex_buffer.size());
             
             // byte strides/lengths for each buffer entry.
             int position_stride     = 0;
@@ -277,11 +571,9 @@ void Model::load_node(const tinygltf::Node &input_node, tinygltf::Model &input,
                 
                 // push back vector and use mesh vertices as collision shape.
                 vertex_buffer.push_back(vertex);
-                this_mesh.vertex_buffer.push_back(vertex);
 
                 // for collider, apply mvp to vertex position exactly like in shader.
-                // this feels like it could be optimised somehow.
-                this_mesh.vertex_collider_buffer.push_back(glm::vec3(get_node_matrix(node) * glm::vec4(vertex.position, 1.0f)));
+                collider_buffer.push_back(glm::vec3(node_matrix * glm::vec4(vertex.position, 1.0f)));
             }
 
             // indices.
@@ -296,8 +588,7 @@ void Model::load_node(const tinygltf::Node &input_node, tinygltf::Model &input,
                     const uint32_t *buffer = reinterpret_cast<const uint32_t*>(&indices_buffer.data[acc.byteOffset + view.byteOffset]);
                     for (size_t j = 0; j < acc.count; ++j)
                     {
-                        index_buffer.push_back(buffer[j] + vertex_start);
-                        this_mesh.index_buffer.push_back(buffer[j]);
+                        index_buffer.push_back(buffer[j]);
                     }
                     break;
                 }
@@ -306,8 +597,7 @@ void Model::load_node(const tinygltf::Node &input_node, tinygltf::Model &input,
                     const uint16_t *buffer = reinterpret_cast<const uint16_t*>(&indices_buffer.data[acc.byteOffset + view.byteOffset]);
                     for (size_t j = 0; j < acc.count; ++j)
                     {
-                        index_buffer.push_back(buffer[j] + vertex_start);
-                        this_mesh.index_buffer.push_back(buffer[j]);
+                        index_buffer.push_back(buffer[j]);
                     }
                     break;
                 }
@@ -316,8 +606,7 @@ void Model::load_node(const tinygltf::Node &input_node, tinygltf::Model &input,
                     const uint8_t *buffer = reinterpret_cast<const uint8_t*>(&indices_buffer.data[acc.byteOffset + view.byteOffset]);
                     for (size_t j = 0; j < acc.count; ++j)
                     {
-                        index_buffer.push_back(buffer[j] + vertex_start);
-                        this_mesh.index_buffer.push_back(buffer[j]);
+                        index_buffer.push_back(buffer[j]);
                     }
                     break;
                 }
@@ -354,20 +643,13 @@ void Model::load_node(const tinygltf::Node &input_node, tinygltf::Model &input,
             }
 
             this_mesh.first_index      = first_index;
-            this_mesh.index_count      = static_cast<uint32_t>(acc.count);
+            this_mesh.index_count      = static_cast<uint32_t>(index_buffer.size()) - first_index;
+            this_mesh.first_vertex     = first_vertex;
+            this_mesh.vertex_count     = static_cast<uint32_t>(vertices_count);
             this_mesh.material_index   = gltf_primitive.material; // this is the id of the texture.
-            node->mesh_primitives.push_back(this_mesh);
+            nodes[slot].mesh_primitives.push_back(this_mesh);
         }
     }
-
-    if (parent)
-    {
-        parent->children.push_back(node);
-    }
-    else
-    {
-        nodes.push_back(node);
-    }
 }
 
 // link vertex attributes such as position, normals, and texcoords to VBO.
@@ -390,7 +672,7 @@ void link_attrib(GLuint VBO, GLuint layout, GLuint size, GLenum type, GLsizeiptr
 }
 
 // binds buffers when loading a mesh.
-void bind_buffers(GLuint &VAO, GLuint &VBO, GLuint &EBO, std::vector<Vertex> vertices, std::vector<GLuint> indices)
+void bind_buffers(GLuint &VAO, GLuint &VBO, GLuint &EBO, std::span<const Vertex> vertices, std::span<const GLuint> indices)
 {
     glGenVertexArrays(1, &VAO); // generate VAO.
     glBindVertexArray(VAO);     // bind VAO.
@@ -418,120 +700,99 @@ void bind_buffers(GLuint &VAO, GLuint &VBO, GLuint &EBO, std::vector<Vertex> ver
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);   // unbind EBO.
 }
 
-void Model::bind_node(Node *node)
+// upload a decoded image as a mipmapped texture, returns the texture id.
+static GLuint upload_texture(int width, int height, int component, int bits, const void *pixels)
 {
-    if (node->mesh_primitives.size() > 0)
+    GLuint texture_ID;
+    GLenum format;
+    GLenum type;
+
+    // generate texture using ID.
+    glGenTextures(1, &texture_ID);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture_ID);
+
+    // texture settings.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);  // dunno what this does lol.
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // GL_LINEAR = bilinear filter.
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR); // GL_LINEAR_MIPMAP_LINEAR = trilinear filter.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    // determine image format from number of components. defaults to rgba.
+    switch (component)
     {
-        for (MeshPrimitive &mesh : node->mesh_primitives)
-        {
-            bind_buffers(mesh.VAO, mesh.VBO, mesh.EBO, mesh.vertex_buffer, mesh.index_buffer);
-        }
+    case 1:
+        format = GL_RED;
+        break;
+    case 2:
+        format = GL_RG;
+        break;
+    case 3:
+        format = GL_RGB;
+        break;
+    default:
+        format = GL_RGBA;
+        break;
     }
 
-    for (auto &child : node->children)
+    // determine image type from number of bits. defaults to 8 bit.
+    switch (bits)
     {
-        bind_node(&*child);
+    case 16:
+        type = GL_UNSIGNED_SHORT;
+        break;
+    case 32:
+        type = GL_UNSIGNED_SHORT;
+        break;
+    default:
+        type = GL_UNSIGNED_BYTE;
+        break;
     }
+
+    // generate texture with parameters.
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, format, type, pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture_ID;
 }
 
-void Model::load_material(tinygltf::Model &input)
+void ModelData::load_material(tinygltf::Model &input)
 {
     for (size_t i = 0; i < input.textures.size(); ++i)
 	{
         Material material;
-        GLenum format;
-        GLenum type;
-        tinygltf::Image texture = input.images[input.textures[i].source];
+        const tinygltf::Image &texture = input.images[input.textures[i].source];
         std::cout << "texture: " << texture.name << "\n";
 
-        // generate texture using ID.
-        glGenTextures(1, &material.texture_ID);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, material.texture_ID);
-
-        // texture settings.
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);  // dunno what this does lol.
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // GL_LINEAR = bilinear filter.
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR); // GL_LINEAR_MIPMAP_LINEAR = trilinear filter.
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-        // determine image format from number of components. defaults to rgba.
-        switch (texture.component)
-        {
-        case 1:
-            format = GL_RED;
-            break;
-        case 2:
-            format = GL_RG;
-            break;
-        case 3:
-            format = GL_RGB;
-            break;
-        default:
-            format = GL_RGBA;
-            break;
-        }
-
-        // determine image type from number of bits. defaults to 8 bit.
-        switch (texture.bits)
-        {
-        case 16:
-            type = GL_UNSIGNED_SHORT;
-            break;
-        case 32:
-            type = GL_UNSIGNED_SHORT;
-            break;
-        default:
-            type = GL_UNSIGNED_BYTE;
-            break;
-        }
-
-        // generate texture with parameters.
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.width, texture.height, 0, format, type, texture.image.data());
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        // the texture id is filled in when it's uploaded.
+        PendingTexture pending;
+        pending.width       = texture.width;
+        pending.height      = texture.height;
+        pending.component   = texture.component;
+        pending.bits        = texture.bits;
+        pending.pixels      = texture.image;    // copied, textures can share an image.
+        pending_textures.push_back(std::move(pending));
 
         // push material with id to vector in model.
         materials.push_back(material);
     }
 }
 
-// recrusive function to locate specific gltf node.
-Node *Model::find_node(Node *parent, uint32_t index)
+int32_t ModelData::node_from_index(uint32_t index) const
 {
-    Node *node_found = nullptr;
-    if (parent->index == index)
-    {
-        return parent;
-    }
-    for (auto &child : parent->children)
+    for (size_t i = 0; i < nodes.size(); ++i)
     {
-        node_found = find_node(child, index);
-        if (node_found)
+        if (nodes[i].index == index)
         {
-            break;
+            return static_cast<int32_t>(i);
         }
     }
-    return node_found;
-}
-
-Node *Model::node_from_index(uint32_t index)
-{
-    Node *node_found = nullptr;
-    for (auto &node : nodes)
-    {
-        node_found = find_node(node, index);
-        if (node_found)
-        {
-            break;
-        }
-    }
-    return node_found;
+    return -1;
 }
 
 // basically just gets the inverse bind matrix of each node that is a joint.
-void Model::load_skins(tinygltf::Model &input)
+void ModelData::load_skins(tinygltf::Model &input)
 {
     // resize model's skin vector according to gltf being loaded.
     if (input.skins.size() > 0)
@@ -542,7 +803,7 @@ void Model::load_skins(tinygltf::Model &input)
         for (size_t i = 0; i < input.skins.size(); ++i)
         {
             tinygltf::Skin gltf_skin    = input.skins[i];
-            skins[i].skeleton_root      = node_from_index(gltf_skin.skeleton);
+            skins[i].skeleton_root      = (gltf_skin.skeleton > -1) ? node_from_index(gltf_skin.skeleton) : -1;
             skins[i].name               = gltf_skin.name;
             cout << "skin: " << skins[i].name << " (" << gltf_skin.joints.size() << " joints)\n";
 
@@ -550,11 +811,11 @@ void Model::load_skins(tinygltf::Model &input)
             // "The order of joints is defined in the skin.joints array and it must match the order of inverseBindMatrices data."
             for (int joint_id : gltf_skin.joints)
             { 
-                Node *node = node_from_index(joint_id);
-                if (node)
+                int32_t node = node_from_index(joint_id);
+                if (node > -1)
                 {
-                    // cout << "Joint ID: " << node->index << "\n";
-                    skins[i].joints.push_back(node);
+                    // cout << "Joint ID: " << nodes[node].index << "\n";
+                    skins[i].joints.push_back(static_cast<uint32_t>(node));
                 }
             }
 
@@ -586,13 +847,7 @@ void Model::load_skins(tinygltf::Model &input)
     }
 }
 
-// reset animation to initial frame.
-void Animation::reset()
-{
-    current_time = start;
-}
-
-void Model::load_animations(tinygltf::Model &input)
+void ModelData::load_animations(tinygltf::Model &input)
 {
     animations.resize(input.animations.size());
 
@@ -608,7 +863,7 @@ void Model::load_animations(tinygltf::Model &input)
         {
             tinygltf::AnimationSampler gltf_sampler = gltf_animation.samplers[j];
             AnimationSampler &dst_sampler           = animations[i].samplers[j];
-            dst_sampler.interpolation               = gltf_sampler.interpolation;
+            dst_sampler.interpolation               = AnimationSampler::from_name(gltf_sampler.interpolation);
 
             // read sampler keyframe input time values.
             const tinygltf::Accessor &input_acc     = input.accessors[gltf_sampler.input];
@@ -635,218 +890,958 @@ void Model::load_animations(tinygltf::Model &input)
                 }
             }
 
-            // get translate/rotate/scale from keyframe.
-            const tinygltf::Accessor &output_acc    = input.accessors[gltf_sampler.output];
-            const tinygltf::BufferView &output_view = input.bufferViews[output_acc.bufferView];
-            const tinygltf::Buffer &output_buffer   = input.buffers[output_view.buffer];
-            const void *output_data_ptr             = &output_buffer.data[output_acc.byteOffset + output_view.byteOffset];
+            // get translate/rotate/scale from keyframe.
+            const tinygltf::Accessor &output_acc    = input.accessors[gltf_sampler.output];
+            const tinygltf::BufferView &output_view = input.bufferViews[output_acc.bufferView];
+            const tinygltf::Buffer &output_buffer   = input.buffers[output_view.buffer];
+            const void *output_data_ptr             = &output_buffer.data[output_acc.byteOffset + output_view.byteOffset];
+
+            assert(output_acc.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+
+            switch (output_acc.type)
+            {
+                case TINYGLTF_TYPE_VEC3: 
+                {
+                    const glm::vec3 *buffer = static_cast<const glm::vec3 *>(output_data_ptr);
+                    for (size_t index = 0; index < output_acc.count; ++index)
+                    {
+                        dst_sampler.outputs_vec4.push_back(glm::vec4(buffer[index], 0.0f));
+                    }
+                    break;
+                }
+                case TINYGLTF_TYPE_VEC4: 
+                {
+                    const glm::vec4 *buffer = static_cast<const glm::vec4 *>(output_data_ptr);
+                    for (size_t index = 0; index < output_acc.count; ++index)
+                    {
+                        dst_sampler.outputs_vec4.push_back(buffer[index]);
+                    }
+                    break;
+                }
+                default: 
+                {
+                    cout << "unknown type in animation: " << output_acc.type << "\n";
+                    break;
+                }
+            }
+        }
+
+        // channels.
+        animations[i].channels.resize(gltf_animation.channels.size());
+        for (size_t j = 0; j < gltf_animation.channels.size(); ++j)
+        {
+            tinygltf::AnimationChannel gltf_channel = gltf_animation.channels[j];
+            AnimationChannel &dst_channel           = animations[i].channels[j];
+            dst_channel.path                        = AnimationChannel::from_name(gltf_channel.target_path);
+            dst_channel.sampler_index               = gltf_channel.sampler;
+            dst_channel.node                        = node_from_index(gltf_channel.target_node);
+        }
+    }
+}
+
+AnimationSampler::Interpolation AnimationSampler::from_name(const std::string &name)
+{
+    if (name == "STEP")         { return STEP; }
+    if (name == "CUBICSPLINE")  { return CUBICSPLINE; }
+    if (name != "LINEAR")
+    {
+        cout << "unknown interpolation: " << name << ", using linear.\n";
+    }
+    return LINEAR;
+}
+
+const char *AnimationSampler::get_name(Interpolation interpolation)
+{
+    switch (interpolation)
+    {
+    case STEP:          return "STEP";
+    case CUBICSPLINE:   return "CUBICSPLINE";
+    default:            return "LINEAR";
+    }
+}
+
+AnimationChannel::Path AnimationChannel::from_name(const std::string &name)
+{
+    if (name == "translation")  { return TRANSLATION; }
+    if (name == "rotation")     { return ROTATION; }
+    if (name == "scale")        { return SCALE; }
+    return WEIGHTS;
+}
+
+const char *AnimationChannel::get_name(Path path)
+{
+    switch (path)
+    {
+    case TRANSLATION:   return "translation";
+    case ROTATION:      return "rotation";
+    case SCALE:         return "scale";
+    default:            return "weights";
+    }
+}
+
+#define KEY_QUANTA              65535.0f    // steps in a 16 bit key time or range quantised component.
+#define SMALLEST_THREE_QUANTA   32767.0f    // steps in a smallest three component, the top bit of the first two holds the largest's index.
+#define SMALLEST_THREE_LIMIT    0.70710678f // no component but the largest can be more than 1/sqrt(2).
+
+float AnimationSampler::get_time(size_t key) const
+{
+    if (encoding == RAW)
+    {
+        return inputs[key];
+    }
+
+    // written so the first and last keys come back as exactly start and end.
+    float fraction = times[key] / KEY_QUANTA;
+    return start * (1.0f - fraction) + end * fraction;
+}
+
+glm::vec4 AnimationSampler::get_value(size_t output) const
+{
+    switch (encoding)
+    {
+    case RANGE:
+    {
+        const uint16_t *value = &values[output * 3];
+        return glm::vec4(range_min + range_size * glm::vec3(value[0], value[1], value[2]) / KEY_QUANTA, 0.0f);
+    }
+    case SMALLEST_THREE:
+    {
+        const uint16_t *value   = &values[output * 3];
+        int largest             = ((value[0] >> 15) << 1) | (value[1] >> 15);
+        glm::vec4 rotation;
+        float sum               = 0.0f;
+        for (int i = 0, j = 0; i < 4; ++i)
+        {
+            if (i != largest)
+            {
+                rotation[i] = ((value[j++] & 0x7fff) / SMALLEST_THREE_QUANTA * 2.0f - 1.0f) * SMALLEST_THREE_LIMIT;
+                sum         += rotation[i] * rotation[i];
+            }
+        }
+        rotation[largest] = std::sqrt(std::max(1.0f - sum, 0.0f));
+        return rotation;
+    }
+    default:
+    {
+        return outputs_vec4[output];
+    }
+    }
+}
+
+size_t AnimationSampler::get_size() const
+{
+    return inputs.size() * sizeof(float) + outputs_vec4.size() * sizeof(glm::vec4) + outputs_float.size() * sizeof(float)
+         + times.size() * sizeof(uint16_t) + values.size() * sizeof(uint16_t);
+}
+
+// the key that starts the interval time is in, time has to be between the first and last keys.
+// time only moves on a little each tick, so the cursor's key and the one after it are tried first
+// and only a jump (a loop, a new animation) has to binary search.
+static uint32_t find_key(const AnimationSampler &sampler, float time, uint32_t &cursor)
+{
+    uint32_t last = static_cast<uint32_t>(sampler.get_key_count()) - 2;   // the last key that starts an interval.
+    for (uint32_t key = cursor; (key <= last) && (key <= cursor + 1); ++key)
+    {
+        if ((sampler.get_time(key) <= time) && (time < sampler.get_time(key + 1)))
+        {
+            cursor = key;
+            return key;
+        }
+    }
+
+    // the first key after time.
+    uint32_t low    = 0;
+    uint32_t high   = last + 2;
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (sampler.get_time(middle) <= time)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    cursor = std::clamp<uint32_t>(low, 1, last + 1) - 1;
+    return cursor;
+}
+
+// t of the way from one linear key's value to the next, slerped for a rotation.
+static glm::vec4 lerp_value(AnimationChannel::Path path, const glm::vec4 &current, const glm::vec4 &target, float t)
+{
+    if (path == AnimationChannel::ROTATION)
+    {
+        glm::quat rotation = glm::slerp(glm::quat(current.w, current.x, current.y, current.z), glm::quat(target.w, target.x, target.y, target.z), t);
+        return glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+    }
+    return glm::mix(current, target, t);
+}
+
+// the sampler's value t of the way from key to the next one, length is the time between them.
+static glm::vec4 interpolate(const AnimationSampler &sampler, AnimationChannel::Path path, uint32_t key, float t, float length)
+{
+    switch (sampler.interpolation)
+    {
+    case AnimationSampler::STEP:
+    {
+        return sampler.get_value((t < 1.0f) ? key : key + 1);
+    }
+    case AnimationSampler::CUBICSPLINE:
+    {
+        // hermite spline, the tangents are per second so they're scaled by the interval.
+        float t2 = t * t;
+        float t3 = t2 * t;
+        return (2.0f * t3 - 3.0f * t2 + 1.0f)   * sampler.get_value(key * 3 + 1)
+             + (t3 - 2.0f * t2 + t)             * sampler.get_value(key * 3 + 2) * length
+             + (-2.0f * t3 + 3.0f * t2)         * sampler.get_value((key + 1) * 3 + 1)
+             + (t3 - t2)                        * sampler.get_value((key + 1) * 3) * length;
+    }
+    default:
+    {
+        return lerp_value(path, sampler.get_value(key), sampler.get_value(key + 1), t);
+    }
+    }
+}
+
+// sets every transform the animation drives to where it is at the given time, and flags them in dirty if it's given.
+// cursors (by channel) keep each channel's place between calls, without them every channel binary searches.
+// a channel leaves its transform alone if time is outside its keys.
+static void sample_animation(const Animation &animation, float time, std::vector<NodeTransform> &transforms,
+                             std::vector<uint8_t> *dirty = nullptr, std::vector<uint32_t> *cursors = nullptr)
+{
+    for (size_t i = 0; i < animation.channels.size(); ++i)
+    {
+        const AnimationChannel &channel = animation.channels[i];
+        const AnimationSampler &sampler = animation.samplers[channel.sampler_index];
+        size_t key_count                = sampler.get_key_count();
+        if ((channel.node < 0) || (channel.path == AnimationChannel::WEIGHTS) || (key_count < 2) ||
+            (time < sampler.get_time(0)) || (time > sampler.get_time(key_count - 1)))
+        {
+            continue;
+        }
+
+        uint32_t search     = 0;
+        uint32_t key        = find_key(sampler, time, cursors ? (*cursors)[i] : search);
+        float key_time      = sampler.get_time(key);
+        float length        = sampler.get_time(key + 1) - key_time;
+        float t             = (length > 0.0f) ? (time - key_time) / length : 1.0f;    // keys can share a time once quantised.
+        glm::vec4 value     = interpolate(sampler, channel.path, key, t, length);
+
+        NodeTransform &transform = transforms[channel.node];
+        switch (channel.path)
+        {
+        case AnimationChannel::TRANSLATION:
+            transform.translation   = value;
+            break;
+        case AnimationChannel::ROTATION:
+            transform.rotation      = glm::normalize(glm::quat(value.w, value.x, value.y, value.z));
+            break;
+        default:
+            transform.scale         = value;
+            break;
+        }
+
+        if (dirty)
+        {
+            (*dirty)[channel.node] = NODE_DIRTY_LOCAL | NODE_DIRTY_WORLD;
+        }
+    }
+}
+
+void Model::update_animations(float delta_time, uint32_t animation_index)
+{
+    if (data->animations.empty())
+    {
+        return;
+    }
+
+    if (animation_index > static_cast<uint32_t>(data->animations.size()) - 1)
+    {
+        // cout << "no animation with index: " << animation_index << "\n";
+        return;
+    }
+
+    if (animation_index != active_animation)
+    {
+        // cout << "Animation: " << animation_index << "\n";
+    }
+
+    const Animation &animation  = data->animations[animation_index];
+    float &current_time         = animation_times[animation_index];
+    current_time                += delta_time;
+
+    // either loop animation, or let it play once.
+    if (current_time > animation.end)
+    {
+        if (animation.loop)
+        {
+            current_time -= animation.end;
+        }
+        else
+        {
+            current_time = animation.end;
+        }
+    }
+
+    sample_animation(animation, current_time, transforms, &dirty, &key_cursors[animation_index]);
+    active_animation = animation_index;
+
+    // finally, update the joints with the animation.
+    update_world_matrices();
+    update_joints();
+}
+
+// put every node, animation and joint back how they were straight after loading.
+void Model::reset_pose()
+{
+    transforms          = data->initial_pose;
+    active_animation    = data->initial_animation;
+    animation_times.assign(data->animations.size(), 0.0f);
+    key_cursors.resize(data->animations.size());
+    for (size_t i = 0; i < data->animations.size(); ++i)
+    {
+        key_cursors[i].assign(data->animations[i].channels.size(), 0);
+    }
+
+    std::array<glm::mat4, MAX_JOINTS> identity;
+    identity.fill(glm::mat4(1.0f));
+    joint_matrices.assign(data->skins.size(), identity);
+
+    // everything is recomputed from the new transforms.
+    local_matrices.resize(data->nodes.size());
+    world_matrices.resize(data->nodes.size());
+    dirty.assign(data->nodes.size(), NODE_DIRTY_LOCAL | NODE_DIRTY_WORLD);
+    update_world_matrices();
+    update_joints();
+}
+
+// reads the world matrices, so update_world_matrices() first.
+void Model::update_joints()
+{
+    for (uint32_t i = 0; i < data->nodes.size(); ++i)
+    {
+        // if current node has a skin associated with it...:
+        const Node &node = data->nodes[i];
+        if (!node.mesh_primitives.empty() && (node.skin > -1))
+        {
+            // get the inverse of the node containing the skin, as it needs to be ignored.
+            glm::mat4 inverse_transform = glm::inverse(get_node_matrix(i));
+            const Skin &skin            = data->skins[node.skin];
+
+            // loop through each joint in the skin.
+            for (size_t j = 0; j < skin.joints.size(); ++j)
+            {
+                // "jointMatrix[j] = inverse(globalTransform) * globalJointTransform[j] * inverseBindMatrix[j];"
+                joint_matrices[node.skin][j] = inverse_transform * get_node_matrix(skin.joints[j]) * skin.inverse_bind_matrices[j];
+            }
+        }
+    }
+}
+
+Model::Model(std::string filename)
+{
+    load(filename);
+    size_t budget = SIZE_MAX;
+    upload(budget);
+}
+
+bool Model::load(const std::string &filename)
+{
+    data = acquire_model(filename);
+    reset_pose();
+    return data->loaded;
+}
+
+bool Model::upload(size_t &budget)
+{
+    return data ? data->upload(budget) : true;
+}
+
+void Model::release()
+{
+    release_model(data);
+}
+
+// load a model from a .gltf file (works with both combined and seperate, but not .glb).
+// an up to date .bake next to it is used instead if there is one (see asset.hpp).
+bool ModelData::load(const std::string &filename)
+{
+    if (load_baked(filename))
+    {
+        cout << "\n";
+        loaded = true;
+        return true;
+    }
+
+    tinygltf::Model glTF_input;         // stores .gltf model reference.
+    tinygltf::TinyGLTF glTF_context;    // stores ASCII from file.
+    std::string error;                  // outputs warning if fails to load properly.
+    std::string warning;                // outputs error if any errors.
+
+    loaded = glTF_context.LoadASCIIFromFile(&glTF_input, &error, &warning, MODELS_PATH + filename);
+    if (!error.empty())     { cout << "ERR: " << error << "\n"; }
+    if (!warning.empty())   { cout << "WARN: " << warning << "\n"; }
+
+    // if loaded correctly, load file contents.
+    if (loaded)
+    {
+        cout << "model: " << filename << "\n";
+        load_gltf(glTF_input);
+    }
+    cout << "\n";
+    return loaded;
+}
+
+// textures go first so a part uploaded model at least has its materials, each texture or mesh is
+// uploaded whole, so the last one can go over the budget.
+bool ModelData::upload(size_t &budget)
+{
+    while (!pending_textures.empty() && (budget > 0))
+    {
+        const PendingTexture &texture   = pending_textures.back();
+        const uint8_t *pixels           = texture.pixels.data();
+        if (texture.pixels.empty() && baked)
+        {
+            pixels = baked->get<uint8_t>(BAKE_PIXELS, texture.baked_pixels).data();
+        }
+        materials[pending_textures.size() - 1].texture_ID = upload_texture(texture.width, texture.height, texture.component, texture.bits, pixels);
+        budget -= std::min(budget, texture.get_size());
+        pending_textures.pop_back();
+    }
+
+    while (!pending_meshes.empty() && (budget > 0))
+    {
+        MeshPrimitive &mesh = *pending_meshes.back();
+        bind_buffers(mesh.VAO, mesh.VBO, mesh.EBO, get_vertices(mesh), get_indices(mesh));
+        budget -= std::min(budget, mesh.vertex_count * sizeof(Vertex) + mesh.index_count * sizeof(uint32_t));
+        pending_meshes.pop_back();
+    }
+    return is_uploaded();
+}
+
+// meshes and textures still pending have nothing in gl yet, their ids are 0.
+void ModelData::release()
+{
+    for (Node &node : nodes)
+    {
+        for (MeshPrimitive &mesh : node.mesh_primitives)
+        {
+            if (mesh.VAO)
+            {
+                glDeleteVertexArrays(1, &mesh.VAO);
+                glDeleteBuffers(1, &mesh.VBO);
+                glDeleteBuffers(1, &mesh.EBO);
+                mesh.VAO = mesh.VBO = mesh.EBO = 0;
+            }
+        }
+    }
+
+    for (Material &material : materials)
+    {
+        if (material.texture_ID)
+        {
+            glDeleteTextures(1, &material.texture_ID);
+            material.texture_ID = 0;
+        }
+    }
+}
+
+// after either load: queues the meshes for upload and works out the pose instances start in.
+// the node array doesn't change once loaded, so the queued meshes don't move.
+// loading used to play the first frame of every animation in turn, so the starting pose is what the last one leaves.
+void ModelData::finish_load()
+{
+    initial_pose.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        for (MeshPrimitive &mesh : nodes[i].mesh_primitives)
+        {
+            pending_meshes.push_back(&mesh);
+        }
+        initial_pose[i] = NodeTransform{nodes[i].translation, nodes[i].rotation, nodes[i].scale};
+    }
+
+    for (size_t i = 0; i < animations.size(); ++i)
+    {
+        sample_animation(animations[i], 0.0f, initial_pose);
+        initial_animation = static_cast<uint32_t>(i);
+    }
+
+    compute_bounds();
+}
+
+// largest difference between two values' components. q and -q are the same rotation.
+static float get_value_error(AnimationChannel::Path path, const glm::vec4 &a, const glm::vec4 &b)
+{
+    glm::vec4 difference = glm::abs(a - b);
+    if (path == AnimationChannel::ROTATION)
+    {
+        difference = glm::min(difference, glm::abs(a + b));
+    }
+    return std::max({difference.x, difference.y, difference.z, difference.w});
+}
+
+static uint16_t quantise(float value, float scale)
+{
+    return static_cast<uint16_t>(std::clamp(value * scale + 0.5f, 0.0f, scale));
+}
 
-            assert(output_acc.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+// every key of a RAW sampler quantised, into a sampler of its own so they can be decoded as they will be when sampled.
+static AnimationSampler encode_keys(const AnimationSampler &sampler, AnimationChannel::Path path)
+{
+    AnimationSampler encoded;
+    encoded.interpolation   = sampler.interpolation;
+    encoded.start           = sampler.inputs.front();
+    encoded.end             = sampler.inputs.back();
+    float duration          = encoded.end - encoded.start;
+    for (float input : sampler.inputs)
+    {
+        encoded.times.push_back(quantise((duration > 0.0f) ? (input - encoded.start) / duration : 0.0f, KEY_QUANTA));
+    }
 
-            switch (output_acc.type)
+    if (path == AnimationChannel::ROTATION)
+    {
+        encoded.encoding = AnimationSampler::SMALLEST_THREE;
+        for (const glm::vec4 &output : sampler.outputs_vec4)
+        {
+            glm::vec4 rotation  = glm::normalize(output);
+            int largest         = 0;
+            for (int i = 1; i < 4; ++i)
             {
-                case TINYGLTF_TYPE_VEC3: 
-                {
-                    const glm::vec3 *buffer = static_cast<const glm::vec3 *>(output_data_ptr);
-                    for (size_t index = 0; index < output_acc.count; ++index)
-                    {
-                        dst_sampler.outputs_vec4.push_back(glm::vec4(buffer[index], 0.0f));
-                    }
-                    break;
-                }
-                case TINYGLTF_TYPE_VEC4: 
-                {
-                    const glm::vec4 *buffer = static_cast<const glm::vec4 *>(output_data_ptr);
-                    for (size_t index = 0; index < output_acc.count; ++index)
-                    {
-                        dst_sampler.outputs_vec4.push_back(buffer[index]);
-                    }
-                    break;
-                }
-                default: 
+                largest = (std::abs(rotation[i]) > std::abs(rotation[largest])) ? i : largest;
+            }
+            // the largest is rebuilt positive, and -q is the same rotation.
+            rotation = (rotation[largest] < 0.0f) ? -rotation : rotation;
+
+            uint16_t value[3];
+            for (int i = 0, j = 0; i < 4; ++i)
+            {
+                if (i != largest)
                 {
-                    cout << "unknown type in animation: " << output_acc.type << "\n";
-                    break;
+                    value[j++] = quantise((rotation[i] / SMALLEST_THREE_LIMIT + 1.0f) * 0.5f, SMALLEST_THREE_QUANTA);
                 }
             }
+            value[0] |= static_cast<uint16_t>((largest >> 1) << 15);
+            value[1] |= static_cast<uint16_t>((largest & 1) << 15);
+            encoded.values.insert(encoded.values.end(), value, value + 3);
         }
-
-        // channels.
-        animations[i].channels.resize(gltf_animation.channels.size());
-        for (size_t j = 0; j < gltf_animation.channels.size(); ++j)
+    }
+    else
+    {
+        encoded.encoding    = AnimationSampler::RANGE;
+        glm::vec3 range_max = glm::vec3(sampler.outputs_vec4.front());
+        encoded.range_min   = range_max;
+        for (const glm::vec4 &output : sampler.outputs_vec4)
         {
-            tinygltf::AnimationChannel gltf_channel = gltf_animation.channels[j];
-            AnimationChannel &dst_channel           = animations[i].channels[j];
-            dst_channel.path                        = gltf_channel.target_path;
-            dst_channel.sampler_index               = gltf_channel.sampler;
-            dst_channel.node                        = node_from_index(gltf_channel.target_node);
+            encoded.range_min   = glm::min(encoded.range_min, glm::vec3(output));
+            range_max           = glm::max(range_max, glm::vec3(output));
+        }
+        encoded.range_size = range_max - encoded.range_min;
+        for (const glm::vec4 &output : sampler.outputs_vec4)
+        {
+            glm::vec3 value = glm::vec3(output) - encoded.range_min;
+            for (int i = 0; i < 3; ++i)
+            {
+                encoded.values.push_back(quantise((encoded.range_size[i] > 0.0f) ? value[i] / encoded.range_size[i] : 0.0f, KEY_QUANTA));
+            }
         }
-
-        update_animations(0.0f, i);
     }
+    return encoded;
 }
 
-void Model::update_animations(float delta_time, uint32_t animation_index)
+// the keys a linear or step sampler can't do without, given every key encoded.
+// a linear key goes if interpolating over it, between the encoded last kept key and the one after it, stays within
+// tolerance of every source key dropped since. a step key goes if the encoded last kept key is within tolerance of it.
+// measuring against the encoded keys means the tolerance covers the quantisation as well as the dropped keys.
+static std::vector<uint32_t> reduce_keys(const AnimationSampler &sampler, const AnimationSampler &encoded, AnimationChannel::Path path, float tolerance)
 {
-    if (animations.empty())
+    const std::vector<float> &inputs        = sampler.inputs;
+    const std::vector<glm::vec4> &outputs   = sampler.outputs_vec4;
+    std::vector<uint32_t> kept              = {0};
+    for (uint32_t i = 1; i + 1 < inputs.size(); ++i)
     {
-        return;
+        uint32_t anchor     = kept.back();
+        glm::vec4 current   = encoded.get_value(anchor);
+        bool needed         = false;
+        if (sampler.interpolation == AnimationSampler::STEP)
+        {
+            needed = get_value_error(path, current, outputs[i]) > tolerance;
+        }
+        else
+        {
+            glm::vec4 target    = encoded.get_value(i + 1);
+            float anchor_time   = encoded.get_time(anchor);
+            float length        = encoded.get_time(i + 1) - anchor_time;
+            for (uint32_t dropped = anchor + 1; (dropped <= i) && !needed; ++dropped)
+            {
+                float t     = (length > 0.0f) ? std::clamp((inputs[dropped] - anchor_time) / length, 0.0f, 1.0f) : 1.0f;
+                needed      = get_value_error(path, lerp_value(path, current, target, t), outputs[dropped]) > tolerance;
+            }
+        }
+        if (needed)
+        {
+            kept.push_back(i);
+        }
     }
+    kept.push_back(static_cast<uint32_t>(inputs.size() - 1));
+    return kept;
+}
 
-    if (animation_index > static_cast<uint32_t>(animations.size()) - 1)
+// drops every encoded key but the given ones.
+static void keep_keys(AnimationSampler &encoded, const std::vector<uint32_t> &keys)
+{
+    std::vector<uint16_t> times;
+    std::vector<uint16_t> values;
+    for (uint32_t key : keys)
     {
-        // cout << "no animation with index: " << animation_index << "\n";
-        return;
+        times.push_back(encoded.times[key]);
+        values.insert(values.end(), &encoded.values[key * 3], &encoded.values[key * 3] + 3);
     }
+    encoded.times.swap(times);
+    encoded.values.swap(values);
+}
 
-    if (animation_index != active_animation)
+// largest difference between a RAW sampler's keys and the encoded sampler sampled at the same times, the way animations are.
+static float get_encoding_error(const AnimationSampler &sampler, const AnimationSampler &encoded, AnimationChannel::Path path)
+{
+    float max_error = 0.0f;
+    uint32_t cursor = 0;
+    for (size_t i = 0; i < sampler.inputs.size(); ++i)
     {
-        // cout << "Animation: " << animation_index << "\n";
+        uint32_t key    = find_key(encoded, sampler.inputs[i], cursor);
+        float key_time  = encoded.get_time(key);
+        float length    = encoded.get_time(key + 1) - key_time;
+        float t         = (length > 0.0f) ? (sampler.inputs[i] - key_time) / length : 1.0f;
+        max_error       = std::max(max_error, get_value_error(path, interpolate(encoded, path, key, t, length), sampler.outputs_vec4[i]));
     }
+    return max_error;
+}
 
-    Animation &animation        = animations[animation_index];
-    animation.current_time      += delta_time;
-
-    // either loop animation, or let it play once.
-    if (animation.current_time > animation.end)
+void ModelData::compress_animations()
+{
+    for (Animation &animation : animations)
     {
-        if (animation.loop)
+        // a sampler is compressed for the path its channels use, it's left as it is if they don't agree.
+        std::vector<int> paths(animation.samplers.size(), -1);
+        for (const AnimationChannel &channel : animation.channels)
         {
-            animation.current_time -= animation.end;
+            if (channel.sampler_index < paths.size())
+            {
+                int &path   = paths[channel.sampler_index];
+                path        = ((path == -1) || (path == channel.path)) ? channel.path : AnimationChannel::WEIGHTS;
+            }
         }
-        else
+
+        size_t raw_size     = 0;
+        size_t size         = 0;
+        size_t raw_keys     = 0;
+        size_t keys         = 0;
+        float max_error     = 0.0f;
+        for (size_t i = 0; i < animation.samplers.size(); ++i)
+        {
+            AnimationSampler &sampler = animation.samplers[i];
+            raw_size += sampler.get_size();
+            raw_keys += sampler.get_key_count();
+
+            // cubic splines keep their tangents as they are, reducing them would need refitting the curve.
+            AnimationChannel::Path path = static_cast<AnimationChannel::Path>(paths[i]);
+            if ((sampler.encoding == AnimationSampler::RAW) && (sampler.interpolation != AnimationSampler::CUBICSPLINE) &&
+                (paths[i] > -1) && (path != AnimationChannel::WEIGHTS) &&
+                (sampler.inputs.size() >= 2) && (sampler.outputs_vec4.size() == sampler.inputs.size()))
+            {
+                AnimationSampler encoded = encode_keys(sampler, path);
+                keep_keys(encoded, reduce_keys(sampler, encoded, path, animation_tolerance));
+                max_error   = std::max(max_error, get_encoding_error(sampler, encoded, path));
+                sampler     = std::move(encoded);
+            }
+
+            size += sampler.get_size();
+            keys += sampler.get_key_count();
+        }
+
+        if (raw_size > 0)
         {
-            animation.current_time = animation.end;
+            cout << "animation: " << animation.name << " " << raw_size << " -> " << size << " bytes ("
+                 << (100 * (raw_size - size) / raw_size) << "% saved), keys " << raw_keys << " -> " << keys << ", max error " << max_error << "\n";
         }
     }
+}
+
+// model space matrices of every node in a pose, by node.
+static void get_pose_matrices(const std::vector<Node> &nodes, const std::vector<NodeTransform> &pose, std::vector<glm::mat4> &matrices)
+{
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        glm::mat4 local = pose[i].get_matrix(nodes[i].matrix);
+        matrices[i]     = (nodes[i].parent > -1) ? matrices[nodes[i].parent] * local : local;
+    }
+}
+
+// a skinned mesh and the bind space bounds of the vertices each of its joints moves.
+struct SkinnedBounds
+{
+    MeshPrimitive *mesh;
+    const Skin *skin;
+    std::vector<AABB> joint_bounds;
+};
 
-    for (auto &channel : animation.channels)
+static void collect_bounds(ModelData &data, Node &node, std::vector<SkinnedBounds> &skinned)
+{
+    for (MeshPrimitive &mesh : node.mesh_primitives)
     {
-        AnimationSampler &sampler = animation.samplers[channel.sampler_index];
-        for (size_t i = 0; i < sampler.inputs.size() - 1; ++i)
+        mesh.bounds = AABB();
+        if (node.skin < 0)
         {
-            if (sampler.interpolation != "LINEAR")
+            for (const Vertex &vertex : data.get_vertices(mesh))
             {
-                cout << "only linear interpolations supported." << "\n";
-                continue;
+                mesh.bounds.expand(vertex.position);
             }
+            continue;
+        }
 
-            // get input keyframes for the current time value.
-            if ((animation.current_time >= sampler.inputs[i]) && (animation.current_time <= sampler.inputs[i + 1]))
+        // a vertex is somewhere between its joints' versions of it, so the boxes of every joint
+        // with weight on it are enough to cover it in any pose.
+        const Skin &skin = data.skins[node.skin];
+        SkinnedBounds bounds{&mesh, &skin, std::vector<AABB>(skin.joints.size())};
+        for (const Vertex &vertex : data.get_vertices(mesh))
+        {
+            for (int i = 0; i < 4; ++i)
             {
-                float interpolation     = (animation.current_time - sampler.inputs[i]) / (sampler.inputs[i + 1] - sampler.inputs[i]);
-                glm::vec4 current_frame = sampler.outputs_vec4[i];
-                glm::vec4 target_frame  = sampler.outputs_vec4[i + 1];
-
-                if (channel.path == "translation")
-                {
-                    channel.node->translation = glm::mix(current_frame, target_frame, interpolation);
-                }
-            
-                if (channel.path == "rotation")
-                {
-                    glm::quat current_quat  = glm::quat(current_frame.w,    current_frame.x,    current_frame.y,    current_frame.z);
-                    glm::quat target_quat   = glm::quat(target_frame.w,     target_frame.x,     target_frame.y,     target_frame.z);
-                    channel.node->rotation  = glm::normalize(glm::slerp(current_quat, target_quat, interpolation));
-                }
-
-                if (channel.path == "scale")
+                uint32_t joint = static_cast<uint32_t>(vertex.joint_indices[i]);
+                if ((vertex.joint_weights[i] > 0.0f) && (joint < skin.joints.size()))
                 {
-                    channel.node->scale = glm::mix(current_frame, target_frame, interpolation);
+                    bounds.joint_bounds[joint].expand(glm::vec3(skin.inverse_bind_matrices[joint] * glm::vec4(vertex.position, 1.0f)));
                 }
             }
         }
+        skinned.push_back(std::move(bounds));
     }
+}
 
-    active_animation = animation_index;
-
-    // finally, update the joints with the animation.
+// bounds for culling. a skinned mesh's cover the initial pose and every animation sampled at ANIMATION_BOUNDS_RATE,
+// by moving each joint's box with the joint rather than skinning every vertex in every sample.
+void ModelData::compute_bounds()
+{
+    std::vector<SkinnedBounds> skinned;
     for (auto &node : nodes)
     {
-        update_joints(node);
+        collect_bounds(*this, node, skinned);
+    }
+    if (skinned.empty())
+    {
+        return;
     }
-}
 
-void Model::update_joints(Node *node)
-{
-    // if current node has a skin associated with it...:
-    if (!node->mesh_primitives.empty())
+    std::vector<NodeTransform> pose = initial_pose;
+    std::vector<glm::mat4> matrices(nodes.size());
+    auto add_pose = [&]()
     {
-        auto m = get_node_matrix(node);
-        if (node->skin > -1)
+        get_pose_matrices(nodes, pose, matrices);
+        for (SkinnedBounds &bounds : skinned)
         {
-            // get the inverse of the node containing the skin, as it needs to be ignored.
-            glm::mat4 inverse_transform = glm::inverse(m);
-
-            // loop through each joint in the skin.
-            for (size_t i = 0; i < skins[node->skin].joints.size(); ++i)
+            for (size_t joint = 0; joint < bounds.joint_bounds.size(); ++joint)
             {
-                // "jointMatrix[j] = inverse(globalTransform) * globalJointTransform[j] * inverseBindMatrix[j];"
-                skins[node->skin].joint_matrix[i] = inverse_transform * get_node_matrix(skins[node->skin].joints[i]) * skins[node->skin].inverse_bind_matrices[i];
+                if (!bounds.joint_bounds[joint].is_empty())
+                {
+                    bounds.mesh->bounds = combine(bounds.mesh->bounds, bounds.joint_bounds[joint].transformed(matrices[bounds.skin->joints[joint]]));
+                }
             }
         }
-        else
+    };
+
+    add_pose();
+    for (const Animation &animation : animations)
+    {
+        float length    = std::max(animation.end - animation.start, 0.0f);
+        int samples     = static_cast<int>(std::ceil(length * ANIMATION_BOUNDS_RATE));
+        for (int i = 0; i <= samples; ++i)
         {
-            // cout << "lol\n";
+            pose = initial_pose;
+            sample_animation(animation, animation.start + ((samples > 0) ? length * i / samples : 0.0f), pose);
+            add_pose();
         }
     }
-    
-    for (auto &child : node->children)
+}
+
+uint32_t ModelData::get_skin_offset(int32_t skin) const
+{
+    if (skin < 0)
+    {
+        return 0;   // the identity.
+    }
+
+    uint32_t offset = 1;
+    for (int32_t i = 0; i < skin; ++i)
     {
-        update_joints(child);
+        offset += static_cast<uint32_t>(std::min(skins[i].joints.size(), static_cast<size_t>(MAX_JOINTS)));
     }
+    return offset;
 }
 
-// load a model from a .gltf file (works with both combined and seperate, but not .glb).
-Model::Model(std::string filename)
+uint32_t ModelData::get_palette_size() const
 {
-    tinygltf::Model glTF_input;         // stores .gltf model reference.
-    tinygltf::TinyGLTF glTF_context;    // stores ASCII from file.
-    std::string error;                  // outputs warning if fails to load properly.
-    std::string warning;                // outputs error if any errors.
+    return get_skin_offset(static_cast<int32_t>(skins.size()));
+}
 
-    bool loaded = glTF_context.LoadASCIIFromFile(&glTF_input, &error, &warning, MODELS_PATH + filename);
-    if (!error.empty())     { cout << "ERR: " << error << "\n"; }
-    if (!warning.empty())   { cout << "WARN: " << warning << "\n"; }
+void ModelData::load_gltf(tinygltf::Model &input)
+{
+    // load images, materials, textures.
+    load_material(input);
 
-    std::vector<uint32_t> index_buffer;
-    std::vector<Vertex> vertex_buffer;
+    //glTF_input.defaultScene = glTF_input.scenes[0] (pretty sure).
+    
+    const tinygltf::Scene &scene = input.scenes[0];
+    for (size_t i = 0; i < scene.nodes.size(); ++i)
+    {
+        const tinygltf::Node node = input.nodes[scene.nodes[i]];
+        load_node(node, input, -1, scene.nodes[i], glm::mat4(1.0f));
+    }
 
-    // if loaded correctly, load file contents.
-    if (loaded)
+    // load skins and animations.
+    load_skins(input);
+    load_animations(input);
+    if (compress)
     {
-        cout << "model: " << filename << "\n";
+        compress_animations();
+    }
+    finish_load();
+}
 
-        // load images, materials, textures.
-        load_material(glTF_input);
+// same result as load_gltf, but everything was worked out when it was baked:
+// the vertices, indices and pixels are uploaded straight from the mapped file, the nodes are already in order.
+bool ModelData::load_baked(const std::string &filename)
+{
+    baked = open_baked(MODELS_PATH + filename);
+    if (!baked)
+    {
+        return false;
+    }
+    baked->file.prefetch();
+    cout << "model: " << filename << " (baked)\n";
 
-        //glTF_input.defaultScene = glTF_input.scenes[0] (pretty sure).
-        
-        const tinygltf::Scene &scene = glTF_input.scenes[0];
-        for (size_t i = 0; i < scene.nodes.size(); ++i)
+    for (const BakedTexture &texture : baked->get<BakedTexture>(BAKE_TEXTURES))
+    {
+        PendingTexture pending;
+        pending.width           = texture.width;
+        pending.height          = texture.height;
+        pending.component       = texture.component;
+        pending.bits            = texture.bits;
+        pending.baked_pixels    = texture.pixels;
+        pending_textures.push_back(std::move(pending));
+        materials.push_back(Material());
+    }
+
+    // baked in the same order as ModelData::nodes, parents first.
+    std::span<const BakedNode> baked_nodes                  = baked->get<BakedNode>(BAKE_NODES);
+    std::span<const BakedPrimitive> baked_primitives        = baked->get<BakedPrimitive>(BAKE_PRIMITIVES);
+    nodes.resize(baked_nodes.size());
+    for (size_t i = 0; i < baked_nodes.size(); ++i)
+    {
+        const BakedNode &baked_node = baked_nodes[i];
+        Node &node          = nodes[i];
+        node.parent         = baked_node.parent;
+        node.index          = baked_node.index;
+        node.skin           = baked_node.skin;
+        node.translation    = baked_node.translation;
+        node.rotation       = baked_node.rotation;
+        node.scale          = baked_node.scale;
+        node.matrix         = baked_node.matrix;
+
+        for (uint32_t j = 0; j < baked_node.primitives.count; ++j)
         {
-            const tinygltf::Node node = glTF_input.nodes[scene.nodes[i]];
-            load_node(node, glTF_input, nullptr, scene.nodes[i], index_buffer, vertex_buffer);
+            uint32_t primitive_index        = baked_node.primitives.first + j;
+            const BakedPrimitive &primitive = baked_primitives[primitive_index];
+
+            MeshPrimitive mesh{};
+            mesh.first_index    = primitive.indices.first;
+            mesh.index_count    = primitive.indices.count;
+            mesh.first_vertex   = primitive.vertices.first;
+            mesh.vertex_count   = primitive.vertices.count;
+            mesh.material_index = primitive.material_index;
+            mesh.baked_index    = static_cast<int32_t>(primitive_index);
+            mesh.type           = static_cast<MeshPrimitive::Type>(primitive.type);
+            mesh.target_level   = primitive.target_level;
+            mesh.spawn          = primitive.spawn;
+            node.mesh_primitives.push_back(mesh);
         }
+    }
 
-        // load skins and animations.
-        load_skins(glTF_input);
-        load_animations(glTF_input);
+    std::span<const uint32_t> joints = baked->get<uint32_t>(BAKE_JOINTS);
+    for (const BakedSkin &baked_skin : baked->get<BakedSkin>(BAKE_SKINS))
+    {
+        Skin skin;
+        skin.name           = baked_skin.name;
+        skin.skeleton_root  = baked_skin.skeleton_root;
+        std::span<const uint32_t> skin_joints = joints.subspan(baked_skin.joints.first, baked_skin.joints.count);
+        skin.joints.assign(skin_joints.begin(), skin_joints.end());
+        std::span<const glm::mat4> inverse_binds = baked->get<glm::mat4>(BAKE_INVERSE_BINDS, baked_skin.inverse_binds);
+        skin.inverse_bind_matrices.assign(inverse_binds.begin(), inverse_binds.end());
+        skins.push_back(skin);
+    }
 
-        // calculate initial pose.
-        // verify this is working correctly!
-        for (auto node : nodes)
-		{
-			update_joints(node);
-		}
+    std::span<const BakedSampler> baked_samplers = baked->get<BakedSampler>(BAKE_SAMPLERS);
+    std::span<const BakedChannel> baked_channels = baked->get<BakedChannel>(BAKE_CHANNELS);
+    animations.resize(baked->get<BakedAnimation>(BAKE_ANIMATIONS).size());
+    for (size_t i = 0; i < animations.size(); ++i)
+    {
+        const BakedAnimation &baked_animation = baked->get<BakedAnimation>(BAKE_ANIMATIONS)[i];
+        Animation &animation    = animations[i];
+        animation.name          = baked_animation.name;
+        animation.start         = baked_animation.start;
+        animation.end           = baked_animation.end;
 
-        // after loading everything, bind the mesh nodes.
-        for (auto &node : nodes)
+        for (const BakedSampler &baked_sampler : baked_samplers.subspan(baked_animation.samplers.first, baked_animation.samplers.count))
+        {
+            std::span<const float> times            = baked->get<float>(BAKE_KEY_TIMES, baked_sampler.times);
+            std::span<const glm::vec4> values       = baked->get<glm::vec4>(BAKE_KEY_VALUES, baked_sampler.values);
+            std::span<const uint16_t> encoded_times = baked->get<uint16_t>(BAKE_ENCODED_TIMES, baked_sampler.encoded_times);
+            std::span<const uint16_t> encoded_values = baked->get<uint16_t>(BAKE_ENCODED_VALUES, baked_sampler.encoded_values);
+
+            AnimationSampler sampler;
+            sampler.interpolation   = AnimationSampler::from_name(baked_sampler.interpolation);
+            sampler.encoding        = static_cast<AnimationSampler::Encoding>(baked_sampler.encoding);
+            sampler.start           = baked_sampler.start;
+            sampler.end             = baked_sampler.end;
+            sampler.range_min       = baked_sampler.range_min;
+            sampler.range_size      = baked_sampler.range_size;
+            sampler.inputs.assign(times.begin(), times.end());
+            sampler.outputs_vec4.assign(values.begin(), values.end());
+            sampler.times.assign(encoded_times.begin(), encoded_times.end());
+            sampler.values.assign(encoded_values.begin(), encoded_values.end());
+            animation.samplers.push_back(sampler);
+        }
+        for (const BakedChannel &baked_channel : baked_channels.subspan(baked_animation.channels.first, baked_animation.channels.count))
         {
-            bind_node(&*node);
+            AnimationChannel channel;
+            channel.path            = AnimationChannel::from_name(baked_channel.path);
+            channel.node            = baked_channel.node;
+            channel.sampler_index   = baked_channel.sampler;
+            animation.channels.push_back(channel);
         }
     }
-    cout << "\n";
+
+    finish_load();
+    return true;
+}
+
+std::span<const Vertex> ModelData::get_vertices(const MeshPrimitive &mesh) const
+{
+    std::span<const Vertex> all = baked ? baked->get<Vertex>(BAKE_VERTICES) : std::span<const Vertex>(vertex_buffer);
+    return all.subspan(mesh.first_vertex, mesh.vertex_count);
+}
+
+std::span<const uint32_t> ModelData::get_indices(const MeshPrimitive &mesh) const
+{
+    std::span<const uint32_t> all = baked ? baked->get<uint32_t>(BAKE_INDICES) : std::span<const uint32_t>(index_buffer);
+    return all.subspan(mesh.first_index, mesh.index_count);
+}
+
+std::span<const glm::vec3> ModelData::get_collider_vertices(const MeshPrimitive &mesh) const
+{
+    std::span<const glm::vec3> all = baked ? baked->get<glm::vec3>(BAKE_COLLIDER_VERTICES) : std::span<const glm::vec3>(collider_buffer);
+    return all.subspan(mesh.first_vertex, mesh.vertex_count);
 }
 
 
@@ -996,12 +1991,6 @@ Frustum::Frustum(std::vector<glm::vec4> corners)
         3, 7, 3, 3, 7, 6
     };
 
-    // fill joint matrix with placeholder values.
-    for (size_t i = 0; i < MAX_JOINTS; ++i)
-    {
-        joint_matrix[i] = glm::mat4(1.0f);
-    }
-
     bind_buffers(mesh.VAO, mesh.VBO, mesh.EBO, mesh.vertex_buffer, mesh.index_buffer);
 }
 
@@ -1013,20 +2002,20 @@ void Frustum::draw(glm::vec3 position, Shader shader)
     glm::mat4 mvp       = translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
 
     // draw mesh with GL_LINES.
-    glUseProgram(shader.ID);    // activate the shader being used to draw this model. (potential for multiple shaders per model?)
+    shader.use();    // activate the shader being used to draw this model. (potential for multiple shaders per model?)
     
     // per mesh shader updates; colour and combined matrix transformation.
     // glUniform3fv(glGetUniformLocation(shader.ID, "albedo"), 1, glm::value_ptr(colour));
     // glUniformMatrix4fv(glGetUniformLocation(shader.ID, "view"), 1, GL_FALSE, glm::value_ptr(camera.mvp));
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "joint_matrices"), MAX_JOINTS, GL_FALSE, glm::value_ptr(joint_matrix[0]));
+    set_joint_uniforms(shader, 0);  // the identity at the start of the palette.
     
     glBindVertexArray(mesh.VAO);     // bind the VBO with the vertexes from the mesh.
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "mvp"), 1, GL_FALSE, glm::value_ptr(mvp));
+    shader.set(UNIFORM_MVP, mvp);
 
     // set polygon mode and then draw elements.
     glPolygonMode(GL_FRONT_AND_BACK, shader.mode);
     glLineWidth(1.0f);
-    glDrawElements(GL_LINES, mesh.index_buffer.size() * sizeof(mesh.index_buffer[0]), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_LINES, static_cast<GLsizei>(mesh.index_buffer.size()), GL_UNSIGNED_INT, 0);
 
     // unbind vertex array and texture.
     glBindTexture(GL_TEXTURE_2D, 0);
@@ -1042,7 +2031,7 @@ Line::Line(glm::vec3 angle, float length)
     vertex_a.normal           = vertex_a.position;
     vertex_a.color            = glm::vec3(0.0f);
     vertex_a.texUV            = glm::vec2(0.0f, 0.0f);
-    vertex_a.joint_indices    = glm::vec4(1.0f);
+    vertex_a.joint_indices    = glm::vec4(0.0f);
     vertex_a.joint_weights    = glm::vec4(1.0f);
 
     mesh.vertex_buffer.push_back(vertex_a);
@@ -1052,18 +2041,12 @@ Line::Line(glm::vec3 angle, float length)
     vertex_b.normal           = vertex_b.position;
     vertex_b.color            = glm::vec3(0.0f);
     vertex_b.texUV            = glm::vec2(0.0f, 0.0f);
-    vertex_b.joint_indices    = glm::vec4(1.0f);
+    vertex_b.joint_indices    = glm::vec4(0.0f);
     vertex_b.joint_weights    = glm::vec4(1.0f);
 
     mesh.vertex_buffer.push_back(vertex_b);
     mesh.index_buffer.push_back(1);
 
-    // fill joint matrix with placeholder values.
-    for (size_t i = 0; i < MAX_JOINTS; ++i)
-    {
-        joint_matrix[i] = glm::mat4(1.0f);
-    }
-
     bind_buffers(mesh.VAO, mesh.VBO, mesh.EBO, mesh.vertex_buffer, mesh.index_buffer);
 }
 
@@ -1074,20 +2057,20 @@ void Line::draw(glm::vec3 position, glm::quat rotation, Shader shader, glm::vec3
     glm::mat4 mvp       = translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
 
     // draw mesh with GL_LINES.
-    glUseProgram(shader.ID);    // activate the shader being used to draw this model. (potential for multiple shaders per model?)
+    shader.use();    // activate the shader being used to draw this model. (potential for multiple shaders per model?)
     
     // per mesh shader updates; colour and combined matrix transformation.
-    glUniform3fv(glGetUniformLocation(shader.ID, "albedo"), 1, glm::value_ptr(colour));   
+    shader.set(UNIFORM_ALBEDO, colour);   
     // glUniformMatrix4fv(glGetUniformLocation(shader.ID, "view"), 1, GL_FALSE, glm::value_ptr(camera.mvp));
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "joint_matrices"), MAX_JOINTS, GL_FALSE, glm::value_ptr(joint_matrix[0]));
+    set_joint_uniforms(shader, 0);  // the identity at the start of the palette.
     
     glBindVertexArray(mesh.VAO);     // bind the VBO with the vertexes from the mesh.
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "mvp"), 1, GL_FALSE, glm::value_ptr(mvp));
+    shader.set(UNIFORM_MVP, mvp);
 
     // set polygon mode and then draw elements.
     glPolygonMode(GL_FRONT_AND_BACK, shader.mode);
     glLineWidth(1.0f);
-    glDrawElements(GL_LINE_LOOP, mesh.index_buffer.size() * sizeof(mesh.index_buffer[0]), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_LINE_LOOP, static_cast<GLsizei>(mesh.index_buffer.size()), GL_UNSIGNED_INT, 0);
 
     // unbind vertex array and texture.
     glBindTexture(GL_TEXTURE_2D, 0);
@@ -1105,19 +2088,13 @@ Circle::Circle(float radius)
         vertex.normal           = vertex.position;
         vertex.color            = glm::vec3(0.0f);
         vertex.texUV            = glm::vec2(0.0f, 0.0f);
-        vertex.joint_indices    = glm::vec4(1.0f);
+        vertex.joint_indices    = glm::vec4(0.0f);
         vertex.joint_weights    = glm::vec4(1.0f);
 
         mesh.vertex_buffer.push_back(vertex);
         mesh.index_buffer.push_back(i);
     }
 
-    // fill joint matrix with placeholder values.
-    for (size_t i = 0; i < MAX_JOINTS; ++i)
-    {
-        joint_matrix[i] = glm::mat4(1.0f);
-    }
-
     bind_buffers(mesh.VAO, mesh.VBO, mesh.EBO, mesh.vertex_buffer, mesh.index_buffer);
 }
 
@@ -1129,20 +2106,20 @@ void Circle::draw(glm::vec3 position, Shader shader, Camera camera, glm::vec3 co
     glm::mat4 mvp       = translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
 
     // draw mesh with GL_LINES.
-    glUseProgram(shader.ID);    // activate the shader being used to draw this model. (potential for multiple shaders per model?)
+    shader.use();    // activate the shader being used to draw this model. (potential for multiple shaders per model?)
     
     // per mesh shader updates; colour and combined matrix transformation.
-    glUniform3fv(glGetUniformLocation(shader.ID, "albedo"), 1, glm::value_ptr(colour));   
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "view"), 1, GL_FALSE, glm::value_ptr(camera.mvp));
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "joint_matrices"), MAX_JOINTS, GL_FALSE, glm::value_ptr(joint_matrix[0]));
+    shader.set(UNIFORM_ALBEDO, colour);   
+    shader.set(UNIFORM_VIEW, camera.mvp);
+    set_joint_uniforms(shader, 0);  // the identity at the start of the palette.
     
     glBindVertexArray(mesh.VAO);     // bind the VBO with the vertexes from the mesh.
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "mvp"), 1, GL_FALSE, glm::value_ptr(mvp));
+    shader.set(UNIFORM_MVP, mvp);
 
     // set polygon mode and then draw elements.
     glPolygonMode(GL_FRONT_AND_BACK, shader.mode);
     glLineWidth(1.0f);
-    glDrawElements(GL_LINE_LOOP, mesh.index_buffer.size() * sizeof(mesh.index_buffer[0]), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_LINE_LOOP, static_cast<GLsizei>(mesh.index_buffer.size()), GL_UNSIGNED_INT, 0);
 
     // unbind vertex array and texture.
     glBindTexture(GL_TEXTURE_2D, 0);
@@ -1243,13 +2220,13 @@ void ScreenTexture::draw(Shader &screen_shader, Shader &blur_shader)
         bool first_iteration    = true;
         unsigned int amount     = 10;
 
-        glUseProgram(blur_shader.ID);
+        blur_shader.use();
         glBindVertexArray(VAO);
 
         for (unsigned int i = 0; i < amount; ++i)
         {
             glBindFramebuffer(GL_FRAMEBUFFER, pingpong_FBO[horizontal]);
-            glUniform1i(glGetUniformLocation(blur_shader.ID, "horizontal"), horizontal);
+            blur_shader.set(UNIFORM_HORIZONTAL, static_cast<int>(horizontal));
             glBindTexture(GL_TEXTURE_2D, first_iteration ? color_buffers[1] : pingpong_buffers[!horizontal]);  // bind texture of other framebuffer (or scene if first iteration)
 
             // draw pingpong buffer.
@@ -1271,7 +2248,7 @@ void ScreenTexture::draw(Shader &screen_shader, Shader &blur_shader)
     glClear(GL_COLOR_BUFFER_BIT);
     
     // apply shader and bind texture.
-    glUseProgram(screen_shader.ID);
+    screen_shader.use();
     glBindVertexArray(VAO);
 
     glActiveTexture(GL_TEXTURE0);
@@ -1281,9 +2258,9 @@ void ScreenTexture::draw(Shader &screen_shader, Shader &blur_shader)
     glBindTexture(GL_TEXTURE_2D, pingpong_buffers[!horizontal]);
 
     // send gamma to post process shader.
-    glUniform1i(glGetUniformLocation(screen_shader.ID, "screen_texture"), 0);
-    glUniform1i(glGetUniformLocation(screen_shader.ID, "bloom"), 1);
-    glUniform1f(glGetUniformLocation(screen_shader.ID, "gamma"), gamma);
+    screen_shader.set(UNIFORM_SCREEN_TEXTURE, 0);
+    screen_shader.set(UNIFORM_BLOOM, 1);
+    screen_shader.set(UNIFORM_GAMMA, gamma);
 
     // draw the framebuffer.
     glPolygonMode(GL_FRONT_AND_BACK, screen_shader.mode);
@@ -1298,6 +2275,13 @@ void ScreenTexture::draw(Shader &screen_shader, Shader &blur_shader)
 
 
 Skybox::Skybox(int level_index)
+{
+    load(level_index);
+    size_t budget = SIZE_MAX;
+    upload(budget);
+}
+
+bool Skybox::load(int level_index)
 {
 //     float vertices[] = {
 //     // positions          
@@ -1357,21 +2341,30 @@ Skybox::Skybox(int level_index)
 //     link_attrib(VBO, 0, 3, GL_FLOAT, 3 * sizeof(float), (void*)(0)); // positions (vec3).
 
     std::string current_skybox = TEXTURES_PATH + std::string("skybox_" + std::to_string(level_index) + "/");
+    cube_mesh.load("cube.gltf");
+    uploaded_faces = 0;
 
-    glActiveTexture(GL_TEXTURE0);
-    glGenTextures(1, &ID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
-
-    // set params for cubemap texture.
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    // baked faces are already decoded, so they upload straight from the mapped file.
+    baked = open_baked(current_skybox);
+    if (baked && (baked->get<BakedTexture>(BAKE_TEXTURES).size() == filenames.size()))
+    {
+        baked->file.prefetch();
+        for (size_t i = 0; i < filenames.size(); ++i)
+        {
+            const BakedTexture &face    = baked->get<BakedTexture>(BAKE_TEXTURES)[i];
+            faces[i].width              = face.width;
+            faces[i].height             = face.height;
+            faces[i].baked_pixels       = face.pixels;
+        }
+        cout << "Loaded cubemap: skybox_" << level_index << " (baked)\n";
+        return true;
+    }
+    baked.reset();
 
     int width;
     int height;
     int component;
+    bool loaded = true;
 
     for (size_t i = 0; i < filenames.size(); ++i)
     {
@@ -1380,40 +2373,96 @@ Skybox::Skybox(int level_index)
         {
             data = stbi_load((current_skybox + filenames[i] + std::string(".png")).data(), &width, &height, &component, STBI_rgb_alpha);
         }
-        
-
-
 
         if(!data)
         {
             // throw(std::string("Failed to load texture"));
             cout << "Failed to load cubemap texture: " << filenames[i] << "\n";
-            stbi_image_free(data);
+            loaded = false;
+            continue;
         }
 
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        // always rgba, that's what stb was asked for.
+        faces[i].width  = width;
+        faces[i].height = height;
+        faces[i].pixels.assign(data, data + static_cast<size_t>(width) * height * 4);
         stbi_image_free(data);
         
         cout << "Loaded cubemap texture: " << filenames[i] << "\n";
     }
+    return loaded;
+}
+
+// the cube first, then a face at a time.
+bool Skybox::upload(size_t &budget)
+{
+    if (!cube_mesh.upload(budget))
+    {
+        return false;
+    }
+
+    while ((uploaded_faces < faces.size()) && (budget > 0))
+    {
+        if (uploaded_faces == 0)
+        {
+            glActiveTexture(GL_TEXTURE0);
+            glGenTextures(1, &ID);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
+
+            // set params for cubemap texture.
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        }
+
+        PendingTexture &face    = faces[uploaded_faces];
+        const uint8_t *pixels   = face.pixels.data();
+        if (face.pixels.empty() && baked)
+        {
+            pixels = baked->get<uint8_t>(BAKE_PIXELS, face.baked_pixels).data();
+        }
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + uploaded_faces, 0, GL_RGBA, face.width, face.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        budget -= std::min(budget, face.get_size());
+        face.pixels = std::vector<uint8_t>();   // gl has its own copy now.
+        uploaded_faces++;
+    }
+    return uploaded_faces == faces.size();
+}
 
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+void Skybox::release()
+{
+    if (ID)
+    {
+        glDeleteTextures(1, &ID);
+        ID = 0;
+    }
+    cube_mesh.release();
+    baked.reset();
 }
 
-void Skybox::draw(glm::vec3 position, Shader shader, Camera camera)
+void Skybox::draw(RenderQueue &queue, glm::vec3 position, Shader shader, Camera camera)
 {
     glm::mat4 transform = translate(glm::mat4(1.0f), camera.get_position(position))* glm::mat4_cast(glm::quat(glm::vec3(0.0f)))* glm::scale(glm::mat4(1.0f), glm::vec3(camera.FAR_PLANE));
 
-    glUseProgram(shader.ID);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
-    glCullFace(GL_FRONT);
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "view"), 1, GL_FALSE, glm::value_ptr(camera.mvp));
-
     // loop through all nodes in the model.
-    for (auto &node : cube_mesh.nodes)
+    size_t first = queue.items.size();
+    for (uint32_t i = 0; i < cube_mesh.data->nodes.size(); ++i)
+    {
+        cube_mesh.draw_node(queue, i, transform, shader, glm::vec3(1.0f), RENDER_LAYER_SKYBOX);
+    }
+
+    // the cube is seen from the inside, and textured with the cube map rather than its material.
+    for (size_t i = first; i < queue.items.size(); ++i)
     {
-        cube_mesh.draw_node(*node, GL_TRIANGLES, transform, shader);
+        queue.items[i].texture          = ID;
+        queue.items[i].texture_target   = GL_TEXTURE_CUBE_MAP;
+        queue.items[i].cull_face        = GL_FRONT;
     }
     
     // would be nice to get this to work so don't need to literally load a gltf cube.
@@ -1429,74 +2478,23 @@ void Skybox::draw(glm::vec3 position, Shader shader, Camera camera)
 
 
     // glDepthFunc(GL_LESS);
-    glCullFace(GL_BACK);
-}
-
-
-
-// drawing image to UI etc.
-Image2D::Image2D(std::string filename)
-{
-    unsigned char *data = stbi_load((TEXTURES_PATH + filename).data(), &width, &height, &component, STBI_rgb_alpha);
-    if(!data)
-    {
-        throw(std::string("Failed to load texture"));
-    }
-
-    float vertices[] = {
-        // position.    // texCoord.
-        // tri 1.
-        -1.0f,  1.0f,   0.0f, 0.0f,
-        -1.0f, -1.0f,   0.0f, 1.0f,
-         1.0f, -1.0f,   1.0f, 1.0f,
-
-        // tri 2.
-        -1.0f,  1.0f,   0.0f, 0.0f,
-         1.0f, -1.0f,   1.0f, 1.0f,
-         1.0f,  1.0f,   1.0f, 0.0f
-    };
-
-    // generate VAO.
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    // generate VBO, bind, then pass vertices vector.
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW);
-
-    // link attribs.
-    link_attrib(VBO, 0, 2, GL_FLOAT, 4 * sizeof(float), (void*)(0));                    // positions (vec2).
-    link_attrib(VBO, 1, 2, GL_FLOAT, 4 * sizeof(float), (void*)(2 * sizeof(float)));    // texcoords (vec2).
-    
-    // generate texture with parameters.
-    glGenTextures(1, &ID);
-    glBindTexture(GL_TEXTURE_2D, ID);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    // unbind texture.
-    glBindTexture(GL_TEXTURE_2D, 0);
-    stbi_image_free(data);
 }
 
 void Image2D::draw(float x, float y, float scale)
 {
-    glUseProgram(shader.ID);
+    shader.use();
     glBindVertexArray(VAO);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, ID);
 
     // send all parameters to shader uniforms.
-    glUniform1f(glGetUniformLocation(shader.ID, "x_pos"), x);
-    glUniform1f(glGetUniformLocation(shader.ID, "y_pos"), y);
-    glUniform1f(glGetUniformLocation(shader.ID, "scale"), scale);
-    glUniform1f(glGetUniformLocation(shader.ID, "window_width"), (float)WINDOW_WIDTH);
-    glUniform1f(glGetUniformLocation(shader.ID, "window_height"), (float)WINDOW_HEIGHT);
-    glUniform1f(glGetUniformLocation(shader.ID, "img_width"), width);
-    glUniform1f(glGetUniformLocation(shader.ID, "img_height"), height);
+    shader.set(UNIFORM_X_POS, x);
+    shader.set(UNIFORM_Y_POS, y);
+    shader.set(UNIFORM_SCALE, scale);
+    shader.set(UNIFORM_WINDOW_WIDTH, (float)WINDOW_WIDTH);
+    shader.set(UNIFORM_WINDOW_HEIGHT, (float)WINDOW_HEIGHT);
+    shader.set(UNIFORM_IMG_WIDTH, (float)width);
+    shader.set(UNIFORM_IMG_HEIGHT, (float)height);
     
     // enable alpha blending for transparency.
     glEnable(GL_BLEND);
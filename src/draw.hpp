@@ -4,14 +4,28 @@
 #include <string>       // for model filename.
 #include <vector>       // for vertices, indices, and textures arrays.
 #include <array>
+#include <span>
+#include <memory>       // shared bake mapping and model data.
+#include <mutex>        // std::once_flag.
 #include <json.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
 #include "shader.hpp"   // for updating shader uniforms per mesh.
 #include "camera.hpp"
+#include "asset.hpp"    // baked models.
 
 #define MAX_JOINTS 100
+#define ANIMATION_BOUNDS_RATE       30.0f   // samples a second skinned mesh bounds are taken at, over every animation.
+#define ANIMATION_TOLERANCE         0.0005f // error keyframe reduction can add: model units for translation and scale, quaternion components for rotation.
+#define INSTANCE_MODEL_LOCATION     6   // per instance attributes, see cel_instanced.vert. a mat4 takes four locations.
+#define INSTANCE_ALBEDO_LOCATION    10
+#define INSTANCE_JOINTS_LOCATION    11
+#define JOINT_PALETTE_UNIT          4   // texture unit the joint palette is bound to, after tex0 and the shadow maps.
+
+// render queue layers, drawn in this order.
+#define RENDER_LAYER_OPAQUE         0
+#define RENDER_LAYER_SKYBOX         1   // after everything else, so the sky only fills what's left.
 
 // referenced: https://github.com/SaschaWillems/Vulkan/blob/master/examples/gltfskinning/gltfskinning.cpp
 // store vertex information from gltf file.
@@ -29,7 +43,7 @@ struct Vertex
 struct Material
 {
     glm::vec4 base_colour = glm::vec4(1.0f);    // material colour, defaults to white.
-    uint32_t texture_ID;                        // id of the materials texture.
+    uint32_t texture_ID = 0;                    // id of the materials texture, 0 until it's uploaded.
 };
 
 struct MeshPrimitive
@@ -45,21 +59,25 @@ struct MeshPrimitive
 
 
 
-    GLuint VAO; // vertex array object.
-    GLuint VBO; // vertex buffer object array.
-    GLuint EBO; // element buffer object.
+    GLuint VAO = 0; // vertex array object.
+    GLuint VBO = 0; // vertex buffer object array.
+    GLuint EBO = 0; // element buffer object.
 
     uint32_t first_index;
     uint32_t index_count;   // number of indices in the mesh.
+    uint32_t first_vertex;  // where the mesh starts in the model's buffers.
+    uint32_t vertex_count;
     int32_t material_index; // index of the mesh's material in the model's materials array.
+    int32_t baked_index = -1;   // entry in the model's baked primitives, -1 if it wasn't loaded from a bake.
+    AABB bounds;                // of its vertices in the node's space. a skinned mesh's are in the model's space, covering every animation.
 
+    // procedural meshes (circle, line, frustum) only, model meshes live in the model's buffers.
     std::vector<uint32_t> index_buffer;             // stores the list of indices.
     std::vector<Vertex> vertex_buffer;              // stores the raw vertices.
 
 
     // collision info.
     Type type;
-    std::vector<glm::vec3> vertex_collider_buffer;  // vertices with node matrix applied, used for collision meshes.
 
     int target_level = 0;
     glm::vec3 spawn = glm::vec3(0.0f);              // spawn point for level changes.
@@ -79,7 +97,6 @@ struct MeshPrimitive
 struct Circle
 {
     MeshPrimitive mesh;
-    std::array<glm::mat4, MAX_JOINTS> joint_matrix;
 
     Circle(float radius);
     void draw(glm::vec3 position, Shader shader, Camera camera, glm::vec3 colour);
@@ -88,7 +105,6 @@ struct Circle
 struct Line
 {
     MeshPrimitive mesh;
-    std::array<glm::mat4, MAX_JOINTS> joint_matrix;
 
     Line(glm::vec3 angle, float length);
     void draw(glm::vec3 position, glm::quat rotation, Shader shader, glm::vec3 colour);
@@ -97,7 +113,6 @@ struct Line
 struct Frustum
 {
     MeshPrimitive mesh;
-    std::array<glm::mat4, MAX_JOINTS> joint_matrix;
 
     Frustum(std::vector<glm::vec4> corners);
     void draw(glm::vec3 position, Shader shader);
@@ -115,47 +130,107 @@ struct Frustum
 // };
 
 // decribes a single node in the gltf file.
-struct Node; // so nodes can have parent nodes.
+// nodes are shared by every instance of a model, so the transform here is the pose it was loaded in.
+// each Model keeps its own copy (Model::transforms) to animate.
+// a model's nodes are in one array (ModelData::nodes) with parents before their children, so walking it in
+// order visits the tree depth first and a parent's world matrix is always ready before its children need it.
 struct Node
 {
-    Node *                      parent;
-    uint32_t                    index;
+    int32_t                     parent = -1;    // in ModelData::nodes, -1 for a root.
+    uint32_t                    index;          // in the gltf file.
     int32_t                     skin = -1;
-    std::vector<Node *>         children;
     std::vector<MeshPrimitive>  mesh_primitives;
 
     glm::vec3                   translation{};
     glm::quat                   rotation{};
     glm::vec3                   scale = glm::vec3(1.0f);
     glm::mat4                   matrix;
-    glm::mat4                   get_local_matrix();    
+    glm::mat4                   get_local_matrix() const;
+};
+
+// a node's local transform in one instance of a model.
+struct NodeTransform
+{
+    glm::vec3   translation;
+    glm::quat   rotation;
+    glm::vec3   scale;
+
+    glm::mat4 get_matrix(const glm::mat4 &node_matrix) const;  // with the node's own matrix applied after.
 };
 
+// Model::dirty flags, what needs recomputing for a node in the next Model::update_world_matrices.
+#define NODE_DIRTY_LOCAL    1   // its transform changed.
+#define NODE_DIRTY_WORLD    2   // it or a parent moved.
+
 // each armature is a collection of nodes.
 struct Skin
 {
     std::string                         name;
-    Node *                              skeleton_root = nullptr;
+    int32_t                             skeleton_root = -1;
     std::vector<glm::mat4>              inverse_bind_matrices;
-    std::vector<Node *>                 joints;
-    std::array<glm::mat4, MAX_JOINTS>   joint_matrix = {glm::mat4(1.0f)};
+    std::vector<uint32_t>               joints;     // in ModelData::nodes.
 };
 
 
 // animation related.
 struct AnimationSampler
 {
-    std::string             interpolation;
-    std::vector<float>      inputs;
+    // resolved from the gltf names when loaded, bakes keep the names.
+    enum Interpolation
+    {
+        LINEAR,
+        STEP,
+        CUBICSPLINE     // outputs has an in tangent, the value and an out tangent for every key.
+    };
+
+    // how the keys are kept. a gltf's samplers are loaded RAW, then ModelData::compress_animations swaps
+    // the floats for 16 bit times and three 16 bit values per key, which the sampler decodes as it goes.
+    // bakes are compressed when they're baked and load as they were stored.
+    enum Encoding
+    {
+        RAW,
+        RANGE,          // each component quantised between the sampler's smallest and largest (translation, scale).
+        SMALLEST_THREE  // a rotation's three smallest components, the largest is rebuilt as it's a unit quaternion.
+    };
+
+    Interpolation           interpolation = LINEAR;
+    Encoding                encoding = RAW;
+    std::vector<float>      inputs;         // RAW only.
     std::vector<float>      outputs_float;
-    std::vector<glm::vec4>  outputs_vec4;
+    std::vector<glm::vec4>  outputs_vec4;   // RAW only.
+
+    std::vector<uint16_t>   times;          // compressed only, quantised between start and end.
+    std::vector<uint16_t>   values;         // compressed only, three per key.
+    float                   start = 0.0f;
+    float                   end = 0.0f;
+    glm::vec3               range_min{};    // RANGE only.
+    glm::vec3               range_size{};
+
+    size_t get_key_count() const { return (encoding == RAW) ? inputs.size() : times.size(); }
+    float get_time(size_t key) const;
+    glm::vec4 get_value(size_t output) const;  // as it would be in outputs_vec4, so a cubic spline has three per key.
+    size_t get_size() const;                    // bytes the keys take.
+
+    static Interpolation from_name(const std::string &name);    // LINEAR if it isn't one, as gltf defaults to.
+    static const char *get_name(Interpolation interpolation);
 };
 
 struct AnimationChannel
 {
-    std::string path;
-    Node *      node;
+    enum Path
+    {
+        TRANSLATION,
+        ROTATION,
+        SCALE,
+        WEIGHTS         // morph targets aren't loaded, so these (and any path that isn't gltf's) are skipped.
+    };
+
+    Path        path = TRANSLATION;
+    int32_t     node = -1;  // in ModelData::nodes.
     uint32_t    sampler_index;
+
+    static Path from_name(const std::string &name);
+    static const char *get_name(Path path);
 };
 
 struct Animation
@@ -165,36 +240,200 @@ struct Animation
     std::vector<AnimationChannel>   channels;
     float start                     = std::numeric_limits<float>::max();
     float end                       = std::numeric_limits<float>::min();
-    float current_time              = 0.0f;
     bool loop                       = true;
-    void reset();
 };
 
 
-// model class which contains a number of meshes which are drawn individually.
-// could make this like the colliders and have inheritence so can have mesh, circle, frustum etc.
-struct Model
+// a decoded texture that hasn't been given to gl yet.
+struct PendingTexture
 {
-    std::vector<Node *>     nodes;      // a node has a mesh and inheritence hierarchy.
+    int width       = 0;
+    int height      = 0;
+    int component   = 4;
+    int bits        = 8;
+    std::vector<uint8_t> pixels;    // decoded from the source, empty if the pixels are in a bake.
+    BakedRange baked_pixels;        // where they are in the bake otherwise.
+
+    size_t get_size() const { return static_cast<size_t>(width) * height * component * (bits / 8); }
+};
+
+// everything about a model that's the same for every instance of it: the node tree, meshes and their gl buffers,
+// textures, skins and animations. loaded once per file by acquire_model (see resource.hpp) and left alone once
+// it's uploaded, anything that changes per instance is in Model.
+struct ModelData
+{
+    std::vector<Node>       nodes;      // parents before children, see Node.
     std::vector<Material>   materials;  // materials (colour, texture, can add more stuff like normals).
     std::vector<Skin>       skins;      // armature per mesh? i think that's how it works.
     std::vector<Animation>  animations; // each animation accessed by the index.
+    bool loaded             = false;
+
+    std::vector<NodeTransform> initial_pose;    // by node. the loaded pose with every animation's first frame applied.
+    uint32_t initial_animation = 0;
+    bool compress = true;                       // compress_animations when loaded from a gltf. bakes store the compressed keys.
+    float animation_tolerance = ANIMATION_TOLERANCE;
+
+    // every mesh's data back to back, a mesh's first_index/first_vertex say where its part starts.
+    // indices are relative to the mesh's first vertex. a baked model leaves these empty and reads the bake instead.
+    std::vector<Vertex>     vertex_buffer;
+    std::vector<uint32_t>   index_buffer;
+    std::vector<glm::vec3>  collider_buffer;        // vertex positions with the node matrix applied, for collision meshes.
+    std::shared_ptr<BakedAsset> baked;              // mapped bake, kept open for as long as anything points into it.
+
+    // gl work left over from load(), upload() works through these. textures are in material order.
+    std::vector<PendingTexture> pending_textures;
+    std::vector<MeshPrimitive *> pending_meshes;
+    std::once_flag load_once;                       // acquire_model loads it on the first thread to ask.
+
+    bool load(const std::string &filename);     // everything but gl, so it can run off the main thread.
+    bool upload(size_t &budget);                // main thread only. uploads until budget bytes are spent, true once everything is.
+    void release();                             // main thread only. frees whatever upload gave to gl, see release_model.
+    bool is_uploaded() const { return pending_textures.empty() && pending_meshes.empty(); }
+    std::span<const Vertex> get_vertices(const MeshPrimitive &mesh) const;
+    std::span<const uint32_t> get_indices(const MeshPrimitive &mesh) const;
+    std::span<const glm::vec3> get_collider_vertices(const MeshPrimitive &mesh) const;
+    void load_gltf(tinygltf::Model &input);
+    bool load_baked(const std::string &filename);
+    int32_t node_from_index(uint32_t index) const;  // -1 if no node came from that gltf node.
+    void load_material(tinygltf::Model &input);
+    void load_node(const tinygltf::Node &input_node, tinygltf::Model &input, int32_t parent, uint32_t node_index, const glm::mat4 &parent_matrix);
+    void load_skins(tinygltf::Model &input);
+    void load_animations(tinygltf::Model &input);
+    void finish_load();
+    void compress_animations();                 // prints what each animation saved.
+    void compute_bounds();
+    uint32_t get_skin_offset(int32_t skin) const;   // where a skin's joints start in a model's part of the JointPalette.
+    uint32_t get_palette_size() const;
+};
+
+struct RenderQueue;
 
+// model class which contains a number of meshes which are drawn individually.
+// could make this like the colliders and have inheritence so can have mesh, circle, frustum etc.
+// an instance: the data is shared with every other model of the same file, only the pose and animation state are its own.
+struct Model
+{
+    std::shared_ptr<ModelData> data;
+    std::vector<NodeTransform> transforms;                          // by node. mark_dirty() after changing one.
+    std::vector<glm::mat4> local_matrices;                          // by node, cached from transforms.
+    std::vector<glm::mat4> world_matrices;                          // by node, in the model's space.
+    std::vector<uint8_t> dirty;                                     // by node, NODE_DIRTY_ flags.
+    std::vector<std::array<glm::mat4, MAX_JOINTS>> joint_matrices;  // by skin.
+    std::vector<float> animation_times;                             // by animation.
+    std::vector<std::vector<uint32_t>> key_cursors;                 // by animation then channel, the key it was last between.
     uint32_t active_animation = 0;      // general format: 0 = idle, 1 = walk, 2 = jump/fall.
+    int32_t joint_offset = -1;          // where its joints start in this frame's JointPalette, -1 until it's added.
 
     Model() {}; // default constructor.
-    Model(std::string filename);
-    Node *find_node(Node *parent, uint32_t index);
-    Node *node_from_index(uint32_t index);
-    void bind_node(Node *node);
-    void draw_node(Node node, GLenum mode, glm::mat4 transform, Shader shader);
-    void draw(glm::vec3 position, glm::quat rotation, glm::vec3 scale, Shader shader, Camera camera, glm::vec3 colour);
-    void update_joints(Node *node);
+    Model(std::string filename);                // load and upload in one go.
+    bool load(const std::string &filename);     // shares the data if another model has the file loaded, no gl either way.
+    bool upload(size_t &budget);                // see ModelData::upload, nothing to do if it's shared and already uploaded.
+    void release();                             // main thread only. drops the data, freeing its gl side if no other model uses it.
+    const glm::mat4 &get_node_matrix(uint32_t node) const { return world_matrices[node]; }
+    void mark_dirty(uint32_t node) { dirty[node] = NODE_DIRTY_LOCAL | NODE_DIRTY_WORLD; }
+    void update_world_matrices();               // one pass over the nodes, only recomputes what's dirty.
+    void draw_node(RenderQueue &queue, uint32_t node, glm::mat4 transform, Shader shader, glm::vec3 colour, uint32_t layer);
+    void draw(RenderQueue &queue, glm::vec3 position, glm::quat rotation, glm::vec3 scale, Shader shader, glm::vec3 colour);
+    void update_joints();
     void update_animations(float delta_time, uint32_t animation_index);
-    void load_material(tinygltf::Model &input);
-    void load_node(const tinygltf::Node &input_node, tinygltf::Model &input, Node *parent, uint32_t node_index, std::vector<uint32_t> &index_buffer, std::vector<Vertex> &vertex_buffer);
-    void load_skins(tinygltf::Model &input);
-    void load_animations(tinygltf::Model &input);
+    void reset_pose();
+};
+
+// position, rotation and scale as a single matrix, the transform Model::draw applies.
+glm::mat4 get_model_matrix(glm::vec3 position, glm::quat rotation, glm::vec3 scale);
+
+// what one instance of a model needs in an instanced draw, uploaded as per instance vertex attributes.
+struct InstanceAttributes
+{
+    glm::mat4 model;
+    glm::vec3 albedo;
+    int32_t joints;     // the model's joint_offset.
+};
+
+// instances that can go in the same draw: the same model data with the same matrices on their mesh nodes,
+// since the node matrix is a uniform shared by the whole draw. joints come from the palette so they can differ.
+struct InstanceGroup
+{
+    const Model *model;                         // any one of the instances, for its mesh data.
+    std::vector<glm::mat4> node_matrices;       // by mesh node, in node order.
+    std::vector<InstanceAttributes> instances;
+    size_t first = 0;                           // where the group starts in the instance buffer.
+};
+
+// draws repeated models (npcs) with one glDrawElementsInstanced per mesh instead of a draw per mesh per model.
+// clear() and add() every model each frame, upload() once, then draw() into each queue that wants them.
+// needs an instanced shader (cel_instanced.vert, shadow_map_instanced.vert).
+struct InstancedRenderer
+{
+    std::vector<InstanceGroup> groups;
+    std::vector<InstanceAttributes> attributes; // every group's instances back to back, as uploaded.
+    std::vector<glm::mat4> node_matrices;       // the model being added's, kept so it doesn't reallocate.
+    GLuint instance_buffer  = 0;
+    size_t capacity         = 0;                // instances the buffer has room for.
+
+    void clear();
+    void add(const Model &model, glm::mat4 transform, glm::vec3 colour);
+    void upload();
+    void draw(RenderQueue &queue, Shader shader);
+    void draw_node(RenderQueue &queue, const InstanceGroup &group, uint32_t node, Shader shader, size_t &mesh_node);
+};
+
+// every model's joint matrices for a frame, in one texture buffer that the shaders index with joint_offset.
+// replaces uploading the joint matrices as uniforms on every draw of every model, in every shadow cascade.
+// a model's part starts with an identity matrix for its meshes without a skin, then each skin's joints in order.
+// clear(), add() every model that's going to be drawn, upload(), then draw.
+struct JointPalette
+{
+    std::vector<glm::mat4> matrices;    // starts with an identity, for draws that aren't from a model (lines etc).
+    GLuint buffer   = 0;
+    GLuint texture  = 0;
+    size_t capacity = 0;                // matrices the buffer has room for.
+
+    void clear();
+    void add(Model &model);             // sets the model's joint_offset.
+    void upload();                      // and binds it to JOINT_PALETTE_UNIT.
+};
+
+// a mesh to draw and everything the draw needs, so the draw can be sorted with the rest before any of it reaches gl.
+struct DrawItem
+{
+    uint32_t shader;                        // index into RenderQueue::shaders, submit() fills it in.
+    uint32_t layer          = RENDER_LAYER_OPAQUE;
+    const MeshPrimitive *mesh;
+    GLuint texture          = 0;            // bound to texture0, 0 for none.
+    GLenum texture_target   = GL_TEXTURE_2D;
+    GLenum cull_face        = GL_BACK;
+    glm::mat4 transform;                    // mvp, or node_matrix for an instanced draw.
+    glm::vec3 albedo        = glm::vec3(1.0f);
+    int32_t joint_offset    = 0;
+    AABB bounds;                            // world space, of every instance for an instanced draw.
+
+    // instanced draws only.
+    GLuint instance_buffer  = 0;
+    uint32_t first_instance = 0;
+    uint32_t instance_count = 0;            // 0 for a plain draw.
+};
+
+// what a RenderQueue::draw did, in draw items.
+struct PassStats
+{
+    uint32_t drawn  = 0;
+    uint32_t culled = 0;    // outside the pass's frustum.
+};
+
+// the draws for a pass. models submit into it rather than drawing, then draw() culls against the frustum it's given,
+// sorts by layer, program, texture and vao and only touches gl state that changes between one draw and the next.
+// the camera uniforms and shadow maps are set once per program rather than once per model.
+// a queue can be drawn more than once (each shadow cascade), culling against each one's frustum.
+struct RenderQueue
+{
+    std::vector<Shader> shaders;                        // every program the items use.
+    std::vector<DrawItem> items;
+    std::vector<std::pair<uint64_t, uint32_t>> order;   // sort key and item index, kept so it doesn't reallocate.
+
+    void clear();
+    void submit(Shader shader, DrawItem item);
+    PassStats draw(Camera &camera, const glm::mat4 &view_projection);
 };
 
 
@@ -238,18 +477,26 @@ struct Image2D
 
 struct Skybox
 {
-    GLuint ID;
+    GLuint ID = 0;
     GLuint VAO;
     GLuint VBO;
     
-    Model cube_mesh = Model("cube.gltf");
+    Model cube_mesh;
     std::array<std::string, 6> filenames = {
         "pos_x", "neg_x",
         "pos_y", "neg_y",
         "pos_z", "neg_z"
     };
 
+    // faces waiting for upload, in filenames order.
+    std::array<PendingTexture, 6> faces;
+    size_t uploaded_faces = 0;
+    std::shared_ptr<BakedAsset> baked;
+
     Skybox() {}; // default constructor.
-    Skybox(int level_index);
-    void draw(glm::vec3 position, Shader shader, Camera camera);
+    Skybox(int level_index);                    // load and upload in one go.
+    bool load(int level_index);                 // decodes (or maps) the faces and loads the cube, no gl.
+    bool upload(size_t &budget);                // main thread only, same as Model::upload.
+    void release();                             // main thread only, same as Model::release.
+    void draw(RenderQueue &queue, glm::vec3 position, Shader shader, Camera camera);
 };
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "headless.hpp"
+#include "simulation.hpp"
+#include "null_gl.hpp"
+#include "input.hpp"
+#include "jobs.hpp"
+#include "replay.hpp"
+#include "resource.hpp"   // model count.
+
+#include <iostream>     // report.
+#include <iomanip>      // report formatting.
+#include <cstring>      // argument parsing.
+#include <cstdlib>      // std::atoi.
+#include <string>
+#include <chrono>
+
+#define HEADLESS_TICKS  3600    // one minute at 60 ticks per second.
+
+using std::cout;
+using clock_type = std::chrono::steady_clock;
+
+// the default input when there's no --replay: walk forward, strafe, back up and strafe the other way
+// for 1.5 seconds each, jump every 2 seconds and swing the camera for the first 40 ticks of every 5 seconds.
+// enough to run the player into walls, off ledges and through triggers.
+static void scripted_input(int tick)
+{
+    int phase       = (tick / 90) % 4;
+    AXIS_0_UP       = ((phase == 0) || (phase == 1)) ? 1.0f : 0.0f;
+    AXIS_0_LEFT     = (phase == 1) ? 1.0f : 0.0f;
+    AXIS_0_DOWN     = (phase == 2) ? 1.0f : 0.0f;
+    AXIS_0_RIGHT    = (phase == 3) ? 1.0f : 0.0f;
+    AXIS_1_LEFT     = ((tick % 300) < 40) ? 1.0f : 0.0f;
+    SPACE_PRESSED   = ((tick % 120) == 60) ? 1 : 0;
+}
+
+int run_headless(int argc, char **argv)
+{
+    int ticks   = HEADLESS_TICKS;
+    int workers = 0;
+    std::string record_path;
+    std::string replay_path;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--headless") == 0)
+        {
+            continue;
+        }
+        else if ((std::strcmp(argv[i], "--ticks") == 0) && (i + 1 < argc))
+        {
+            ticks = std::atoi(argv[++i]);
+        }
+        else if ((std::strcmp(argv[i], "--workers") == 0) && (i + 1 < argc))
+        {
+            workers = std::atoi(argv[++i]);
+        }
+        else if ((std::strcmp(argv[i], "--record") == 0) && (i + 1 < argc))
+        {
+            record_path = argv[++i];
+        }
+        else if ((std::strcmp(argv[i], "--replay") == 0) && (i + 1 < argc))
+        {
+            replay_path = argv[++i];
+        }
+        else
+        {
+            cout << "unknown headless option: " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    // a replay sets its own length and timestep.
+    InputReplay replay;
+    double dt = 1.0 / 60.0;
+    if (!replay_path.empty())
+    {
+        if (!replay.load(replay_path))
+        {
+            return 1;
+        }
+        ticks   = static_cast<int>(replay.tick_count);
+        dt      = replay.dt;
+    }
+
+    if (ticks <= 0)
+    {
+        cout << "--ticks must be at least 1.\n";
+        return 1;
+    }
+
+    if (!load_null_gl())
+    {
+        cout << "failed to load null gl.\n";
+        return 1;
+    }
+
+    // same setup as the windowed game.
+    clock_type::time_point load_start = clock_type::now();
+    Player player("boar_pig.gltf");
+    Camera camera;
+    if (!replay_path.empty())
+    {
+        player.current_level = replay.start_level;
+    }
+    Level level(player.current_level);
+    JobSystem jobs(workers);
+    player.narrow_phase.jobs = &jobs;
+    double load_seconds = std::chrono::duration<double>(clock_type::now() - load_start).count();
+
+    SimulationProfile profile;
+    InputRecorder recorder(player.current_level, dt);
+    uint64_t hash = REPLAY_HASH_SEED;
+
+    clock_type::time_point start = clock_type::now();
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        if (replay_path.empty())
+        {
+            scripted_input(tick);
+        }
+        else
+        {
+            apply_input(replay.next());
+        }
+        if (!record_path.empty())
+        {
+            recorder.record(capture_input());
+        }
+
+        update_simulation(player, camera, level, dt, &profile);
+        level.stream(STREAM_UPLOAD_BUDGET);     // a tick is a frame here, same as the game at 60fps.
+        hash = hash_trajectory(hash, player.position);
+
+        if (!replay_path.empty())
+        {
+            replay.check_result(player.position);
+        }
+        if (!record_path.empty())
+        {
+            recorder.record_result(player.position);
+        }
+    }
+    double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    // report.
+    const CollisionStats &stats = player.collision_stats;
+    cout << std::fixed << std::setprecision(3);
+    cout << "\nheadless: " << ticks << " ticks in " << seconds << "s, " << std::setprecision(1) << (ticks / seconds) << " ticks/sec"
+         << std::setprecision(3) << " (" << (seconds * 1000.0 / ticks) << " ms/tick), " << jobs.get_thread_count() << " thread(s)\n";
+    cout << "load: " << load_seconds << "s, " << get_model_count() << " models loaded\n\n";
+
+    cout << "subsystem     total ms    us/tick    share\n";
+    for (int i = 0; i < SUBSYSTEM_COUNT; ++i)
+    {
+        double share = (profile.get_total() > 0.0) ? (profile.seconds[i] / profile.get_total()) : 0.0;
+        cout << std::left << std::setw(10) << SimulationProfile::get_name(i) << std::right
+             << std::setw(12) << (profile.seconds[i] * 1000.0)
+             << std::setw(11) << (profile.seconds[i] * 1000000.0 / ticks)
+             << std::setw(8) << std::setprecision(1) << (share * 100.0) << "%" << std::setprecision(3) << "\n";
+    }
+
+    cout << "\ncollision: " << stats.queries << " queries, " << stats.casts << " casts, " << stats.rays << " rays, "
+         << stats.triangle_tests << " triangles, " << stats.epa_runs << " epa runs (" << stats.epa_failures << " failed)\n";
+    cout << "position hash: " << std::hex << std::setw(16) << std::setfill('0') << hash << std::dec << std::setfill(' ') << "\n";
+
+    if (!record_path.empty() && !recorder.save(record_path))
+    {
+        return 1;
+    }
+    if (!replay_path.empty())
+    {
+        cout << "replay: " << replay.events.size() << " bytes of input, " << (static_cast<double>(replay.events.size()) / ticks) << " bytes/tick\n";
+        if (replay.desync_tick >= 0)
+        {
+            cout << "replay: desync, trajectory stopped matching the recording within the " << REPLAY_CHECKPOINT_TICKS
+                 << " ticks up to tick " << replay.desync_tick << "\n";
+            return 1;
+        }
+        cout << "replay: matches recording\n";
+    }
+    return 0;
+}
+
+#ifdef HEADLESS
+// headless builds have nothing else to run.
+int main(int argc, char **argv)
+{
+    return run_headless(argc, argv);
+}
+#endif
@@ -0,0 +1,12 @@
+#pragma once
+
+// runs the fixed timestep update loop with no window, gl context or audio and reports how fast it went.
+// gl calls go to null_gl, so models and levels still load but nothing is drawn.
+// options (argv[0] is skipped, as is --headless so the game can pass its own arguments straight through):
+//      --ticks n       number of ticks to simulate (default HEADLESS_TICKS).
+//      --workers n     narrow phase worker threads, -1 = one per spare hardware thread (default 0).
+//      --record path   save the input and trajectory to a replay file (see replay.hpp).
+//      --replay path   play a replay file back instead of the scripted input, --ticks is ignored.
+//                      exits with 1 if the trajectory doesn't match the recording bit for bit.
+// returns the process exit code.
+int run_headless(int argc, char **argv);
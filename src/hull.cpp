@@ -0,0 +1,351 @@
+#include "hull.hpp"
+#include <array>            // face indices.
+#include <algorithm>        // sort/unique adjacency, std::swap.
+
+// triangle on the surface of the hull being built. vertices are wound ccw when viewed from outside.
+struct HullFace
+{
+    std::array<uint32_t, 3> v;
+    std::array<uint32_t, 3> neighbour;  // face on the other side of edge v[i] -> v[i + 1].
+    std::vector<uint32_t> outside;      // points in front of this face that still need adding (conflict list).
+    glm::vec3 normal;
+    float offset;                       // distance of the face plane from the origin along the normal.
+    uint32_t mark   = 0;                // set to the current iteration when the face is found to be visible.
+    bool alive      = true;
+};
+
+// edge of the visible region, new faces are built between these and the eye point.
+struct HorizonEdge
+{
+    uint32_t a;
+    uint32_t b;
+    uint32_t visible_face;  // face being removed.
+    uint32_t other_face;    // face being kept.
+};
+
+static HullFace make_face(std::span<const glm::vec3> points, uint32_t a, uint32_t b, uint32_t c)
+{
+    HullFace face;
+    face.v          = {a, b, c};
+    face.normal     = glm::cross(points[b] - points[a], points[c] - points[a]);
+    float length    = glm::length(face.normal);
+    face.normal     = (length > 0.0f) ? face.normal / length : glm::vec3(0.0f);
+    face.offset     = glm::dot(face.normal, points[a]);
+    return face;
+}
+
+static float face_distance(const HullFace &face, glm::vec3 point)
+{
+    return glm::dot(face.normal, point) - face.offset;
+}
+
+// walk across every face the eye can see, recording the edges where the visible region ends.
+// entering each face from the edge it was reached by keeps the horizon in order.
+static void find_horizon(std::vector<HullFace> &faces, glm::vec3 eye, float epsilon, uint32_t mark, uint32_t face, int entry_edge, std::vector<uint32_t> &visible, std::vector<HorizonEdge> &horizon)
+{
+    faces[face].mark = mark;
+    visible.push_back(face);
+
+    for (int i = (entry_edge < 0) ? 0 : 1; i < 3; ++i)
+    {
+        int k               = (entry_edge < 0) ? i : (entry_edge + i) % 3;
+        uint32_t neighbour  = faces[face].neighbour[k];
+
+        if (faces[neighbour].mark == mark)
+        {
+            continue;
+        }
+
+        if (face_distance(faces[neighbour], eye) > epsilon)
+        {
+            // find which of the neighbour's edges leads back here.
+            int back_edge = 0;
+            for (int j = 0; j < 3; ++j)
+            {
+                if (faces[neighbour].neighbour[j] == face)
+                {
+                    back_edge = j;
+                }
+            }
+            find_horizon(faces, eye, epsilon, mark, neighbour, back_edge, visible, horizon);
+        }
+        else
+        {
+            horizon.push_back({faces[face].v[k], faces[face].v[(k + 1) % 3], face, neighbour});
+        }
+    }
+}
+
+// quickhull: start from a tetrahedron, give every point to a face it is in front of,
+// then repeatedly take the furthest point of a face, remove every face it can see,
+// and stitch the hole (the horizon) to the point.
+ConvexHull build_convex_hull(std::span<const glm::vec3> points)
+{
+    ConvexHull hull;
+    if (points.size() < 4)
+    {
+        return hull;
+    }
+
+    // tolerance is relative to the size of the mesh so big level pieces don't get noisy hulls.
+    glm::vec3 min = points[0];
+    glm::vec3 max = points[0];
+    for (const glm::vec3 &point : points)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    float epsilon = HULL_EPSILON * glm::length(max - min);
+
+    // initial tetrahedron. first two points are the extremes along the widest axis.
+    glm::vec3 extent    = max - min;
+    int axis            = (extent.x > extent.y) ? ((extent.x > extent.z) ? 0 : 2) : ((extent.y > extent.z) ? 1 : 2);
+    uint32_t i0         = 0;
+    uint32_t i1         = 0;
+    for (uint32_t i = 0; i < points.size(); ++i)
+    {
+        if (points[i][axis] < points[i0][axis]) { i0 = i; }
+        if (points[i][axis] > points[i1][axis]) { i1 = i; }
+    }
+    if (i0 == i1)
+    {
+        return hull;
+    }
+
+    // third point is furthest from the line between the first two.
+    uint32_t i2     = i0;
+    float furthest  = 0.0f;
+    glm::vec3 line  = glm::normalize(points[i1] - points[i0]);
+    for (uint32_t i = 0; i < points.size(); ++i)
+    {
+        float distance = glm::length(glm::cross(points[i] - points[i0], line));
+        if (distance > furthest)
+        {
+            furthest    = distance;
+            i2          = i;
+        }
+    }
+    if (furthest <= epsilon)
+    {
+        return hull;
+    }
+
+    // fourth point is furthest from the plane of the first three.
+    uint32_t i3         = i0;
+    furthest            = 0.0f;
+    glm::vec3 normal    = glm::normalize(glm::cross(points[i1] - points[i0], points[i2] - points[i0]));
+    for (uint32_t i = 0; i < points.size(); ++i)
+    {
+        float distance = glm::abs(glm::dot(points[i] - points[i0], normal));
+        if (distance > furthest)
+        {
+            furthest    = distance;
+            i3          = i;
+        }
+    }
+    if (furthest <= epsilon)
+    {
+        // mesh is flat, so there is no volume to build a hull around.
+        return hull;
+    }
+
+    // wind the base triangle so the fourth point is behind it, the other faces then follow from its edges.
+    if (glm::dot(normal, points[i3] - points[i0]) > 0.0f)
+    {
+        std::swap(i1, i2);
+    }
+
+    std::vector<HullFace> faces;
+    faces.push_back(make_face(points, i0, i1, i2));
+    faces.push_back(make_face(points, i1, i0, i3));
+    faces.push_back(make_face(points, i2, i1, i3));
+    faces.push_back(make_face(points, i0, i2, i3));
+    faces[0].neighbour = {1, 2, 3};
+    faces[1].neighbour = {0, 3, 2};
+    faces[2].neighbour = {0, 1, 3};
+    faces[3].neighbour = {0, 2, 1};
+
+    // hand out the remaining points to the first face they are in front of.
+    for (uint32_t i = 0; i < points.size(); ++i)
+    {
+        if ((i == i0) || (i == i1) || (i == i2) || (i == i3))
+        {
+            continue;
+        }
+        for (HullFace &face : faces)
+        {
+            if (face_distance(face, points[i]) > epsilon)
+            {
+                face.outside.push_back(i);
+                break;
+            }
+        }
+    }
+
+    std::vector<uint32_t> visible;
+    std::vector<HorizonEdge> horizon;
+    std::vector<uint32_t> orphans;
+    uint32_t mark = 0;
+
+    // new faces are appended, so this also visits every face created along the way.
+    for (size_t f = 0; f < faces.size(); ++f)
+    {
+        if (!faces[f].alive || faces[f].outside.empty())
+        {
+            continue;
+        }
+
+        // furthest point of this face becomes the next hull vertex.
+        uint32_t eye    = faces[f].outside[0];
+        furthest        = face_distance(faces[f], points[eye]);
+        for (uint32_t point : faces[f].outside)
+        {
+            float distance = face_distance(faces[f], points[point]);
+            if (distance > furthest)
+            {
+                furthest    = distance;
+                eye         = point;
+            }
+        }
+
+        mark++;
+        visible.clear();
+        horizon.clear();
+        find_horizon(faces, points[eye], epsilon, mark, static_cast<uint32_t>(f), -1, visible, horizon);
+
+        // points belonging to the removed faces need a new home.
+        orphans.clear();
+        for (uint32_t index : visible)
+        {
+            for (uint32_t point : faces[index].outside)
+            {
+                if (point != eye)
+                {
+                    orphans.push_back(point);
+                }
+            }
+            faces[index].alive = false;
+            faces[index].outside.clear();
+            faces[index].outside.shrink_to_fit();
+        }
+
+        // new faces keep the winding of the face they replaced, so they also point outwards.
+        uint32_t first_new = static_cast<uint32_t>(faces.size());
+        for (const HorizonEdge &edge : horizon)
+        {
+            uint32_t index          = static_cast<uint32_t>(faces.size());
+            HullFace face           = make_face(points, edge.a, edge.b, eye);
+            face.neighbour[0]       = edge.other_face;
+            faces.push_back(face);
+
+            // point the kept face at the new face instead of the removed one.
+            for (uint32_t &neighbour : faces[edge.other_face].neighbour)
+            {
+                if (neighbour == edge.visible_face)
+                {
+                    neighbour = index;
+                    break;
+                }
+            }
+        }
+
+        // link the new faces to each other around the eye.
+        for (uint32_t i = first_new; i < faces.size(); ++i)
+        {
+            for (uint32_t j = first_new; j < faces.size(); ++j)
+            {
+                if (faces[j].v[0] == faces[i].v[1]) { faces[i].neighbour[1] = j; }
+                if (faces[j].v[1] == faces[i].v[0]) { faces[i].neighbour[2] = j; }
+            }
+        }
+
+        // points not in front of any new face are inside the hull now.
+        for (uint32_t point : orphans)
+        {
+            for (uint32_t i = first_new; i < faces.size(); ++i)
+            {
+                if (face_distance(faces[i], points[point]) > epsilon)
+                {
+                    faces[i].outside.push_back(point);
+                    break;
+                }
+            }
+        }
+    }
+
+    // remap point indices to hull vertex indices.
+    std::vector<uint32_t> remap(points.size(), UINT32_MAX);
+    for (HullFace &face : faces)
+    {
+        if (!face.alive)
+        {
+            continue;
+        }
+        for (uint32_t &v : face.v)
+        {
+            if (remap[v] == UINT32_MAX)
+            {
+                remap[v] = static_cast<uint32_t>(hull.vertex_storage.size());
+                hull.vertex_storage.push_back(points[v]);
+            }
+            v = remap[v];
+        }
+    }
+
+    // every face edge connects two neighbouring vertices.
+    std::vector<std::vector<uint32_t>> neighbours(hull.vertex_storage.size());
+    for (const HullFace &face : faces)
+    {
+        if (!face.alive)
+        {
+            continue;
+        }
+        for (int k = 0; k < 3; ++k)
+        {
+            neighbours[face.v[k]].push_back(face.v[(k + 1) % 3]);
+            neighbours[face.v[(k + 1) % 3]].push_back(face.v[k]);
+        }
+    }
+
+    // flatten into a single array.
+    hull.offset_storage.push_back(0);
+    for (auto &list : neighbours)
+    {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        hull.adjacency_storage.insert(hull.adjacency_storage.end(), list.begin(), list.end());
+        hull.offset_storage.push_back(static_cast<uint32_t>(hull.adjacency_storage.size()));
+    }
+
+    hull.vertices           = hull.vertex_storage;
+    hull.adjacency_offsets  = hull.offset_storage;
+    hull.adjacency          = hull.adjacency_storage;
+    return hull;
+}
+
+// walk to whichever neighbour is further in the direction until none are.
+// the hull is convex so a local maximum is also the global one, and starting
+// from the previous result means it usually only takes a step or two.
+uint32_t ConvexHull::hill_climb(glm::vec3 direction, uint32_t start) const
+{
+    uint32_t current    = start;
+    float best          = glm::dot(vertices[current], direction);
+    bool improved       = true;
+
+    while (improved)
+    {
+        improved        = false;
+        uint32_t vertex = current;
+        for (uint32_t i = adjacency_offsets[vertex]; i < adjacency_offsets[vertex + 1]; ++i)
+        {
+            float distance = glm::dot(vertices[adjacency[i]], direction);
+            if (distance > best)
+            {
+                best        = distance;
+                current     = adjacency[i];
+                improved    = true;
+            }
+        }
+    }
+    return current;
+}
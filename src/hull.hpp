@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>       // hull vertices and adjacency.
+#include <span>         // baked hulls stay in the bake.
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#define HULL_EPSILON    0.00001f    // relative tolerance (scaled by mesh size) for a point being outside a face.
+
+// convex hull of a point cloud, stored as the hull vertices plus which vertices share an edge.
+// the adjacency is what allows the support function to walk across the surface instead of scanning every vertex.
+// the arrays are spans, either over what build_convex_hull made or over a baked hull (see asset.hpp) left in the bake.
+struct ConvexHull
+{
+    std::span<const glm::vec3>  vertices;           // hull vertices only, interior points are discarded.
+    std::span<const uint32_t>   adjacency_offsets;  // neighbours of vertex i are adjacency[offsets[i]] to adjacency[offsets[i + 1]].
+    std::span<const uint32_t>   adjacency;          // flattened neighbour list.
+
+    // constructors. a built hull's spans point into its own storage, which a move keeps but a copy wouldn't.
+    ConvexHull() {}
+    ConvexHull(std::span<const glm::vec3> vertices, std::span<const uint32_t> adjacency_offsets, std::span<const uint32_t> adjacency)
+        : vertices(vertices), adjacency_offsets(adjacency_offsets), adjacency(adjacency) {}
+    ConvexHull(ConvexHull &&) = default;
+    ConvexHull &operator=(ConvexHull &&) = default;
+    ConvexHull(const ConvexHull &) = delete;
+    ConvexHull &operator=(const ConvexHull &) = delete;
+
+    // a hull is only built for meshes with volume, flat or degenerate meshes are left empty.
+    bool is_valid() const { return !adjacency.empty(); }
+    uint32_t hill_climb(glm::vec3 direction, uint32_t start) const;
+
+private:
+    std::vector<glm::vec3>  vertex_storage;     // filled by build_convex_hull, unused by a baked hull.
+    std::vector<uint32_t>   offset_storage;
+    std::vector<uint32_t>   adjacency_storage;
+
+    friend ConvexHull build_convex_hull(std::span<const glm::vec3> points);
+};
+
+// build the hull of the given points. returns an empty (invalid) hull if the points are coplanar.
+ConvexHull build_convex_hull(std::span<const glm::vec3> points);
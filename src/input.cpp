@@ -26,6 +26,7 @@ int INPUT_3_PREV = 0;
 
 int SPACE_PRESSED_PREV = 0;
 
+#ifndef HEADLESS
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
     switch (action)
@@ -189,6 +190,7 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
             break;
     }
 }
+#endif
 
 void update_inputs()
 {
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "glad.h"
+#ifndef HEADLESS
 #include "GLFW/glfw3.h"
+#endif
 
 // movement axis/dpad/wasd/left stick etc.
 extern float AXIS_0_UP;
@@ -30,6 +32,8 @@ extern int INPUT_3_PREV;
 
 extern int SPACE_PRESSED_PREV;
 
-// key callback.
+// key callback. headless builds have no window to get keys from.
+#ifndef HEADLESS
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
+#endif
 void update_inputs();
\ No newline at end of file
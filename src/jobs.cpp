@@ -0,0 +1,174 @@
+#include "jobs.hpp"
+#include <algorithm>    // std::min, std::max.
+
+// queue functions.
+bool JobQueue::push(const JobTask &task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (count == JOBS_QUEUE_SIZE)
+    {
+        return false;
+    }
+    tasks[(front + count) % JOBS_QUEUE_SIZE] = task;
+    count++;
+    return true;
+}
+
+bool JobQueue::pop(JobTask &task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (count == 0)
+    {
+        return false;
+    }
+    count--;
+    task = tasks[(front + count) % JOBS_QUEUE_SIZE];
+    return true;
+}
+
+bool JobQueue::steal(JobTask &task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (count == 0)
+    {
+        return false;
+    }
+    task    = tasks[front];
+    front   = (front + 1) % JOBS_QUEUE_SIZE;
+    count--;
+    return true;
+}
+
+// job system functions.
+JobSystem::JobSystem(int thread_count)
+{
+    if (thread_count < 0)
+    {
+        thread_count = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    }
+    worker_count = std::clamp(thread_count, 0, JOBS_MAX_WORKERS);
+
+    workers.reserve(worker_count);
+    for (int i = 0; i < worker_count; ++i)
+    {
+        workers.emplace_back(&JobSystem::worker_loop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void JobSystem::dispatch(int count, int chunk_size, void (*run)(void *, int, int), void *context)
+{
+    chunk_size = std::max(chunk_size, 1);
+    if ((count <= chunk_size) || (worker_count == 0))
+    {
+        if (count > 0)
+        {
+            run(context, 0, count);
+        }
+        return;
+    }
+
+    std::atomic<int> remaining((count + chunk_size - 1) / chunk_size);
+    int caller_queue = worker_count;
+
+    // deal the chunks out round robin, starting with the caller so it has something to do straight away.
+    int queue = caller_queue;
+    for (int begin = 0; begin < count; begin += chunk_size)
+    {
+        JobTask task;
+        task.run        = run;
+        task.context    = context;
+        task.begin      = begin;
+        task.end        = std::min(begin + chunk_size, count);
+        task.remaining  = &remaining;
+
+        if (queues[queue].push(task))
+        {
+            queued++;
+        }
+        else
+        {
+            execute(task);
+        }
+        queue = (queue + 1) % (caller_queue + 1);
+    }
+
+    {
+        // taking the lock means a worker can't miss the notify between checking queued and going to sleep.
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    wake.notify_all();
+
+    // help out until every chunk is done, other threads may still be finishing the last few.
+    JobTask task;
+    while (remaining.load(std::memory_order_acquire) > 0)
+    {
+        if (find_task(caller_queue, task))
+        {
+            execute(task);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// own queue first, then try to steal from everyone else.
+bool JobSystem::find_task(int queue, JobTask &task)
+{
+    int queue_count = worker_count + 1;
+    if (queues[queue].pop(task))
+    {
+        queued--;
+        return true;
+    }
+    for (int i = 1; i < queue_count; ++i)
+    {
+        if (queues[(queue + i) % queue_count].steal(task))
+        {
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(const JobTask &task)
+{
+    task.run(task.context, task.begin, task.end);
+    task.remaining->fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::worker_loop(int queue)
+{
+    JobTask task;
+    while (true)
+    {
+        if (find_task(queue, task))
+        {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [this] { return stopping || (queued.load() > 0); });
+        if (stopping)
+        {
+            return;
+        }
+    }
+}
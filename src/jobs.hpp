@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>                // per worker task queues.
+#include <vector>               // workers.
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <type_traits>          // std::remove_reference_t for the job type.
+
+#define JOBS_MAX_WORKERS    15      // worker threads, not counting the thread that calls parallel_for.
+#define JOBS_QUEUE_SIZE     256     // tasks each queue can hold, a full queue runs the task straight away instead.
+
+// a chunk of a parallel_for, runs the job over [begin, end).
+struct JobTask
+{
+    void (*run)(void *context, int begin, int end) = nullptr;
+    void *context                   = nullptr;
+    int begin                       = 0;
+    int end                         = 0;
+    std::atomic<int> *remaining     = nullptr;  // chunks of the parallel_for still to finish.
+};
+
+// fixed size ring of tasks. the owner takes from the back (most recently pushed, still in cache),
+// other threads steal from the front (oldest, most likely to be a big chunk of work nobody has touched).
+struct JobQueue
+{
+    std::mutex mutex;
+    std::array<JobTask, JOBS_QUEUE_SIZE> tasks;
+    int front = 0;
+    int count = 0;
+
+    bool push(const JobTask &task);
+    bool pop(JobTask &task);
+    bool steal(JobTask &task);
+};
+
+// work stealing thread pool. parallel_for splits a range into chunks and spreads them over every thread's queue,
+// threads that run out of work steal from the others, and the calling thread works too until the range is done.
+// nothing here allocates after construction, so it's safe to use inside the fixed timestep loop.
+struct JobSystem
+{
+    JobSystem(int thread_count = -1);   // worker threads to start, -1 = one per hardware thread minus the caller.
+    ~JobSystem();
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // calls job(begin, end) over [0, count) in chunks of chunk_size, returns once every chunk is done.
+    // a range that fits in a single chunk just runs on the caller.
+    template <typename Job>
+    void parallel_for(int count, int chunk_size, Job &&job)
+    {
+        auto run = [](void *context, int begin, int end) { (*static_cast<std::remove_reference_t<Job> *>(context))(begin, end); };
+        dispatch(count, chunk_size, run, &job);
+    }
+
+    int get_thread_count() const { return worker_count + 1; }
+
+private:
+    int worker_count = 0;                                   // set before any worker starts, they read it to find the queues.
+    std::vector<std::thread> workers;
+    std::array<JobQueue, JOBS_MAX_WORKERS + 1> queues;     // last queue belongs to the calling thread.
+    std::atomic<int> queued{0};                             // tasks sitting in any queue.
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void dispatch(int count, int chunk_size, void (*run)(void *, int, int), void *context);
+    bool find_task(int queue, JobTask &task);
+    void execute(const JobTask &task);
+    void worker_loop(int queue);
+};
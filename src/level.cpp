@@ -2,6 +2,9 @@
 
 
 #include <iostream>
+#include <algorithm>    // sorting broad phase results, finding queued levels.
+#include <chrono>       // load time.
+#include <cstdint>      // SIZE_MAX, an unlimited upload budget.
 
 Level::Level(int initial_level)
 {
@@ -15,34 +18,162 @@ void Level::load(int level_index)
     // something simple just like a quick fade to black, load the level, fade up from black.
     // wonder how to go abt it tbh, could be like, a value sent to the shader?
 
-    current_level   = level_index;
-    model           = Model("scene_" + std::to_string(level_index) + ".gltf");
+    auto load_start     = std::chrono::steady_clock::now();
+    const char *source  = "resident";
+    if (level_index != current_level)
+    {
+        if (current_level > -1)
+        {
+            make_resident();
+        }
+
+        ResidentLevel level = take_level(level_index, source);
+        restore(level);
+        current_level = level_index;
+        assign_collider_ids();
+    }
+    reset();
 
-    // clear all vectors of current level prior to loading.
-    npcs.clear();
-    colliders.clear();
-    triggers.clear();
+    double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count();
+    std::cout << "loaded level: " << current_level << " (" << source << ", " << load_ms << " ms)\n\n";
+}
 
-    for (auto node : model.nodes)
+// quickest first: resident, part uploaded, read or being read by the streamer, then from disk on this thread.
+// whatever's left to upload is done now regardless of the budget, the level is needed this tick.
+ResidentLevel Level::take_level(int level_index, const char *&source)
+{
+    ResidentLevel level;
+    auto found = resident.find(level_index);
+    auto found_uploading = uploading.find(level_index);
+    if (found != resident.end())
     {
-        for (auto mesh : node->mesh_primitives)
-        {
-            MeshCollider *collider = new MeshCollider(mesh.vertex_collider_buffer);
-            // collider->is_trigger
+        level = std::move(found->second);
+        resident.erase(found);
+        source = "resident";
+    }
+    else if (found_uploading != uploading.end())
+    {
+        level = std::move(found_uploading->second);
+        uploading.erase(found_uploading);
+        source = "streamed";
+    }
+    else if (streamer.wait(level_index, level))
+    {
+        source = "streamed";
+    }
+    else
+    {
+        level.read(level_index);
+        source = "disk";
+    }
+
+    size_t budget = SIZE_MAX;
+    level.upload(budget);
+    return level;
+}
+
+// the contact cache is keyed on collider ids, so ids handed out in creation order would make a level's
+// warm starts (and so its results) depend on when it happened to be loaded. the cache is cleared on every
+// load, so every level can share the same range.
+void Level::assign_collider_ids()
+{
+    uint32_t id = LEVEL_COLLIDER_ID_BASE;
+    for (auto &collider : colliders)
+    {
+        id = ::assign_collider_ids(*collider, id);
+    }
+    for (auto &trigger : triggers)
+    {
+        id = ::assign_collider_ids(*trigger, id);
+    }
+}
 
-            collider->spawn         = mesh.spawn;
-            collider->target_level  = mesh.target_level;
-      
+// only the things that change while playing need putting back, the geometry and colliders never move.
+void Level::reset()
+{
+    for (Npc &npc : npcs)
+    {
+        npc.reset();
+    }
+    contact_cache.clear();
+}
+
+void Level::make_resident()
+{
+    resident.insert_or_assign(current_level, ResidentLevel{std::move(model), std::move(skybox), light_direction, std::move(colliders),
+                                                           std::move(triggers), std::move(npcs), std::move(collider_tree), std::move(trigger_tree)});
+}
+
+void Level::restore(ResidentLevel &level)
+{
+    model           = std::move(level.model);
+    skybox          = std::move(level.skybox);
+    light_direction = level.light_direction;
+    colliders       = std::move(level.colliders);
+    triggers        = std::move(level.triggers);
+    npcs            = std::move(level.npcs);
+    collider_tree   = std::move(level.collider_tree);
+    trigger_tree    = std::move(level.trigger_tree);
+}
+
+// runs on the streamer's thread, so nothing in here can touch gl.
+void ResidentLevel::read(int level_index)
+{
+    model.load("scene_" + std::to_string(level_index) + ".gltf");
+    const ModelData &scene = *model.data;
+
+    for (const Node &node : scene.nodes)
+    {
+        for (const MeshPrimitive &mesh : node.mesh_primitives)
+        {
+            // a baked mesh comes with its collider already built.
+            const BakedPrimitive *baked = (mesh.baked_index > -1) ? &scene.baked->get<BakedPrimitive>(BAKE_PRIMITIVES)[mesh.baked_index] : nullptr;
 
             switch (mesh.type)
             {
             case MeshPrimitive::Type::COLLIDER:
+            {
+                // level geometry is often concave, so collide with the actual triangles rather than the hull.
+                TriangleMeshCollider *collider = nullptr;
+                if (baked)
+                {
+                    collider = new TriangleMeshCollider(scene.baked->get<glm::vec3>(BAKE_TRIANGLES, baked->triangles),
+                                                        scene.baked->get<StaticBVHNode>(BAKE_BVH_NODES, baked->bvh_nodes),
+                                                        scene.baked->get<int>(BAKE_BVH_ITEMS, baked->bvh_items), baked->bounds);
+                }
+                else
+                {
+                    collider = new TriangleMeshCollider(scene.get_collider_vertices(mesh), scene.get_indices(mesh));
+                }
+                collider->spawn         = mesh.spawn;
+                collider->target_level  = mesh.target_level;
+
+                collider_tree.insert(collider->get_bounds(), static_cast<int>(colliders.size()));
                 colliders.push_back(std::move(std::unique_ptr<Collider>(collider)));
                 break;
-
+            }
             case MeshPrimitive::Type::TRIGGER:
+            {
+                // triggers only need to know if the player is inside the volume, the hull is fine for that.
+                MeshCollider *collider = nullptr;
+                if (baked)
+                {
+                    ConvexHull hull(scene.baked->get<glm::vec3>(BAKE_HULL_VERTICES, baked->hull_vertices),
+                                    scene.baked->get<uint32_t>(BAKE_HULL_OFFSETS, baked->hull_offsets),
+                                    scene.baked->get<uint32_t>(BAKE_HULL_ADJACENCY, baked->hull_adjacency));
+                    collider = new MeshCollider(scene.get_collider_vertices(mesh), std::move(hull), baked->bounds);
+                }
+                else
+                {
+                    collider = new MeshCollider(scene.get_collider_vertices(mesh));
+                }
+                collider->spawn         = mesh.spawn;
+                collider->target_level  = mesh.target_level;
+
+                trigger_tree.insert(collider->get_bounds(), static_cast<int>(triggers.size()));
                 triggers.push_back(std::move(std::unique_ptr<Collider>(collider)));
                 break;
+            }
             // case 2:
             //     // load light position and colour.
             //     // load skybox?
@@ -66,11 +197,120 @@ void Level::load(int level_index)
 
     // need to be able to load the skybox texture from the gltf i think.
     // also probably good to have some way to load it from a cubemap image not 6 seperate ones? dunno.
-    skybox = Skybox(level_index);
+    skybox.load(level_index);
+}
+
+bool ResidentLevel::upload(size_t &budget)
+{
+    bool uploaded = model.upload(budget) && skybox.upload(budget);
+    for (Npc &npc : npcs)
+    {
+        uploaded = npc.model.upload(budget) && uploaded;
+    }
+    return uploaded;
+}
+
+// models shared with another level (or the player) stay, see release_model.
+// the colliders and everything else go with the level itself.
+void ResidentLevel::release()
+{
+    model.release();
+    skybox.release();
+    for (Npc &npc : npcs)
+    {
+        npc.model.release();
+    }
+}
+
+// streamer functions.
+LevelStreamer::LevelStreamer()
+{
+    worker = std::thread(&LevelStreamer::run, this);
+}
+
+LevelStreamer::~LevelStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    requested.notify_one();
+    worker.join();
+}
+
+void LevelStreamer::request(int level_index)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if ((reading == level_index) || read_levels.count(level_index) || (std::find(queue.begin(), queue.end(), level_index) != queue.end()))
+        {
+            return;
+        }
+        queue.push_back(level_index);
+    }
+    requested.notify_one();
+}
+
+bool LevelStreamer::take(int &level_index, ResidentLevel &level)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (read_levels.empty())
+    {
+        return false;
+    }
+    auto first  = read_levels.begin();
+    level_index = first->first;
+    level       = std::move(first->second);
+    read_levels.erase(first);
+    return true;
+}
 
+bool LevelStreamer::wait(int level_index, ResidentLevel &level)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto queued = std::find(queue.begin(), queue.end(), level_index);
+    if (queued != queue.end())
+    {
+        // needed now, so it goes next.
+        queue.erase(queued);
+        queue.push_front(level_index);
+    }
+    else if ((reading != level_index) && !read_levels.count(level_index))
+    {
+        return false;
+    }
 
+    finished.wait(lock, [&] { return read_levels.count(level_index) > 0; });
+    auto found  = read_levels.find(level_index);
+    level       = std::move(found->second);
+    read_levels.erase(found);
+    return true;
+}
 
-    std::cout << "loaded level: " << current_level << "\n\n";
+void LevelStreamer::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        requested.wait(lock, [&] { return stopping || !queue.empty(); });
+        if (stopping)
+        {
+            return;
+        }
+        reading = queue.front();
+        queue.pop_front();
+
+        // the slow part, done without the lock so requests and takes don't wait on it.
+        lock.unlock();
+        ResidentLevel level;
+        level.read(reading);
+        lock.lock();
+
+        read_levels.insert_or_assign(reading, std::move(level));
+        reading = -1;
+        finished.notify_all();
+    }
 }
 
 void Level::update(int target_level)
@@ -81,14 +321,140 @@ void Level::update(int target_level)
     }
 }
 
-void Level::draw(Shader level_shader, Shader skybox_shader, Shader npc_shader, Shader line_shader, Camera camera)
+// asks the streamer for every level the current one's triggers lead to, so a transition finds it resident.
+// levels the streamer has finished reading are then uploaded, no more than budget bytes a frame so
+// uploads never hitch a frame. a level whose trigger is hit before it's done finishes in take_level.
+// only those neighbours are kept: when the current level changes every other level is released, so however
+// many levels have been visited, no more than the current one and its neighbours are loaded at once.
+void Level::stream(size_t budget)
 {
-    
-    model.draw(glm::vec3(0.0f), glm::quat(glm::vec3(0.0f)), glm::vec3(1.0f), level_shader, camera, glm::vec3(1.0f));
-    // model.draw(glm::vec3(0.0f), glm::quat(glm::vec3(0.0f)), glm::vec3(1.0f), line_shader, camera, glm::vec3(1.0f));
+    if (prefetched_level != current_level)
+    {
+        neighbours.clear();
+        for (auto &trigger : triggers)
+        {
+            int target = trigger->target_level;
+            if ((target == current_level) || is_neighbour(target))
+            {
+                continue;
+            }
+            neighbours.push_back(target);
+            if (!resident.count(target) && !uploading.count(target))
+            {
+                streamer.request(target);
+            }
+        }
+        evict(resident);
+        evict(uploading);
+        prefetched_level = current_level;
+    }
 
-    for (size_t i = 0; i < npcs.size(); ++i)
+    // a level asked for by an earlier current level can still turn up after it's been left.
+    int level_index;
+    ResidentLevel level;
+    while (streamer.take(level_index, level))
     {
-        npcs[i].draw(npc_shader, npc_shader, camera, false);
+        if (is_neighbour(level_index))
+        {
+            uploading.insert_or_assign(level_index, std::move(level));
+        }
+        else
+        {
+            level.release();
+        }
     }
+
+    for (auto it = uploading.begin(); (it != uploading.end()) && (budget > 0);)
+    {
+        if (it->second.upload(budget))
+        {
+            resident.insert_or_assign(it->first, std::move(it->second));
+            it = uploading.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+bool Level::is_neighbour(int level_index) const
+{
+    return std::find(neighbours.begin(), neighbours.end(), level_index) != neighbours.end();
+}
+
+void Level::evict(std::unordered_map<int, ResidentLevel> &levels)
+{
+    for (auto it = levels.begin(); it != levels.end();)
+    {
+        if (is_neighbour(it->first))
+        {
+            ++it;
+            continue;
+        }
+        std::cout << "released level: " << it->first << "\n";
+        it->second.release();
+        it = levels.erase(it);
+    }
+}
+
+// cast every ray against the level colliders, hits[i] gets the closest hit of rays[i].
+// one call for many rays (ground probes, camera occlusion, line of sight) shares the broad phase buffer.
+void Level::raycast(std::span<const Ray> rays, std::span<RayHit> hits, CollisionStats *stats)
+{
+    assert(hits.size() >= rays.size());
+
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        const Ray &ray = rays[i];
+        hits[i]        = RayHit();
+
+        ray_candidates.clear();
+        collider_tree.query_ray(ray.origin, ray.direction, ray.length, ray_candidates);
+        std::sort(ray_candidates.begin(), ray_candidates.end()); // equal distances go to the first collider.
+
+        for (int j : ray_candidates)
+        {
+            RayHit hit = raycast_collider(ray, &*colliders[j], stats);
+            if (hit.hit && (!hits[i].hit || (hit.distance < hits[i].distance)))
+            {
+                hits[i]             = hit;
+                hits[i].collider    = j;
+            }
+        }
+    }
+}
+
+RayHit Level::raycast(const Ray &ray, CollisionStats *stats)
+{
+    RayHit hit;
+    raycast(std::span<const Ray>(&ray, 1), std::span<RayHit>(&hit, 1), stats);
+    return hit;
+}
+
+void Level::prepare_draw(JointPalette &palette)
+{
+    palette.add(model);
+    for (Npc &npc : npcs)
+    {
+        palette.add(npc.model);
+    }
+
+    // npcs are instanced, their instances are uploaded once and drawn by every pass.
+    npc_renderer.clear();
+    for (const Npc &npc : npcs)
+    {
+        npc_renderer.add(npc.model, get_model_matrix(npc.position, npc.model_rotation, npc.scale), npc.colour);
+    }
+    npc_renderer.upload();
+}
+
+void Level::draw(RenderQueue &queue, Shader level_shader, Shader npc_shader)
+{
+    
+    model.draw(queue, glm::vec3(0.0f), glm::quat(glm::vec3(0.0f)), glm::vec3(1.0f), level_shader, glm::vec3(1.0f));
+    // model.draw(glm::vec3(0.0f), glm::quat(glm::vec3(0.0f)), glm::vec3(1.0f), line_shader, camera, glm::vec3(1.0f));
+
+    // npc_shader has to be an instanced one.
+    npc_renderer.draw(queue, npc_shader);
 }
\ No newline at end of file
@@ -9,20 +9,99 @@
 
 #include <memory>       // for collision array.
 #include <vector>
+#include <span>         // batched raycasts.
+#include <unordered_map>    // resident levels.
+#include <deque>        // streaming requests.
+#include <thread>       // streaming worker.
+#include <mutex>
+#include <condition_variable>
+
+#define STREAM_UPLOAD_BUDGET    (4 * 1024 * 1024)   // bytes a frame Level::stream gives to gl for levels loading in the background.
+#define LEVEL_COLLIDER_ID_BASE  0x40000000u         // the current level's colliders are numbered from here, well clear of next_collider_id().
+
+// everything loaded for a level that isn't the current one. kept resident so going back to it
+// (respawning, or a trigger back to a level already visited) doesn't touch the disk or re-upload to the gpu.
+// loading is split in two so the slow part can happen on another thread: read() does the file reads, parsing,
+// image decoding and collider building, upload() hands the result to gl on the main thread.
+struct ResidentLevel
+{
+    Model model;
+    Skybox skybox;
+    glm::vec3 light_direction;
+    std::vector<std::unique_ptr<Collider>> colliders;
+    std::vector<std::unique_ptr<Collider>> triggers;
+    std::vector<Npc> npcs;
+    BVH collider_tree;
+    BVH trigger_tree;
+
+    void read(int level_index);     // no gl, safe on any thread.
+    bool upload(size_t &budget);    // main thread only, true once everything's uploaded. see Model::upload.
+    void release();                 // main thread only, frees its gl side before it's dropped. see Model::release.
+};
+
+// reads levels on a background thread, one at a time in the order they were asked for.
+// finished levels still need uploading, Level::stream picks them up.
+struct LevelStreamer
+{
+    LevelStreamer();
+    ~LevelStreamer();
+    LevelStreamer(const LevelStreamer &) = delete;
+    LevelStreamer &operator=(const LevelStreamer &) = delete;
+
+    void request(int level_index);                      // queue a level, does nothing if it's already queued or read.
+    bool take(int &level_index, ResidentLevel &level);  // hands over any one level that's been read, false if none have.
+    bool wait(int level_index, ResidentLevel &level);   // blocks until a requested level is read. false if it was never requested.
+
+private:
+    std::mutex mutex;
+    std::condition_variable requested;  // wakes the worker.
+    std::condition_variable finished;   // wakes wait().
+    std::deque<int> queue;
+    int reading     = -1;               // level the worker is on, -1 when it's idle.
+    bool stopping   = false;
+    std::unordered_map<int, ResidentLevel> read_levels;
+    std::thread worker;                 // last, so it starts after everything above exists.
+
+    void run();
+};
 
 struct Level
 {
     Model model;                // level geometry is a single gltf rn.
     Skybox skybox;              // unique skybox per level.
     glm::vec3 light_direction;  // per-level lighting.
-    int current_level;          // store int of current level to prevent unnecessary loading.
+    int current_level = -1;     // store int of current level to prevent unnecessary loading.
+    std::unordered_map<int, ResidentLevel> resident;    // every other level loaded so far.
+    std::unordered_map<int, ResidentLevel> uploading;   // read by the streamer, part way through their uploads.
+    LevelStreamer streamer;
+    int prefetched_level = -1;  // current level the last time its neighbours were requested.
+    std::vector<int> neighbours;    // levels the current one's triggers lead to, the only ones kept resident.
 
     std::vector<std::unique_ptr<Collider>> colliders;   // vector array of colliders to test against player in update.
     std::vector<std::unique_ptr<Collider>> triggers;    // vector array of triggers in the level.
     std::vector<Npc> npcs;                              // npc array
+    InstancedRenderer npc_renderer;                     // npcs are drawn instanced, grouped by model and pose.
+
+    BVH collider_tree;          // broad phase over colliders, leaves store the index into colliders.
+    BVH trigger_tree;           // broad phase over triggers, leaves store the index into triggers.
+    ContactCache contact_cache; // gjk warm start data for player vs level pairs.
+    std::vector<int> ray_candidates;    // broad phase results for raycasts, kept so they don't reallocate.
 
     Level(int initial_level);
-    void load(int level_index);
+    void load(int level_index);     // make a level current, from memory if it's been loaded before. starts it over either way.
+    void reset();                   // put the current level back how it was when it was loaded.
     void update(int target_level);
-    void draw(Shader level_shader, Shader skybox_shader, Shader npc_shader, Shader line_shader, Camera camera);
+    void stream(size_t budget);     // once a frame on the main thread, see level.cpp.
+    void raycast(std::span<const Ray> rays, std::span<RayHit> hits, CollisionStats *stats = nullptr);
+    RayHit raycast(const Ray &ray, CollisionStats *stats = nullptr);
+    void prepare_draw(JointPalette &palette);   // once a frame before draw: joints and npc instances.
+    void draw(RenderQueue &queue, Shader level_shader, Shader npc_shader);
+
+private:
+    ResidentLevel take_level(int level_index, const char *&source);    // from wherever it's got to, uploaded.
+    void make_resident();                   // moves the current level into resident.
+    void restore(ResidentLevel &level);     // moves a resident level back in.
+    bool is_neighbour(int level_index) const;
+    void evict(std::unordered_map<int, ResidentLevel> &levels);    // releases every level in levels that isn't a neighbour.
+    void assign_collider_ids();
 };
\ No newline at end of file
@@ -7,6 +7,7 @@ version start date : 22 08 2022.
 #include <iostream>     // console printing.
 #include <array>        // shader array.
 #include <chrono>       // needed for timestep.
+#include <string>       // command line arguments.
 
 // audio related
 // audio stuff
@@ -30,6 +31,10 @@ version start date : 22 08 2022.
 #include "npc.hpp"          // npcs. (might factor some of this elsewhere).
 #include "level.hpp"        // handles level loading.
 #include "input.hpp"        // input handler (needs some work).
+#include "jobs.hpp"         // worker threads for the collision narrow phase.
+#include "simulation.hpp"   // fixed timestep update, shared with headless mode.
+#include "headless.hpp"     // --headless runs the update loop with no window.
+#include "replay.hpp"       // --record saves the input for replaying headless.
 
 
 
@@ -40,31 +45,28 @@ enum Mode
     EDIT
 };
 
+#define GL_STATS_FRAMES 120  // frames --gl-stats averages over.
+
 // global stuff.
 Mode mode   = Mode::GAME;
 bool debug  = false;
+std::array<PassStats, NUM_CASCADES + 1> pass_stats;    // frustum culling per pass, the cascades then the screen. for --gl-stats.
 
-void update(Player &player, Camera &camera, Level &level, AudioHandler &audio_scene, double dt)
+// add a pass's draws to its running totals.
+static void add_pass_stats(PassStats &totals, PassStats pass)
 {
-    // basically anything that moves needs the dt value:
-    // player position (xy movement, jumping).
-    // camera pitch and yaw.
-    // also all lerp values need dt as well? ig bcos they constitute the final term,
-    // but u dont want to * dt the entire value because that would get rid of the lerp i think?
-
-    for (size_t i = 0; i < level.npcs.size(); ++i)
-    {
-        level.npcs[i].update(dt);
-    }
-    camera.get_input(dt);                   // camera input, calculates camera orientation vec3.
-    player.update(dt, level, camera);       // player input and movement, sent a vector of colliders.
-    camera.update(player.camera_lookat);    // update camera matrix using target position.
-    audio_scene.update();
-    update_inputs();
+    totals.drawn    += pass.drawn;
+    totals.culled   += pass.culled;
 }
 
-void draw(Camera camera, ScreenTexture screen, std::array<Shader, SHADER_COUNT> shader, Player player, Level &level)
+void draw(Camera camera, ScreenTexture screen, std::array<Shader, SHADER_COUNT> shader, Player player, Level &level, JointPalette &joint_palette, RenderQueue &queue)
 {
+    // every model's joints and the npc instances go up once, for all the passes below.
+    joint_palette.clear();
+    joint_palette.add(player.model);
+    level.prepare_draw(joint_palette);
+    joint_palette.upload();
+
     // draw to shadowmaps.
     glViewport(0, 0, SHADOWMAP_SIZE, SHADOWMAP_SIZE);
     glPolygonOffset(6.0f, 1.0f); // factor, unit.
@@ -75,18 +77,27 @@ void draw(Camera camera, ScreenTexture screen, std::array<Shader, SHADER_COUNT>
     // the prob is that you need to call the draw functions inside this, and i dont want to have to pass the models to the camera etc.
     // but does it need to be inside the camera? maybe this should just be in the draw file, but then it's already got so much stuff...
     camera.get_cascades();
-    glUseProgram(shader[SHADER_SHADOWMAP].ID);
+
+    // the shadow casters are queued once and drawn to every cascade.
+    queue.clear();
+    player.draw(queue, shader[SHADER_SHADOWMAP], shader[SHADER_SHADOWMAP], camera, false);
+    level.draw(queue, shader[SHADER_SHADOWMAP], shader[SHADER_SHADOWMAP_INSTANCED]);
 
     // do for each cascade in the shadowmap array.
     for (int i = 0; i < NUM_CASCADES; ++i)
     {
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, camera.depth_maps[i], 0);
-        glUniformMatrix4fv(glGetUniformLocation(shader[SHADER_SHADOWMAP].ID, "light"), 1, GL_FALSE, glm::value_ptr(camera.cascade_proj[i]));
+
+        // both shadow shaders need the cascade's light matrix, set while each is current.
+        for (int shadow_shader : {SHADER_SHADOWMAP_INSTANCED, SHADER_SHADOWMAP})
+        {
+            shader[shadow_shader].use();
+            shader[shadow_shader].set(UNIFORM_LIGHT, camera.cascade_proj[i]);
+        }
         glClear(GL_DEPTH_BUFFER_BIT);
 
-        // render geometry to the current cascade.
-        player.draw(shader[SHADER_SHADOWMAP], shader[SHADER_SHADOWMAP], camera, false);
-        level.draw(shader[SHADER_SHADOWMAP], shader[SHADER_SKYBOX], shader[SHADER_SHADOWMAP], shader[SHADER_LINE], camera);
+        // render geometry to the current cascade, anything outside the light's box is culled.
+        add_pass_stats(pass_stats[i], queue.draw(camera, camera.cascade_proj[i]));
     }
 
     // draw to screen texture.
@@ -95,17 +106,35 @@ void draw(Camera camera, ScreenTexture screen, std::array<Shader, SHADER_COUNT>
     glBindFramebuffer(GL_FRAMEBUFFER, screen.screen_FBO);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    // draw scene to post-process framebuffer.
-    player.draw(shader[SHADER_CEL], shader[SHADER_LINE], camera, debug);
-    level.draw(shader[SHADER_DEFAULT], shader[SHADER_SKYBOX], shader[SHADER_CEL], shader[SHADER_LINE], camera);
-    level.skybox.draw(player.position, shader[SHADER_SKYBOX], camera);
+    // draw scene to post-process framebuffer. debug colliders are drawn straight away, the rest is queued.
+    queue.clear();
+    player.draw(queue, shader[SHADER_CEL], shader[SHADER_LINE], camera, debug);
+    level.draw(queue, shader[SHADER_DEFAULT], shader[SHADER_CEL_INSTANCED]);
+    level.skybox.draw(queue, player.position, shader[SHADER_SKYBOX], camera);
+    add_pass_stats(pass_stats[NUM_CASCADES], queue.draw(camera, camera.mvp));
     
     // finally, draw the screen framebuffer.
     screen.draw(shader[SHADER_FRAMEBUFFER], shader[SHADER_BLUR]);
 }
 
-int main(void)
+int main(int argc, char **argv)
 {
+    // no window, just simulate and report timings (see headless.hpp for options).
+    if ((argc > 1) && (std::string(argv[1]) == "--headless"))
+    {
+        return run_headless(argc, argv);
+    }
+
+    // --record path saves every tick's input, play it back with --headless --replay path.
+    std::string record_path;
+    if ((argc > 2) && (std::string(argv[1]) == "--record"))
+    {
+        record_path = argv[2];
+    }
+
+    // --gl-stats prints the gl calls made through shaders every GL_STATS_FRAMES frames.
+    bool print_gl_stats = (argc > 1) && (std::string(argv[1]) == "--gl-stats");
+
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);                  // state which version of OpenGL is in use,
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);                  // in this case version 3.3 (major 3, minor 3).
@@ -149,7 +178,9 @@ int main(void)
         Shader(GL_FILL, "cel.vert",         "cel.frag"),            // character model shader.
         Shader(GL_LINE, "default.vert",     "line.frag"),           // wireframe shader.
         Shader(GL_FILL, "skybox.vert",      "skybox.frag"),         // skybox shader.
-        Shader(GL_FILL, "blur.vert",        "blur.frag")            // blur shader.
+        Shader(GL_FILL, "blur.vert",        "blur.frag"),           // blur shader.
+        Shader(GL_FILL, "cel_instanced.vert",           "cel.frag"),        // character models drawn instanced (npcs).
+        Shader(GL_FILL, "shadow_map_instanced.vert",    "shadow_map.frag")  // shadowmap for instanced models.
     };
 
     // could prob organise this a bit better? tho i guess having some kind of 'game' class to create all of these is just redundant fluff.
@@ -158,7 +189,11 @@ int main(void)
     Camera camera;
     Level level(player.current_level);  // load initial level based on player's level.
     ScreenTexture screen;               // should this be in camera?
+    JointPalette joint_palette;         // skinning matrices, refilled every frame.
+    RenderQueue render_queue;           // reused by every pass.
     AudioHandler audio_scene;
+    JobSystem jobs;                     // one worker per spare hardware thread.
+    player.narrow_phase.jobs = &jobs;
 
     // fixed timestep setup. -- could get moved to a struct/something maybe.
     const double dt     = 1.0 / 60.0;   // base 60fps.
@@ -166,6 +201,8 @@ int main(void)
     double accumulator  = 0.0;          // only update game when > delta time.
     double global_speed = 1.0;          // controls global speed of the game.
     auto prev_time      = std::chrono::high_resolution_clock::now();
+    InputRecorder recorder(player.current_level, dt);
+    uint32_t frames     = 0;            // for --gl-stats.
 
     // main loop.
     while(!glfwWindowShouldClose(window))
@@ -184,15 +221,41 @@ int main(void)
         // update.
         for (; accumulator >= dt; accumulator -= dt)
         {
-            update(player, camera, level, audio_scene, dt);
+            if (!record_path.empty())
+            {
+                recorder.record(capture_input());
+            }
+            update_simulation(player, camera, level, dt);
+            if (!record_path.empty())
+            {
+                recorder.record_result(player.position);
+            }
+            audio_scene.update();
             // t += dt;
             
             
         }
 
-        
+        // background level loading, a few mb of gl uploads a frame.
+        level.stream(STREAM_UPLOAD_BUDGET);
+
         // draw.
-        draw(camera, screen, shader, player, level);    // always once per frame.
+        draw(camera, screen, shader, player, level, joint_palette, render_queue);    // always once per frame.
+        if (print_gl_stats && (++frames % GL_STATS_FRAMES == 0))
+        {
+            std::cout << "gl: " << (gl_call_stats.get_calls() / GL_STATS_FRAMES) << " calls a frame through shaders ("
+                      << (gl_call_stats.program_binds / GL_STATS_FRAMES) << " program binds, "
+                      << (gl_call_stats.uniform_uploads / GL_STATS_FRAMES) << " uniform uploads), "
+                      << (gl_call_stats.get_skipped() / GL_STATS_FRAMES) << " skipped as redundant\n";
+            gl_call_stats = GLCallStats();
+
+            for (size_t i = 0; i < pass_stats.size(); ++i)
+            {
+                std::cout << "    " << ((i < NUM_CASCADES) ? "cascade " + std::to_string(i) : std::string("screen")) << ": "
+                          << (pass_stats[i].drawn / GL_STATS_FRAMES) << " draws, " << (pass_stats[i].culled / GL_STATS_FRAMES) << " culled\n";
+                pass_stats[i] = PassStats();
+            }
+        }
 		glfwSwapBuffers(window);                        // swap the back buffer with the front buffer.
         glfwPollEvents();                               // poll IO events.
     }
@@ -202,6 +265,11 @@ int main(void)
 
 
     // on exit.
+    if (!record_path.empty())
+    {
+        recorder.save(record_path);
+    }
+
     // loop through all shaders and delete each one.
     for (size_t i = 0; i < shader.size(); ++i)
     {
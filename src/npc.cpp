@@ -2,10 +2,20 @@
 
 #include <iostream>
 
+// only loads the model, so npcs can be made off the main thread. the owner uploads it (see ResidentLevel::upload).
 Npc::Npc(std::string model_name, glm::vec3 position)
 {
     Npc::position   = position;
-    model           = Model(model_name);
+    spawn_position  = position;
+    model.load(model_name);
+}
+
+// back to how it was when it was created, without reloading the model.
+void Npc::reset()
+{
+    position            = spawn_position;
+    target_animation    = 0;
+    model.reset_pose();
 }
 
 void Npc::update(double dt)
@@ -17,7 +27,7 @@ void Npc::update(double dt)
 
 }
 
-void Npc::draw(Shader mesh_shader, Shader line_shader, Camera camera, bool draw_collider)
+void Npc::draw(RenderQueue &queue, Shader mesh_shader)
 {
-    model.draw(position, model_rotation, scale, mesh_shader, camera, colour);
+    model.draw(queue, position, model_rotation, scale, mesh_shader, colour);
 }
\ No newline at end of file
@@ -13,6 +13,7 @@ struct Npc
 
 
     glm::vec3 position          = glm::vec3(0.0f);
+    glm::vec3 spawn_position    = glm::vec3(0.0f);              // where reset() puts it back.
     glm::vec3 scale             = glm::vec3(1.0f);              // scale of player model.
     glm::vec3 colour            = glm::vec3(1.5f);              // ambient colour of player model, stand out while in shadow etc.
     glm::quat model_rotation    = glm::quat(glm::vec3(0.0f));   // rotation quaternion of model.
@@ -23,5 +24,6 @@ struct Npc
 
     Npc(std::string model_name, glm::vec3 position);
     void update(double dt);
-    void draw(Shader mesh_shader, Shader line_shader, Camera camera, bool draw_collider);
+    void reset();
+    void draw(RenderQueue &queue, Shader mesh_shader);  // levels draw their npcs instanced, see Level::draw.
 };
\ No newline at end of file
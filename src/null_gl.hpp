@@ -0,0 +1,6 @@
+#pragma once
+
+// loads every gl function pointer with a stub that does nothing and returns 0.
+// lets the game code (models, levels, shaders) run without a window or gl context,
+// eg. for benchmarks. must be called before anything touches gl.
+bool load_null_gl();
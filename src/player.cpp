@@ -3,6 +3,7 @@
 #include "utility.hpp"
 #include "input.hpp"
 #include <iostream>
+#include <algorithm>  // sorting broad phase results.
 
 using glm::vec2;
 using glm::vec3;
@@ -110,7 +111,7 @@ void Player::update(double dt, Level &level, Camera &camera)
     // you do the first movement, then after the collision is resolved etc, move from the new position *according to the ground angle at the point of the resolved collision*
 
     vec3 direction  = glm::normalize(rotate(glm::vec3(0.0f, 0.0f, 1.0f), angle_facing - glm::half_pi<float>(), up));
-    vec3 slope      = glm::normalize(get_slope(level.colliders));
+    vec3 slope      = glm::normalize(get_slope(level));
     vec3 horizontal = glm::normalize(glm::cross(direction, slope)) * movement_h;
     vec3 vertical   = (slope + vec3(0.0f, velocity_y, 0.0f)) * (float)dt;
 
@@ -155,9 +156,9 @@ void Player::update(double dt, Level &level, Camera &camera)
 }
 
 // draw player.
-void Player::draw(Shader mesh_shader, Shader line_shader, Camera camera, bool draw_collider)
+void Player::draw(RenderQueue &queue, Shader mesh_shader, Shader line_shader, Camera camera, bool draw_collider)
 {
-    model.draw(position, model_rotation, scale, mesh_shader, camera, colour);
+    model.draw(queue, position, model_rotation, scale, mesh_shader, colour);
     
     // option to draw colliders.
     if (draw_collider)
@@ -174,10 +175,13 @@ void Player::draw(Shader mesh_shader, Shader line_shader, Camera camera, bool dr
 // function cause might want to call from other files mb?? unsure.
 void Player::respawn(Level &level)
 {
-    // reload level.
+    // start the level over, it's kept in memory so this doesn't reload anything (see Level::load).
     std::cout << "respawn\n";
     level.load(current_level);
-    move(respawn_position - position, level);
+
+    // teleport rather than sweep there, then push out of anything at the spawn point.
+    position = respawn_position;
+    move(glm::vec3(0.0f), level);
 }
 
 void Player::jump()
@@ -192,31 +196,82 @@ void Player::jump()
 // move player in a direction, and calculate collision to adjust.
 void Player::move(glm::vec3 movement, Level &level)
 {
-    // first move the collider to the desired position.
-    collider[COLLIDER_MAIN].position = position + movement;
-    grounded = false;
-    
-    for (int i = 0; i < MAX_COLLISION_CHECKS; ++i)
+    // broad phase: the slides together are never longer than the movement, so a box grown by its length covers them all.
+    // the query is fattened so small push-outs stay inside it, and is only redone if they don't.
+    collider[COLLIDER_MAIN].position    = position;
+    AABB query_bounds                   = collider[COLLIDER_MAIN].get_bounds().fattened(glm::length(movement) + BVH_FAT_MARGIN);
+    collision_candidates.clear();
+    level.collider_tree.query(query_bounds, collision_candidates);
+    std::sort(collision_candidates.begin(), collision_candidates.end()); // keep the same order as the colliders array.
+
+    grounded            = false;
+    bool overlapping    = false;
+    vec3 remaining      = movement;
+
+    // sweep the collider along the movement and stop just short of the first surface it would touch,
+    // then slide the rest of the way along that surface. the collider is never moved into the level,
+    // so fast movement can't tunnel through it and there's nothing to push out of afterwards.
+    for (int i = 0; (i < MOVE_MAX_SLIDES) && !is_vec3_zero(remaining); ++i)
     {
-        int collision_count = 0;
-        for (size_t j = 0; j < level.colliders.size(); ++j)
+        Impact first;
+        for (const Impact &impact : narrow_phase.cast(&collider[COLLIDER_MAIN], remaining, level.colliders, collision_candidates, &collision_stats))
         {
-            Collision collision = is_collision(&collider[COLLIDER_MAIN], &*level.colliders[j]);
-            if (collision.collided)
+            if (impact.started_inside)
             {
-                // check if the collision is sufficiently below the player.
-                if (glm::angle(glm::normalize(collision.normal), up) > GROUND_MIN)
-                {
-                    // cout << glm::angle(glm::normalize(collision.normal), up) << "\n";
-                    grounded = true;
-                }
-
-                // move collider outside of collision, then increment count to check the new position.
-                collider[COLLIDER_MAIN].position -= (collision.normal * collision.depth);
-                collision_count++;
+                overlapping = true;
+            }
+            else if (impact.hit && (impact.time < first.time))
+            {
+                first = impact;
             }
         }
-        if (collision_count == 0)
+
+        if (!first.hit)
+        {
+            collider[COLLIDER_MAIN].position += remaining;
+            break;
+        }
+
+        // check if the collision is sufficiently below the player.
+        if (glm::angle(first.normal, up) > GROUND_MIN)
+        {
+            grounded = true;
+        }
+
+        // back off so the gap left along the normal is the skin width.
+        float approach  = glm::dot(remaining, first.normal);
+        float time      = (approach > 0.0f) ? glm::max(first.time - (MOVE_SKIN / approach), 0.0f) : first.time;
+        collider[COLLIDER_MAIN].position += remaining * time;
+
+        // whatever is left of the movement, minus the part going into the surface.
+        remaining *= (1.0f - time);
+        remaining -= first.normal * glm::dot(remaining, first.normal);
+    }
+
+    // started inside something (respawning, spawning), so fall back to pushing the collider out.
+    for (int i = 0; overlapping && (i < MAX_COLLISION_CHECKS); ++i)
+    {
+        // collider was pushed outside of the queried area, so get a new set of candidates.
+        if (!query_bounds.contains(collider[COLLIDER_MAIN].get_bounds()))
+        {
+            query_bounds = collider[COLLIDER_MAIN].get_bounds().fattened(BVH_FAT_MARGIN);
+            collision_candidates.clear();
+            level.collider_tree.query(query_bounds, collision_candidates);
+            std::sort(collision_candidates.begin(), collision_candidates.end());
+        }
+
+        // move collider outside of each collision, then check the new position.
+        const std::vector<Collision> &push_outs = narrow_phase.push_out(&collider[COLLIDER_MAIN], level.colliders, collision_candidates, &collision_stats, &level.contact_cache);
+        for (const Collision &collision : push_outs)
+        {
+            // check if the collision is sufficiently below the player.
+            if (glm::angle(glm::normalize(collision.normal), up) > GROUND_MIN)
+            {
+                // cout << glm::angle(glm::normalize(collision.normal), up) << "\n";
+                grounded = true;
+            }
+        }
+        if (push_outs.empty())
         {
             break;
         }
@@ -231,16 +286,20 @@ void Player::move(glm::vec3 movement, Level &level)
     bool trigger            = false;
     int trigger_function    = 1;
 
+    collision_candidates.clear();
+    level.trigger_tree.query(collider[COLLIDER_MAIN].get_bounds(), collision_candidates);
+    std::sort(collision_candidates.begin(), collision_candidates.end());
+
     for (int i = 0; i < MAX_COLLISION_CHECKS; ++i)
     {
         int collision_count = 0;
-        for (size_t j = 0; j < level.triggers.size(); ++j)
+        const std::vector<Collision> &collisions = narrow_phase.collide(&collider[COLLIDER_MAIN], level.triggers, collision_candidates, &collision_stats, &level.contact_cache);
+        for (size_t j = 0; j < collisions.size(); ++j)
         {
-            Collision collision = is_collision(&collider[COLLIDER_MAIN], &*level.triggers[j]);
-            if (collision.collided)
+            if (collisions[j].collided)
             {
-                current_level       = level.triggers[j]->target_level;
-                respawn_position    = level.triggers[j]->spawn;
+                current_level       = level.triggers[collision_candidates[j]]->target_level;
+                respawn_position    = level.triggers[collision_candidates[j]]->spawn;
                 trigger             = true;
                 collision_count++;
             }
@@ -271,33 +330,25 @@ void Player::move(glm::vec3 movement, Level &level)
     }
 }
 
-// this seems pretty solid atm, i don't think this is causing any issues with ground checks.
-// returns the angle of collider that is intersecting with the players ground check collider.
-glm::vec3 Player::get_slope(std::vector<std::unique_ptr<Collider>> &colliders)
+// returns the angle of the ground below the player, as the direction into it.
+// a ray down from the middle of the player is enough, the cylinder only says whether there is ground, not its angle.
+glm::vec3 Player::get_slope(Level &level)
 {
     // default value of the floor is vec3(0, -1, 0). -- could make a 'floor' vec3 const?
     glm::vec3 ground = -up;
     if (grounded)
     {
-        for (int i = 0; i < MAX_COLLISION_CHECKS; ++i)
+        // starts half way up so it is still above the ground if the player has sunk into it a little,
+        // and reaches RAY_DEPTH below the base, far enough to find the ground under the middle on a steep slope.
+        Ray ray;
+        ray.origin      = position + (up * (HEIGHT * 0.5f));
+        ray.direction   = -up;
+        ray.length      = (HEIGHT * 0.5f) + RAY_DEPTH;
+
+        RayHit hit = level.raycast(ray, &collision_stats);
+        if (hit.hit && (glm::angle(-hit.normal, up) > GROUND_MIN))
         {
-            int collision_count = 0;
-            for (size_t j = 0; j < colliders.size(); ++j)
-            {
-                Collision collision = is_collision(&collider[COLLIDER_GROUND], &*colliders[j]);
-                if (collision.collided)
-                {
-                    if (glm::angle(glm::normalize(collision.normal), up) > GROUND_MIN)
-                    {
-                        ground = collision.normal;
-                        collision_count++;
-                    }
-                }
-            }
-            if (collision_count == 0)
-            {
-                break;
-            }
+            ground = -hit.normal;
         }
     }
     return ground;
@@ -12,6 +12,8 @@
 #include "level.hpp"
 
 #define MAX_COLLISION_CHECKS    32
+#define MOVE_MAX_SLIDES         3       // sweeps per move, each one slides along the surface the last one hit.
+#define MOVE_SKIN               0.01f   // gap left between the player and surfaces, so the next sweep starts outside them.
 #define COLLIDER_COUNT          3
 
 #define ANIMATION_IDLE  0
@@ -94,11 +96,15 @@ struct Player
     bool jumping                = true;
     bool grounded               = false;
 
+    std::vector<int> collision_candidates;  // broad phase results, kept around so queries don't reallocate.
+    CollisionStats collision_stats;         // gjk/epa work done by this player's queries, never reset by the player.
+    NarrowPhase narrow_phase;               // runs the queries, set narrow_phase.jobs to spread them over a job system.
+
     Player(std::string model_name);
     void update(double dt, Level &level, Camera &camera);
     void move(glm::vec3 movement, Level &level);
     void respawn(Level &level);
     void jump();
-    glm::vec3 get_slope(std::vector<std::unique_ptr<Collider>> &colliders);
-    void draw(Shader mesh_shader, Shader line_shader, Camera camera, bool draw_collider);
+    glm::vec3 get_slope(Level &level);
+    void draw(RenderQueue &queue, Shader mesh_shader, Shader line_shader, Camera camera, bool draw_collider);
 };
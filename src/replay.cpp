@@ -0,0 +1,295 @@
+#include "replay.hpp"
+#include "input.hpp"    // the input globals.
+
+#include <fstream>      // reading/writing recordings.
+#include <cstring>      // std::memcpy.
+#include <iostream>
+
+// input functions.
+// axis order matches the change mask bits.
+static float *const input_axes[INPUT_AXIS_COUNT] =
+{
+    &AXIS_0_UP, &AXIS_0_DOWN, &AXIS_0_LEFT, &AXIS_0_RIGHT,
+    &AXIS_1_UP, &AXIS_1_DOWN, &AXIS_1_LEFT, &AXIS_1_RIGHT
+};
+
+static int *const input_buttons[INPUT_BUTTON_COUNT] =
+{
+    &INPUT_0, &INPUT_1, &INPUT_2, &INPUT_3, &SPACE_PRESSED
+};
+
+InputState capture_input()
+{
+    InputState state;
+    for (int i = 0; i < INPUT_AXIS_COUNT; ++i)
+    {
+        state.axes[i] = *input_axes[i];
+    }
+    for (int i = 0; i < INPUT_BUTTON_COUNT; ++i)
+    {
+        if (*input_buttons[i] != 0)
+        {
+            state.buttons |= (1u << i);
+        }
+    }
+    return state;
+}
+
+void apply_input(const InputState &state)
+{
+    for (int i = 0; i < INPUT_AXIS_COUNT; ++i)
+    {
+        *input_axes[i] = state.axes[i];
+    }
+    for (int i = 0; i < INPUT_BUTTON_COUNT; ++i)
+    {
+        *input_buttons[i] = (state.buttons >> i) & 1;
+    }
+}
+
+uint64_t hash_trajectory(uint64_t hash, glm::vec3 position)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &position[i], sizeof(bits));
+        for (int j = 0; j < 4; ++j)
+        {
+            hash = (hash ^ ((bits >> (j * 8)) & 0xff)) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+// stream helpers.
+static void write_bytes(std::vector<uint8_t> &stream, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    stream.insert(stream.end(), bytes, bytes + size);
+}
+
+// 7 bits at a time, high bit set on every byte but the last. gaps between input changes are
+// usually a few ticks, so this is nearly always a single byte.
+static void write_varint(std::vector<uint8_t> &stream, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        stream.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    stream.push_back(static_cast<uint8_t>(value));
+}
+
+static bool read_bytes(const std::vector<uint8_t> &stream, size_t &cursor, void *data, size_t size)
+{
+    if (cursor + size > stream.size())
+    {
+        return false;
+    }
+    std::memcpy(data, &stream[cursor], size);
+    cursor += size;
+    return true;
+}
+
+static bool read_varint(const std::vector<uint8_t> &stream, size_t &cursor, uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; (shift < 32) && (cursor < stream.size()); shift += 7)
+    {
+        uint8_t byte = stream[cursor];
+        cursor++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// recorder functions.
+void InputRecorder::record(const InputState &state)
+{
+    // compare bits rather than values, so -0.0f and 0.0f (which can give different results) are kept apart.
+    uint16_t mask = 0;
+    for (int i = 0; i < INPUT_AXIS_COUNT; ++i)
+    {
+        if (std::memcmp(&state.axes[i], &previous.axes[i], sizeof(float)) != 0)
+        {
+            mask |= (1u << i);
+        }
+    }
+    if (state.buttons != previous.buttons)
+    {
+        mask |= INPUT_BUTTONS_CHANGED;
+    }
+
+    if (mask)
+    {
+        write_varint(events, tick_count - last_event_tick);
+        write_bytes(events, &mask, sizeof(mask));
+        for (int i = 0; i < INPUT_AXIS_COUNT; ++i)
+        {
+            if (mask & (1u << i))
+            {
+                write_bytes(events, &state.axes[i], sizeof(float));
+            }
+        }
+        if (mask & INPUT_BUTTONS_CHANGED)
+        {
+            events.push_back(state.buttons);
+        }
+
+        previous        = state;
+        last_event_tick = tick_count;
+    }
+    tick_count++;
+}
+
+void InputRecorder::record_result(glm::vec3 position)
+{
+    hash = hash_trajectory(hash, position);
+    if ((tick_count % REPLAY_CHECKPOINT_TICKS) == 0)
+    {
+        checkpoints.push_back(hash);
+    }
+}
+
+// layout: magic, version, start level, dt, tick count, final hash, checkpoint count, checkpoints,
+// event byte count, events. numbers are written as they are in memory (little endian on every target we build for).
+bool InputRecorder::save(const std::string &path) const
+{
+    std::vector<uint8_t> file;
+    uint32_t magic              = REPLAY_MAGIC;
+    uint32_t version            = REPLAY_VERSION;
+    int32_t level               = start_level;
+    uint32_t checkpoint_count   = static_cast<uint32_t>(checkpoints.size());
+    uint32_t event_bytes        = static_cast<uint32_t>(events.size());
+
+    write_bytes(file, &magic,               sizeof(magic));
+    write_bytes(file, &version,             sizeof(version));
+    write_bytes(file, &level,               sizeof(level));
+    write_bytes(file, &dt,                  sizeof(dt));
+    write_bytes(file, &tick_count,          sizeof(tick_count));
+    write_bytes(file, &hash,                sizeof(hash));
+    write_bytes(file, &checkpoint_count,    sizeof(checkpoint_count));
+    write_bytes(file, checkpoints.data(),   checkpoints.size() * sizeof(uint64_t));
+    write_bytes(file, &event_bytes,         sizeof(event_bytes));
+    write_bytes(file, events.data(),        events.size());
+
+    std::ofstream stream(path, std::ios::binary);
+    stream.write(reinterpret_cast<const char *>(file.data()), file.size());
+    if (!stream)
+    {
+        std::cout << "failed to save replay: " << path << "\n";
+        return false;
+    }
+    std::cout << "saved replay: " << path << " (" << tick_count << " ticks, " << file.size() << " bytes)\n";
+    return true;
+}
+
+// replay functions.
+bool InputReplay::load(const std::string &path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    size_t read                 = 0;
+    uint32_t magic              = 0;
+    uint32_t version            = 0;
+    int32_t level               = 0;
+    uint32_t checkpoint_count   = 0;
+    uint32_t event_bytes        = 0;
+
+    bool valid = read_bytes(file, read, &magic, sizeof(magic)) && (magic == REPLAY_MAGIC) &&
+                 read_bytes(file, read, &version, sizeof(version)) && (version == REPLAY_VERSION) &&
+                 read_bytes(file, read, &level, sizeof(level)) &&
+                 read_bytes(file, read, &dt, sizeof(dt)) &&
+                 read_bytes(file, read, &tick_count, sizeof(tick_count)) &&
+                 read_bytes(file, read, &recorded_hash, sizeof(recorded_hash)) &&
+                 read_bytes(file, read, &checkpoint_count, sizeof(checkpoint_count)) &&
+                 (checkpoint_count == tick_count / REPLAY_CHECKPOINT_TICKS);
+    if (valid)
+    {
+        checkpoints.resize(checkpoint_count);
+        valid = read_bytes(file, read, checkpoints.data(), checkpoint_count * sizeof(uint64_t)) &&
+                read_bytes(file, read, &event_bytes, sizeof(event_bytes)) &&
+                (read + event_bytes == file.size());
+    }
+    if (!valid)
+    {
+        std::cout << "failed to load replay: " << path << "\n";
+        return false;
+    }
+
+    start_level = level;
+    events.assign(file.begin() + read, file.end());
+    cursor          = 0;
+    tick            = 0;
+    next_event_tick = 0;
+    hash            = REPLAY_HASH_SEED;
+    desync_tick     = -1;
+    state           = InputState();
+    read_event_tick();
+    return true;
+}
+
+InputState InputReplay::next()
+{
+    if (has_event && (tick == next_event_tick))
+    {
+        uint16_t mask = 0;
+        bool valid = read_bytes(events, cursor, &mask, sizeof(mask));
+        for (int i = 0; valid && (i < INPUT_AXIS_COUNT); ++i)
+        {
+            if (mask & (1u << i))
+            {
+                valid = read_bytes(events, cursor, &state.axes[i], sizeof(float));
+            }
+        }
+        if (valid && (mask & INPUT_BUTTONS_CHANGED))
+        {
+            valid = read_bytes(events, cursor, &state.buttons, sizeof(state.buttons));
+        }
+
+        if (valid)
+        {
+            read_event_tick();
+        }
+        else
+        {
+            // truncated, keep the last input for the rest of the replay.
+            has_event = false;
+        }
+    }
+    tick++;
+    return state;
+}
+
+void InputReplay::check_result(glm::vec3 position)
+{
+    hash = hash_trajectory(hash, position);
+
+    bool matches = true;
+    if ((tick % REPLAY_CHECKPOINT_TICKS) == 0)
+    {
+        matches = (hash == checkpoints[tick / REPLAY_CHECKPOINT_TICKS - 1]);
+    }
+    else if (tick == tick_count)
+    {
+        matches = (hash == recorded_hash);
+    }
+
+    // the tick that failed could be anywhere since the previous checkpoint.
+    if (!matches && (desync_tick < 0))
+    {
+        desync_tick = static_cast<int>(tick);
+    }
+}
+
+void InputReplay::read_event_tick()
+{
+    uint32_t delta = 0;
+    has_event = (cursor < events.size()) && read_varint(events, cursor, delta);
+    next_event_tick += delta;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>        // input axes.
+#include <vector>       // encoded stream.
+#include <string>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#define REPLAY_MAGIC                0x314c5052u             // "RPL1" in a little endian file.
+#define REPLAY_VERSION              1
+#define REPLAY_CHECKPOINT_TICKS     60                      // ticks between trajectory hashes, how closely a desync is located.
+#define REPLAY_HASH_SEED            14695981039346656037ull // fnv-1a offset basis.
+
+#define INPUT_AXIS_COUNT            8                       // AXIS_0_* then AXIS_1_*, in up/down/left/right order.
+#define INPUT_BUTTON_COUNT          5                       // INPUT_0..3 then SPACE_PRESSED.
+#define INPUT_BUTTONS_CHANGED       (1u << INPUT_AXIS_COUNT) // change mask bit for the buttons byte.
+
+// everything from input.hpp that the update reads, sampled at the start of a tick.
+// the _PREV values aren't stored as update_inputs() derives them from these at the end of every tick.
+struct InputState
+{
+    std::array<float, INPUT_AXIS_COUNT> axes = {};
+    uint8_t buttons = 0;    // bit i set = button i held.
+
+    bool operator==(const InputState &other) const { return (axes == other.axes) && (buttons == other.buttons); }
+};
+
+// copy the input globals to/from a state.
+InputState capture_input();
+void apply_input(const InputState &state);
+
+// fold the player position into a running trajectory hash (fnv-1a over the float bits).
+// two runs only end with the same hash if every position was bit identical.
+uint64_t hash_trajectory(uint64_t hash, glm::vec3 position);
+
+// records the input for every tick of a run into a compact binary stream.
+// a tick only costs anything if the input changed since the previous tick: a varint of ticks since
+// the last change, a 16 bit mask of what changed, then the new value of each changed axis (raw float bits,
+// so analog input replays exactly) and one byte for the buttons if any changed.
+// the trajectory hash is stored every REPLAY_CHECKPOINT_TICKS so a replay can tell where it went wrong.
+struct InputRecorder
+{
+    std::vector<uint8_t> events;
+    std::vector<uint64_t> checkpoints;
+    InputState previous;                // all zero to start with, same as the globals.
+    uint32_t tick_count         = 0;
+    uint32_t last_event_tick    = 0;
+    uint64_t hash               = REPLAY_HASH_SEED;
+    int start_level             = 0;
+    double dt                   = 0.0;
+
+    InputRecorder(int start_level, double dt) : start_level(start_level), dt(dt) {}
+    void record(const InputState &state);       // before a tick's update.
+    void record_result(glm::vec3 position);     // after a tick's update.
+    bool save(const std::string &path) const;
+};
+
+// plays a recording back one tick at a time and checks the result against the recorded trajectory.
+struct InputReplay
+{
+    std::vector<uint8_t> events;
+    std::vector<uint64_t> checkpoints;
+    InputState state;
+    size_t cursor               = 0;    // next unread byte of events.
+    uint32_t tick_count         = 0;
+    uint32_t tick               = 0;    // ticks played so far.
+    uint32_t next_event_tick    = 0;
+    bool has_event              = false;
+    uint64_t hash               = REPLAY_HASH_SEED;
+    uint64_t recorded_hash      = 0;    // trajectory hash at the end of the recording.
+    int desync_tick             = -1;   // first checkpoint that didn't match, -1 while it still matches.
+    int start_level             = 0;
+    double dt                   = 0.0;
+
+    bool load(const std::string &path);
+    bool is_finished() const { return tick >= tick_count; }
+    InputState next();                          // input for the next tick.
+    void check_result(glm::vec3 position);      // after the tick, compares with the recording.
+
+private:
+    void read_event_tick();
+};
@@ -0,0 +1,56 @@
+#include "resource.hpp"
+#include "draw.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+static std::mutex registry_mutex;
+static std::unordered_map<std::string, std::weak_ptr<ModelData>> registry;
+
+std::shared_ptr<ModelData> acquire_model(const std::string &filename)
+{
+    std::shared_ptr<ModelData> data;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        std::weak_ptr<ModelData> &entry = registry[filename];
+        data = entry.lock();
+        if (!data)
+        {
+            data    = std::make_shared<ModelData>();
+            entry   = data;
+        }
+    }
+
+    // loaded outside the registry lock so other files aren't held up, anyone else after this file waits here.
+    std::call_once(data->load_once, [&] { data->load(filename); });
+    return data;
+}
+
+void release_model(std::shared_ptr<ModelData> &data)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (data && (data.use_count() == 1))
+    {
+        data->release();
+    }
+    data.reset();
+}
+
+size_t get_model_count()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    size_t count = 0;
+    for (auto it = registry.begin(); it != registry.end();)
+    {
+        if (it->second.expired())
+        {
+            it = registry.erase(it);
+        }
+        else
+        {
+            count++;
+            ++it;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <memory>       // shared model data.
+#include <string>
+
+struct ModelData;
+
+// shared model data by filename. every Model of the same file holds the same ModelData, so its meshes, textures,
+// skins and animations are loaded and uploaded once however many instances there are. the registry only keeps
+// a weak reference: the data goes when the last model using it does, and is loaded again if it's asked for after.
+// safe to call from any thread. a model being loaded on one thread is waited for by the others rather than loaded twice.
+std::shared_ptr<ModelData> acquire_model(const std::string &filename);
+
+// drops a model's reference to its data, and if it was the last one frees the data's gl buffers and textures too.
+// main thread only. holds the registry lock so no other thread can pick the data up from the registry in between.
+void release_model(std::shared_ptr<ModelData> &data);
+
+// files with data still alive, ie. how many models have actually been loaded.
+size_t get_model_count();
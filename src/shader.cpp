@@ -2,7 +2,19 @@
 #include "utility.hpp"  // get_file_contents() function.
 #include <iostream>     // std::cout.
 #include <cerrno>       // error checking.
-#include <cstring>      // for error compile.
+#include <cstring>      // for error compile, comparing uniform values.
+
+GLCallStats gl_call_stats;
+
+// names of the UNIFORM_ defines, in the same order.
+static const char *uniform_names[UNIFORM_COUNT] = {
+    "mvp", "view", "light", "light_pos", "albedo", "camera_distance", "cascade_bounds", "shadow_map", "tex0",
+    "node_matrix", "joint_palette", "joint_offset", "screen_texture", "bloom", "gamma", "horizontal",
+    "x_pos", "y_pos", "scale", "window_width", "window_height", "img_width", "img_height"
+};
+
+// the program in use, so use() can skip binding it again. everything binds programs through Shader.
+static GLuint current_program = 0;
 
 Shader::Shader(const GLenum mode, std::string vert_file, std::string frag_file)
 {
@@ -40,6 +52,35 @@ Shader::Shader(const GLenum mode, std::string vert_file, std::string frag_file)
     glDeleteShader(vert_shader);
     glDeleteShader(frag_shader);
 
+    // look up every uniform the program has once. gl names arrays by their first element, eg. "light[0]".
+    state = std::make_shared<ShaderState>();
+    state->locations.fill(-1);
+    state->sizes.fill(0);
+
+    GLint active_uniforms = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &active_uniforms);
+    for (GLint i = 0; i < active_uniforms; ++i)
+    {
+        char name[256];
+        GLint size      = 0;
+        GLenum type     = 0;
+        glGetActiveUniform(ID, static_cast<GLuint>(i), sizeof(name), nullptr, &size, &type, name);
+        if (char *bracket = std::strchr(name, '['))
+        {
+            *bracket = '\0';
+        }
+
+        for (int uniform = 0; uniform < UNIFORM_COUNT; ++uniform)
+        {
+            if (std::strcmp(name, uniform_names[uniform]) == 0)
+            {
+                state->locations[uniform]   = glGetUniformLocation(ID, name);
+                state->sizes[uniform]       = size;
+                ++gl_call_stats.location_lookups;
+            }
+        }
+    }
+
     // std::cout << "shader ID: " << vert_file << " "<< ID << "\n";
 }
 
@@ -75,4 +116,89 @@ void Shader::compile_errors(unsigned int shader, const char* type)
             std::cout << "shader linked: " << type << "\n\n";
         }
     }
-}
\ No newline at end of file
+}
+
+void Shader::use()
+{
+    if (current_program == ID)
+    {
+        ++gl_call_stats.skipped_binds;
+        return;
+    }
+    glUseProgram(ID);
+    current_program = ID;
+    ++gl_call_stats.program_binds;
+}
+
+// true if the uniform needs uploading, and remembers the value if so.
+// uniforms belong to the program, so the value stays set even while other programs are in use.
+// an array longer than the shader's is skipped too (eg. every cascade's light matrix to a shadow shader, which has one).
+bool Shader::changed(int uniform, const void *value, size_t size, size_t count)
+{
+    std::vector<uint8_t> &last = state->values[uniform];
+    if ((state->locations[uniform] == -1) || (count > static_cast<size_t>(state->sizes[uniform])) ||
+        ((last.size() == size) && (std::memcmp(last.data(), value, size) == 0)))
+    {
+        ++gl_call_stats.skipped_uploads;
+        return false;
+    }
+    last.assign(static_cast<const uint8_t *>(value), static_cast<const uint8_t *>(value) + size);
+    ++gl_call_stats.uniform_uploads;
+    return true;
+}
+
+void Shader::set(int uniform, int value)
+{
+    if (changed(uniform, &value, sizeof(value), 1))
+    {
+        glUniform1i(state->locations[uniform], value);
+    }
+}
+
+void Shader::set(int uniform, float value)
+{
+    if (changed(uniform, &value, sizeof(value), 1))
+    {
+        glUniform1f(state->locations[uniform], value);
+    }
+}
+
+void Shader::set(int uniform, const glm::vec3 &value)
+{
+    if (changed(uniform, &value, sizeof(value), 1))
+    {
+        glUniform3fv(state->locations[uniform], 1, &value[0]);
+    }
+}
+
+void Shader::set(int uniform, const glm::mat4 &value)
+{
+    if (changed(uniform, &value, sizeof(value), 1))
+    {
+        glUniformMatrix4fv(state->locations[uniform], 1, GL_FALSE, &value[0][0]);
+    }
+}
+
+void Shader::set(int uniform, std::span<const int> values)
+{
+    if (changed(uniform, values.data(), values.size_bytes(), values.size()))
+    {
+        glUniform1iv(state->locations[uniform], static_cast<GLsizei>(values.size()), values.data());
+    }
+}
+
+void Shader::set(int uniform, std::span<const float> values)
+{
+    if (changed(uniform, values.data(), values.size_bytes(), values.size()))
+    {
+        glUniform1fv(state->locations[uniform], static_cast<GLsizei>(values.size()), values.data());
+    }
+}
+
+void Shader::set(int uniform, std::span<const glm::mat4> values)
+{
+    if (changed(uniform, values.data(), values.size_bytes(), values.size()))
+    {
+        glUniformMatrix4fv(state->locations[uniform], static_cast<GLsizei>(values.size()), GL_FALSE, &values[0][0][0]);
+    }
+}
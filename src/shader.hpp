@@ -2,15 +2,85 @@
 
 #include <glad.h>   // ID and mode type.
 #include <string>   // load vert and frag as string.
+#include <array>
+#include <vector>
+#include <span>     // uniform arrays.
+#include <memory>   // state shared by copies of a shader.
+#include <cstdint>
+#include <glm/glm.hpp>
 
 #define SHADER_PATH "./assets/shaders/"
 
+// uniforms a shader looks up once when it's linked. set them with Shader::set by these, not by name.
+// a shader without one of them just ignores it.
+#define UNIFORM_MVP             0
+#define UNIFORM_VIEW            1
+#define UNIFORM_LIGHT           2   // a single matrix in the shadow shaders, one per cascade in the rest.
+#define UNIFORM_LIGHT_POS       3
+#define UNIFORM_ALBEDO          4
+#define UNIFORM_CAMERA_DISTANCE 5
+#define UNIFORM_CASCADE_BOUNDS  6
+#define UNIFORM_SHADOW_MAP      7
+#define UNIFORM_TEX0            8
+#define UNIFORM_NODE_MATRIX     9
+#define UNIFORM_JOINT_PALETTE   10
+#define UNIFORM_JOINT_OFFSET    11
+#define UNIFORM_SCREEN_TEXTURE  12
+#define UNIFORM_BLOOM           13
+#define UNIFORM_GAMMA           14
+#define UNIFORM_HORIZONTAL      15
+#define UNIFORM_X_POS           16
+#define UNIFORM_Y_POS           17
+#define UNIFORM_SCALE           18
+#define UNIFORM_WINDOW_WIDTH    19
+#define UNIFORM_WINDOW_HEIGHT   20
+#define UNIFORM_IMG_WIDTH       21
+#define UNIFORM_IMG_HEIGHT      22
+#define UNIFORM_COUNT           23
+
+// gl calls made through Shader since the last reset, the game prints them every so often with --gl-stats.
+struct GLCallStats
+{
+    uint32_t program_binds      = 0;    // glUseProgram.
+    uint32_t uniform_uploads    = 0;    // glUniform*.
+    uint32_t skipped_binds      = 0;    // the program was already in use.
+    uint32_t skipped_uploads    = 0;    // the uniform already had the value, or the shader doesn't have it.
+    uint32_t location_lookups   = 0;    // glGetUniformLocation, only when a shader is linked.
+
+    uint32_t get_calls() const { return program_binds + uniform_uploads + location_lookups; }
+    uint32_t get_skipped() const { return skipped_binds + skipped_uploads; }
+};
+
+extern GLCallStats gl_call_stats;
+
+// what a linked program has: its uniform locations and the last value uploaded to each.
+// shaders are passed around by value, so every copy points at the same one.
+struct ShaderState
+{
+    std::array<GLint, UNIFORM_COUNT> locations;                 // -1 if the program doesn't have it.
+    std::array<GLint, UNIFORM_COUNT> sizes;                     // array length, 1 if it isn't one.
+    std::array<std::vector<uint8_t>, UNIFORM_COUNT> values;    // empty until it's first set.
+};
+
 class Shader
 {
     public:
         GLuint ID;
         GLenum mode;
         Shader(GLenum mode, std::string vert_file, std::string frag_file);
+
+        // use() before setting anything, setters only upload when the value changes.
+        void use();
+        bool has(int uniform) const { return state->locations[uniform] != -1; }
+        void set(int uniform, int value);
+        void set(int uniform, float value);
+        void set(int uniform, const glm::vec3 &value);
+        void set(int uniform, const glm::mat4 &value);
+        void set(int uniform, std::span<const int> values);
+        void set(int uniform, std::span<const float> values);
+        void set(int uniform, std::span<const glm::mat4> values);
     private:
+        std::shared_ptr<ShaderState> state;
         void compile_errors(unsigned int shader, const char* type);
-};
\ No newline at end of file
+        bool changed(int uniform, const void *value, size_t size, size_t count);
+};
@@ -0,0 +1,199 @@
+#include "simd.hpp"
+#include <cfloat>       // FLT_MAX.
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>  // sse/avx intrinsics.
+#define SIMD_X86
+#endif
+
+// pick the best kernel the cpu supports once at startup.
+static SimdLevel detect_simd_level()
+{
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        return SimdLevel::SSE4;
+    }
+#endif
+    return SimdLevel::SCALAR;
+}
+
+static SimdLevel simd_level = detect_simd_level();
+
+SimdLevel get_simd_level()
+{
+    return simd_level;
+}
+
+void set_simd_level(SimdLevel level)
+{
+    simd_level = level;
+}
+
+const char *simd_level_name(SimdLevel level)
+{
+    switch (level)
+    {
+        case SimdLevel::AVX2:   return "avx2";
+        case SimdLevel::SSE4:   return "sse4";
+        default:                return "scalar";
+    }
+}
+
+void VertexSoA::assign(std::span<const glm::vec3> vertices)
+{
+    count           = vertices.size();
+    size_t padded   = ((count + SIMD_WIDTH - 1) / SIMD_WIDTH) * SIMD_WIDTH;
+    glm::vec3 pad   = vertices.empty() ? glm::vec3(0.0f) : vertices[0];
+
+    x.assign(padded, pad.x);
+    y.assign(padded, pad.y);
+    z.assign(padded, pad.z);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        x[i] = vertices[i].x;
+        y[i] = vertices[i].y;
+        z[i] = vertices[i].z;
+    }
+}
+
+size_t max_dot_index(const VertexSoA &vertices, glm::vec3 direction)
+{
+    switch (simd_level)
+    {
+        case SimdLevel::AVX2:   return max_dot_index_avx2(vertices, direction);
+        case SimdLevel::SSE4:   return max_dot_index_sse4(vertices, direction);
+        default:                return max_dot_index_scalar(vertices, direction);
+    }
+}
+
+// dot products are always summed as (x + y) + z so every kernel rounds the same way.
+size_t max_dot_index_scalar(const VertexSoA &vertices, glm::vec3 direction)
+{
+    size_t best_index   = 0;
+    float best          = -FLT_MAX;
+
+    for (size_t i = 0; i < vertices.count; ++i)
+    {
+        float distance = (vertices.x[i] * direction.x + vertices.y[i] * direction.y) + vertices.z[i] * direction.z;
+        if (distance > best)
+        {
+            best        = distance;
+            best_index  = i;
+        }
+    }
+    return best_index;
+}
+
+#ifdef SIMD_X86
+
+// reduce the per-lane winners to one index, lowest index wins ties to match the scalar scan.
+static size_t reduce_lanes(const float *values, const int32_t *indices, int lanes)
+{
+    int best = 0;
+    for (int i = 1; i < lanes; ++i)
+    {
+        if ((values[i] > values[best]) || ((values[i] == values[best]) && (indices[i] < indices[best])))
+        {
+            best = i;
+        }
+    }
+    return static_cast<size_t>(indices[best]);
+}
+
+// 4 vertices per iteration. each lane keeps its own max and index, only replaced when strictly greater.
+__attribute__((target("sse4.1")))
+size_t max_dot_index_sse4(const VertexSoA &vertices, glm::vec3 direction)
+{
+    if (vertices.count == 0)
+    {
+        return 0;
+    }
+
+    const __m128 dx     = _mm_set1_ps(direction.x);
+    const __m128 dy     = _mm_set1_ps(direction.y);
+    const __m128 dz     = _mm_set1_ps(direction.z);
+    const __m128i step  = _mm_set1_epi32(4);
+    __m128 best         = _mm_set1_ps(-FLT_MAX);
+    __m128i best_index  = _mm_setzero_si128();
+    __m128i index       = _mm_setr_epi32(0, 1, 2, 3);
+
+    for (size_t i = 0; i < vertices.x.size(); i += 4)
+    {
+        __m128 x        = _mm_loadu_ps(&vertices.x[i]);
+        __m128 y        = _mm_loadu_ps(&vertices.y[i]);
+        __m128 z        = _mm_loadu_ps(&vertices.z[i]);
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, dx), _mm_mul_ps(y, dy)), _mm_mul_ps(z, dz));
+        __m128 greater  = _mm_cmpgt_ps(distance, best);
+
+        best            = _mm_blendv_ps(best, distance, greater);
+        best_index      = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(best_index), _mm_castsi128_ps(index), greater));
+        index           = _mm_add_epi32(index, step);
+    }
+
+    alignas(16) float values[4];
+    alignas(16) int32_t indices[4];
+    _mm_store_ps(values, best);
+    _mm_store_si128(reinterpret_cast<__m128i *>(indices), best_index);
+    return reduce_lanes(values, indices, 4);
+}
+
+// same as the sse version with 8 lanes.
+__attribute__((target("avx2")))
+size_t max_dot_index_avx2(const VertexSoA &vertices, glm::vec3 direction)
+{
+    if (vertices.count == 0)
+    {
+        return 0;
+    }
+
+    const __m256 dx     = _mm256_set1_ps(direction.x);
+    const __m256 dy     = _mm256_set1_ps(direction.y);
+    const __m256 dz     = _mm256_set1_ps(direction.z);
+    const __m256i step  = _mm256_set1_epi32(8);
+    __m256 best         = _mm256_set1_ps(-FLT_MAX);
+    __m256i best_index  = _mm256_setzero_si256();
+    __m256i index       = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (size_t i = 0; i < vertices.x.size(); i += 8)
+    {
+        __m256 x        = _mm256_loadu_ps(&vertices.x[i]);
+        __m256 y        = _mm256_loadu_ps(&vertices.y[i]);
+        __m256 z        = _mm256_loadu_ps(&vertices.z[i]);
+        __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, dx), _mm256_mul_ps(y, dy)), _mm256_mul_ps(z, dz));
+        __m256 greater  = _mm256_cmp_ps(distance, best, _CMP_GT_OQ);
+
+        best            = _mm256_blendv_ps(best, distance, greater);
+        best_index      = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(best_index), _mm256_castsi256_ps(index), greater));
+        index           = _mm256_add_epi32(index, step);
+    }
+
+    alignas(32) float values[8];
+    alignas(32) int32_t indices[8];
+    _mm256_store_ps(values, best);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(indices), best_index);
+    _mm256_zeroupper();     // clear the upper halves before going back to sse code, or every sse instruction after pays for the transition.
+    return reduce_lanes(values, indices, 8);
+}
+
+#else
+
+// non-x86 builds only have the scalar kernel.
+size_t max_dot_index_sse4(const VertexSoA &vertices, glm::vec3 direction)
+{
+    return max_dot_index_scalar(vertices, direction);
+}
+
+size_t max_dot_index_avx2(const VertexSoA &vertices, glm::vec3 direction)
+{
+    return max_dot_index_scalar(vertices, direction);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>       // vertex streams.
+#include <span>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#define SIMD_WIDTH 8    // streams are padded to the widest kernel (avx2, 8 floats).
+
+// instruction set used by the support kernels, picked at startup from the cpu features.
+enum class SimdLevel
+{
+    SCALAR,
+    SSE4,
+    AVX2
+};
+
+// structure of arrays vertex layout, so a simd register can hold the same component of several vertices.
+// padding copies the first vertex, which can never beat it in the argmax as ties go to the lowest index.
+struct VertexSoA
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    size_t count = 0;       // number of real vertices, arrays are padded up to a multiple of SIMD_WIDTH.
+
+    void assign(std::span<const glm::vec3> vertices);
+    glm::vec3 get(size_t index) const { return glm::vec3(x[index], y[index], z[index]); }
+};
+
+// detected level, and override for benchmarking the individual kernels.
+SimdLevel get_simd_level();
+void set_simd_level(SimdLevel level);
+const char *simd_level_name(SimdLevel level);
+
+// index of the vertex with the largest dot product with direction, ties resolve to the lowest index.
+// every kernel returns the same index for the same input.
+size_t max_dot_index(const VertexSoA &vertices, glm::vec3 direction);
+size_t max_dot_index_scalar(const VertexSoA &vertices, glm::vec3 direction);
+size_t max_dot_index_sse4(const VertexSoA &vertices, glm::vec3 direction);
+size_t max_dot_index_avx2(const VertexSoA &vertices, glm::vec3 direction);
@@ -0,0 +1,70 @@
+#include "simulation.hpp"
+#include "input.hpp"    // update_inputs().
+
+using clock_type = std::chrono::steady_clock;
+
+const char *SimulationProfile::get_name(int subsystem)
+{
+    switch (subsystem)
+    {
+    case SUBSYSTEM_NPC:     return "npc";
+    case SUBSYSTEM_CAMERA:  return "camera";
+    case SUBSYSTEM_PLAYER:  return "player";
+    case SUBSYSTEM_INPUT:   return "input";
+    default:                return "unknown";
+    }
+}
+
+double SimulationProfile::get_total() const
+{
+    double total = 0.0;
+    for (double time : seconds)
+    {
+        total += time;
+    }
+    return total;
+}
+
+// adds the time since start to the subsystem, and moves start on to now.
+static void lap(SimulationProfile *profile, int subsystem, clock_type::time_point &start)
+{
+    if (profile)
+    {
+        clock_type::time_point now      = clock_type::now();
+        profile->seconds[subsystem]     += std::chrono::duration<double>(now - start).count();
+        start                           = now;
+    }
+}
+
+void update_simulation(Player &player, Camera &camera, Level &level, double dt, SimulationProfile *profile)
+{
+    // basically anything that moves needs the dt value:
+    // player position (xy movement, jumping).
+    // camera pitch and yaw.
+    // also all lerp values need dt as well? ig bcos they constitute the final term,
+    // but u dont want to * dt the entire value because that would get rid of the lerp i think?
+    clock_type::time_point start = profile ? clock_type::now() : clock_type::time_point();
+
+    for (size_t i = 0; i < level.npcs.size(); ++i)
+    {
+        level.npcs[i].update(dt);
+    }
+    lap(profile, SUBSYSTEM_NPC, start);
+
+    camera.get_input(dt);                   // camera input, calculates camera orientation vec3.
+    lap(profile, SUBSYSTEM_CAMERA, start);
+
+    player.update(dt, level, camera);       // player input and movement, sent a vector of colliders.
+    lap(profile, SUBSYSTEM_PLAYER, start);
+
+    camera.update(player.camera_lookat);    // update camera matrix using target position.
+    lap(profile, SUBSYSTEM_CAMERA, start);
+
+    update_inputs();
+    lap(profile, SUBSYSTEM_INPUT, start);
+
+    if (profile)
+    {
+        profile->ticks++;
+    }
+}
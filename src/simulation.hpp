@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>        // per subsystem timings.
+#include <chrono>       // timing each subsystem.
+
+#include "player.hpp"
+#include "camera.hpp"
+#include "level.hpp"
+
+// subsystems timed by update_simulation.
+#define SUBSYSTEM_NPC       0
+#define SUBSYSTEM_CAMERA    1
+#define SUBSYSTEM_PLAYER    2
+#define SUBSYSTEM_INPUT     3
+#define SUBSYSTEM_COUNT     4
+
+// total time spent in each subsystem over every tick it was given to.
+struct SimulationProfile
+{
+    std::array<double, SUBSYSTEM_COUNT> seconds = {};
+    uint64_t ticks = 0;
+
+    static const char *get_name(int subsystem);
+    double get_total() const;
+};
+
+// one fixed timestep of everything that isn't drawing or audio: npc animation, camera, player movement,
+// collision and level triggers, then rolling the input state over to the next tick.
+// shared by the windowed game and the headless runner so both simulate exactly the same thing.
+// pass a profile to time each subsystem, timing is skipped otherwise.
+void update_simulation(Player &player, Camera &camera, Level &level, double dt, SimulationProfile *profile = nullptr);
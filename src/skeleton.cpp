@@ -0,0 +1,232 @@
+#include "skeleton.hpp"
+#include "draw.hpp"     // model data and node transforms.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>  // sse intrinsics.
+#define SKELETON_SSE
+#endif
+
+bool Skeleton::build(const ModelData &data, uint32_t skin)
+{
+    *this = Skeleton();
+    if ((skin >= data.skins.size()) || data.skins[skin].joints.empty())
+    {
+        return false;
+    }
+
+    // the mesh Model::update_joints would take the skin's transform from, the last one wins there too.
+    int32_t mesh_node = -1;
+    for (size_t i = 0; i < data.nodes.size(); ++i)
+    {
+        if (!data.nodes[i].mesh_primitives.empty() && (data.nodes[i].skin == static_cast<int32_t>(skin)))
+        {
+            mesh_node = static_cast<int32_t>(i);
+        }
+    }
+    if (mesh_node < 0)
+    {
+        return false;
+    }
+
+    // every node the joints and the mesh hang from.
+    std::vector<uint8_t> used(data.nodes.size(), 0);
+    auto use = [&](int32_t node)
+    {
+        for (; (node > -1) && !used[node]; node = data.nodes[node].parent)
+        {
+            used[node] = 1;
+        }
+    };
+    const Skin &source = data.skins[skin];
+    for (uint32_t joint : source.joints)
+    {
+        use(static_cast<int32_t>(joint));
+    }
+    use(mesh_node);
+
+    // bones in node order keep parents first.
+    std::vector<int32_t> bones(data.nodes.size(), -1);
+    for (size_t i = 0; i < data.nodes.size(); ++i)
+    {
+        if (!used[i])
+        {
+            continue;
+        }
+
+        const Node &node    = data.nodes[i];
+        bones[i]            = static_cast<int32_t>(nodes.size());
+        nodes.push_back(static_cast<uint32_t>(i));
+        parents.push_back((node.parent > -1) ? bones[node.parent] : -1);
+        if (node.matrix != glm::mat4(1.0f))
+        {
+            matrix_bones.push_back(static_cast<uint32_t>(bones[i]));
+            node_matrices.push_back(node.matrix);
+        }
+    }
+
+    for (size_t i = 0; i < source.joints.size(); ++i)
+    {
+        joint_bones.push_back(static_cast<uint32_t>(bones[source.joints[i]]));
+        inverse_bind_matrices.push_back((i < source.inverse_bind_matrices.size()) ? source.inverse_bind_matrices[i] : glm::mat4(1.0f));
+    }
+    mesh_bone = bones[mesh_node];
+    return true;
+}
+
+void SkeletonPose::resize(const Skeleton &skeleton)
+{
+    size_t padded = ((skeleton.get_bone_count() + SKELETON_LANES - 1) / SKELETON_LANES) * SKELETON_LANES;
+
+    // the padding is an identity bone, so it converts to a valid matrix nobody reads.
+    for (std::vector<float> *stream : {&translation_x, &translation_y, &translation_z, &rotation_x, &rotation_y, &rotation_z})
+    {
+        stream->assign(padded, 0.0f);
+    }
+    for (std::vector<float> *stream : {&rotation_w, &scale_x, &scale_y, &scale_z})
+    {
+        stream->assign(padded, 1.0f);
+    }
+    locals.resize(padded);
+    models.resize(skeleton.get_bone_count());
+}
+
+void SkeletonPose::gather(const Skeleton &skeleton, const std::vector<NodeTransform> &transforms)
+{
+    for (size_t i = 0; i < skeleton.nodes.size(); ++i)
+    {
+        const NodeTransform &transform = transforms[skeleton.nodes[i]];
+        translation_x[i]    = transform.translation.x;
+        translation_y[i]    = transform.translation.y;
+        translation_z[i]    = transform.translation.z;
+        rotation_x[i]       = transform.rotation.x;
+        rotation_y[i]       = transform.rotation.y;
+        rotation_z[i]       = transform.rotation.z;
+        rotation_w[i]       = transform.rotation.w;
+        scale_x[i]          = transform.scale.x;
+        scale_y[i]          = transform.scale.y;
+        scale_z[i]          = transform.scale.z;
+    }
+}
+
+#ifdef SKELETON_SSE
+
+// out = a * b, a column of out is a's columns weighted by that column of b.
+static inline void multiply(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out)
+{
+    __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+    // a and b are read whole before out is written, so out can be either.
+    __m128 columns[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128 column   = _mm_mul_ps(a0, _mm_set1_ps(b[i][0]));
+        column          = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(b[i][1])));
+        column          = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(b[i][2])));
+        columns[i]      = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(b[i][3])));
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        _mm_storeu_ps(&out[i][0], columns[i]);
+    }
+}
+
+// write a column of four bones' matrices, given as soa x, y, z and w.
+static inline void store_column(glm::mat4 *matrices, int column, __m128 x, __m128 y, __m128 z, __m128 w)
+{
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(&matrices[0][column][0], x);
+    _mm_storeu_ps(&matrices[1][column][0], y);
+    _mm_storeu_ps(&matrices[2][column][0], z);
+    _mm_storeu_ps(&matrices[3][column][0], w);
+}
+
+// translate * rotate * scale for SKELETON_LANES bones at once, the same terms glm::mat4(quat) uses.
+static void convert_locals(SkeletonPose &pose)
+{
+    const __m128 one    = _mm_set1_ps(1.0f);
+    const __m128 two    = _mm_set1_ps(2.0f);
+    const __m128 zero   = _mm_setzero_ps();
+
+    for (size_t i = 0; i < pose.locals.size(); i += SKELETON_LANES)
+    {
+        __m128 x    = _mm_loadu_ps(&pose.rotation_x[i]);
+        __m128 y    = _mm_loadu_ps(&pose.rotation_y[i]);
+        __m128 z    = _mm_loadu_ps(&pose.rotation_z[i]);
+        __m128 w    = _mm_loadu_ps(&pose.rotation_w[i]);
+        __m128 sx   = _mm_loadu_ps(&pose.scale_x[i]);
+        __m128 sy   = _mm_loadu_ps(&pose.scale_y[i]);
+        __m128 sz   = _mm_loadu_ps(&pose.scale_z[i]);
+
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        glm::mat4 *locals = &pose.locals[i];
+        store_column(locals, 0, _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+                                _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+                                _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx), zero);
+        store_column(locals, 1, _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+                                _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+                                _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy), zero);
+        store_column(locals, 2, _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+                                _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+                                _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz), zero);
+        store_column(locals, 3, _mm_loadu_ps(&pose.translation_x[i]), _mm_loadu_ps(&pose.translation_y[i]),
+                                _mm_loadu_ps(&pose.translation_z[i]), one);
+    }
+}
+
+#else
+
+static inline void multiply(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out)
+{
+    out = a * b;
+}
+
+static void convert_locals(SkeletonPose &pose)
+{
+    for (size_t i = 0; i < pose.locals.size(); ++i)
+    {
+        glm::quat rotation  = glm::quat(pose.rotation_w[i], pose.rotation_x[i], pose.rotation_y[i], pose.rotation_z[i]);
+        pose.locals[i]      = glm::mat4(rotation) * glm::scale(glm::mat4(1.0f), glm::vec3(pose.scale_x[i], pose.scale_y[i], pose.scale_z[i]));
+        pose.locals[i][3]   = glm::vec4(pose.translation_x[i], pose.translation_y[i], pose.translation_z[i], 1.0f);
+    }
+}
+
+#endif
+
+void pose_skeleton(const Skeleton &skeleton, SkeletonPose &pose, std::span<glm::mat4> palette)
+{
+    convert_locals(pose);
+    for (size_t i = 0; i < skeleton.matrix_bones.size(); ++i)
+    {
+        glm::mat4 &local = pose.locals[skeleton.matrix_bones[i]];
+        multiply(local, skeleton.node_matrices[i], local);
+    }
+
+    // parents come first, so theirs is always ready.
+    for (size_t i = 0; i < skeleton.nodes.size(); ++i)
+    {
+        int32_t parent = skeleton.parents[i];
+        if (parent > -1)
+        {
+            multiply(pose.models[parent], pose.locals[i], pose.models[i]);
+        }
+        else
+        {
+            pose.models[i] = pose.locals[i];
+        }
+    }
+
+    // the mesh's transform is applied when it's drawn, so it comes back out of every joint.
+    glm::mat4 inverse_mesh = glm::inverse(pose.models[skeleton.mesh_bone]);
+    for (size_t i = 0; i < skeleton.joint_bones.size(); ++i)
+    {
+        glm::mat4 joint;
+        multiply(inverse_mesh, pose.models[skeleton.joint_bones[i]], joint);
+        multiply(joint, skeleton.inverse_bind_matrices[i], palette[i]);
+    }
+}
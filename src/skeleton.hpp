@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>       // bone and joint arrays, soa streams.
+#include <span>         // palette output.
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#define SKELETON_LANES 4    // bones converted per iteration, streams are padded to a multiple of it with identity bones.
+
+struct ModelData;
+struct NodeTransform;
+
+// one skin posed on its own, rather than through every node of the model like Model::update_joints.
+// bones are the skin's joints, every node above them and the skinned mesh's node, in the model's node order
+// so parents always come before their children.
+struct Skeleton
+{
+    std::vector<uint32_t> nodes;                    // by bone, the model node it poses.
+    std::vector<int32_t> parents;                   // by bone, -1 for a root.
+    std::vector<uint32_t> joint_bones;              // by joint, the bone that is that joint.
+    std::vector<glm::mat4> inverse_bind_matrices;   // by joint.
+    std::vector<uint32_t> matrix_bones;             // bones whose node has a matrix as well as its trs.
+    std::vector<glm::mat4> node_matrices;           // by matrix_bones.
+    int32_t mesh_bone = -1;                         // the skinned mesh's node, its transform is taken back out of every joint.
+
+    bool build(const ModelData &data, uint32_t skin);   // false if the skin has no joints or no mesh uses it.
+    size_t get_bone_count() const { return nodes.size(); }
+    size_t get_joint_count() const { return joint_bones.size(); }
+};
+
+// a skeleton's local pose as structure of arrays, so a simd register holds the same component of several bones.
+// plus the local and model space matrices worked out from it.
+struct SkeletonPose
+{
+    std::vector<float> translation_x, translation_y, translation_z;
+    std::vector<float> rotation_x, rotation_y, rotation_z, rotation_w;
+    std::vector<float> scale_x, scale_y, scale_z;
+    std::vector<glm::mat4> locals;                  // by bone, padded like the streams.
+    std::vector<glm::mat4> models;                  // by bone, in the model's space.
+
+    void resize(const Skeleton &skeleton);
+    void gather(const Skeleton &skeleton, const std::vector<NodeTransform> &transforms);   // from a model's transforms (by node).
+};
+
+// local to model space in one pass over the bones, then each joint's palette matrix
+// (inverse(mesh) * joint * inverse bind, as Model::update_joints) in the same pass as its inverse bind multiply.
+// palette needs room for every joint.
+void pose_skeleton(const Skeleton &skeleton, SkeletonPose &pose, std::span<glm::mat4> palette);
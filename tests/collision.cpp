@@ -0,0 +1,68 @@
+/*
+collision tests.
+pushes a player sized cylinder out of colliders it starts inside of, as Player::move does on spawn.
+gl calls are stubbed out (colliders make their debug draw buffers) so it runs without a window.
+returns non-zero if any check fails.
+*/
+
+#include <iostream>     // results.
+#include <memory>
+#include <vector>
+#include <cmath>
+
+#include "null_gl.hpp"
+#include "collision.hpp"
+
+#define PUSH_TOLERANCE  0.01f   // epa's depth is only as exact as its stopping threshold.
+
+using std::cout;
+
+// axis aligned box as a convex mesh collider.
+static std::unique_ptr<Collider> make_box(glm::vec3 min, glm::vec3 max)
+{
+    std::vector<glm::vec3> corners;
+    for (int i = 0; i < 8; ++i)
+    {
+        corners.push_back(glm::vec3((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z));
+    }
+    return std::make_unique<MeshCollider>(corners);
+}
+
+static bool check(bool passed, const char *name)
+{
+    cout << (passed ? "pass: " : "FAIL: ") << name << "\n";
+    return passed;
+}
+
+// two floor pieces that overlap each other with their tops in the same plane, the player sunk into both.
+// it has to come out level with the floor, not pushed up once per piece.
+static bool test_coplanar_push_out()
+{
+    std::vector<std::unique_ptr<Collider>> colliders;
+    colliders.push_back(make_box(glm::vec3(-4.0f, -1.0f, -4.0f), glm::vec3(0.5f, 0.0f, 4.0f)));
+    colliders.push_back(make_box(glm::vec3(-0.5f, -1.0f, -4.0f), glm::vec3(4.0f, 0.0f, 4.0f)));
+    std::vector<int> candidates = {0, 1};
+
+    CylinderCollider player(glm::vec3(0.0f, -0.25f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 3.0f, 0.8f);
+    NarrowPhase narrow_phase;
+    const std::vector<Collision> &push_outs = narrow_phase.push_out(&player, colliders, candidates);
+
+    bool passed = check(!push_outs.empty(), "coplanar colliders: overlap found");
+    passed      &= check(std::abs(player.position.y) < PUSH_TOLERANCE, "coplanar colliders: pushed out once, level with the floor");
+    passed      &= check((std::abs(player.position.x) < PUSH_TOLERANCE) && (std::abs(player.position.z) < PUSH_TOLERANCE), "coplanar colliders: not pushed sideways");
+    passed      &= check(narrow_phase.push_out(&player, colliders, candidates).empty(), "coplanar colliders: nothing left to push out of");
+    return passed;
+}
+
+int main(void)
+{
+    if (!load_null_gl())
+    {
+        cout << "failed to load null gl\n";
+        return 1;
+    }
+
+    bool passed = test_coplanar_push_out();
+    cout << (passed ? "all collision tests passed\n" : "collision tests failed\n");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+/*
+offline asset baker.
+converts models (.gltf) and skybox folders into .bake files next to them, which the game maps
+straight into memory instead of parsing json and decoding images (see src/asset.hpp).
+usage: bake                     bake every model and skybox.
+       bake scene_1.gltf ...    bake just these models.
+gl calls are stubbed out so it runs without a window.
+run from the repo root so the assets path resolves.
+*/
+
+#include <iostream>
+#include <filesystem>   // finding assets.
+#include <string>
+#include <chrono>
+
+#include "null_gl.hpp"
+#include "asset.hpp"
+#include "defines.hpp"
+
+using std::cout;
+namespace fs = std::filesystem;
+
+int main(int argc, char **argv)
+{
+    if (!load_null_gl())
+    {
+        cout << "failed to load null gl\n";
+        return 1;
+    }
+
+    std::vector<std::string> models;
+    std::vector<int> skyboxes;
+    for (int i = 1; i < argc; ++i)
+    {
+        models.push_back(argv[i]);
+    }
+
+    // nothing given, bake everything.
+    if (models.empty())
+    {
+        for (const fs::directory_entry &entry : fs::directory_iterator(MODELS_PATH))
+        {
+            if (entry.path().extension() == ".gltf")
+            {
+                models.push_back(entry.path().filename().string());
+            }
+        }
+        for (const fs::directory_entry &entry : fs::directory_iterator(TEXTURES_PATH))
+        {
+            std::string name = entry.path().filename().string();
+            if (entry.is_directory() && (name.rfind("skybox_", 0) == 0))
+            {
+                skyboxes.push_back(std::stoi(name.substr(7)));
+            }
+        }
+    }
+
+    auto start  = std::chrono::steady_clock::now();
+    int failed  = 0;
+    for (const std::string &model : models)
+    {
+        failed += bake_model(model) ? 0 : 1;
+    }
+    for (int skybox : skyboxes)
+    {
+        failed += bake_skybox(skybox) ? 0 : 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout << "\n" << (models.size() + skyboxes.size() - failed) << " baked, " << failed << " failed in " << seconds << "s\n";
+    return failed ? 1 : 0;
+}